@@ -0,0 +1,111 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "batchedithelper.h"
+
+// Qt
+#include <QProgressDialog>
+#include <QStringList>
+
+// KDE
+#include <KLocalizedString>
+#include <KMessageBox>
+
+// Local
+#include <lib/batcheditor.h>
+
+namespace Gwenview
+{
+
+struct BatchEditHelperPrivate
+{
+    QWidget* mParent;
+    QProgressDialog* mProgressDialog;
+    BatchEditor* mEditor;
+    QStringList mErrorList;
+};
+
+BatchEditHelper::BatchEditHelper(QWidget* parent)
+: d(new BatchEditHelperPrivate)
+{
+    d->mParent = parent;
+    d->mEditor = new BatchEditor(this);
+    connect(d->mEditor, &BatchEditor::progressChanged, this, &BatchEditHelper::slotProgressChanged);
+    connect(d->mEditor, &BatchEditor::failed, this, &BatchEditHelper::slotFailed);
+
+    d->mProgressDialog = new QProgressDialog(parent);
+    // Let the editor finish the files being written before closing
+    d->mProgressDialog->setAutoReset(false);
+    d->mProgressDialog->setAutoClose(false);
+    connect(d->mProgressDialog, &QProgressDialog::canceled, d->mEditor, &BatchEditor::cancel);
+    connect(d->mEditor, &BatchEditor::finished, d->mProgressDialog, &QProgressDialog::accept);
+    d->mProgressDialog->setLabelText(i18nc("@info:progress", "Editing images..."));
+    d->mProgressDialog->setCancelButtonText(i18n("&Stop"));
+    d->mProgressDialog->setMinimum(0);
+}
+
+BatchEditHelper::~BatchEditHelper()
+{
+    delete d;
+}
+
+BatchEditor* BatchEditHelper::editor() const
+{
+    return d->mEditor;
+}
+
+void BatchEditHelper::run(const QList<QUrl>& urls)
+{
+    d->mProgressDialog->setRange(0, urls.size());
+    d->mProgressDialog->setValue(0);
+    d->mEditor->start(urls);
+
+    d->mProgressDialog->exec();
+
+    // Done, show message if necessary
+    if (d->mErrorList.count() > 0) {
+        QString msg = i18ncp("@info", "One image could not be edited:", "%1 images could not be edited:", d->mErrorList.count());
+        msg += "<ul>";
+        Q_FOREACH(const QString & item, d->mErrorList) {
+            msg += "<li>" + item + "</li>";
+        }
+        msg += "</ul>";
+        KMessageBox::sorry(d->mParent, msg);
+    }
+}
+
+void BatchEditHelper::slotProgressChanged(int processed, int total)
+{
+    d->mProgressDialog->setValue(processed);
+    d->mProgressDialog->setLabelText(
+        i18nc("@info:progress %1 and %2 are image counts, %3 is a number of images per second",
+              "Editing images... %1 of %2 (%3 images/s)",
+              processed, total, QString::number(d->mEditor->throughput(), 'f', 1)));
+}
+
+void BatchEditHelper::slotFailed(const QUrl& url, const QString& errorString)
+{
+    QString name = url.fileName().isEmpty() ? url.toDisplayString() : url.fileName();
+    d->mErrorList << xi18nc("@info %1 is the name of the image which could not be edited, %2 is the reason for the failure",
+                            "<filename>%1</filename>: %2", name, errorString);
+}
+
+} // namespace
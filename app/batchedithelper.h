@@ -0,0 +1,66 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef BATCHEDITHELPER_H
+#define BATCHEDITHELPER_H
+
+// Qt
+#include <QList>
+#include <QObject>
+#include <QUrl>
+
+// KDE
+
+// Local
+
+class QWidget;
+
+namespace Gwenview
+{
+
+class BatchEditor;
+
+struct BatchEditHelperPrivate;
+/**
+ * Runs a BatchEditor on a list of files, showing a modal progress dialog
+ * and a summary of the failures at the end.
+ */
+class BatchEditHelper : public QObject
+{
+    Q_OBJECT
+public:
+    BatchEditHelper(QWidget* parent);
+    ~BatchEditHelper();
+
+    BatchEditor* editor() const;
+
+    void run(const QList<QUrl>& urls);
+
+private Q_SLOTS:
+    void slotProgressChanged(int processed, int total);
+    void slotFailed(const QUrl& url, const QString& errorString);
+
+private:
+    BatchEditHelperPrivate* const d;
+};
+
+} // namespace
+
+#endif /* BATCHEDITHELPER_H */
@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include <lib/document/documentfactory.h>
+#include <lib/imageutils.h>
 #include <lib/semanticinfo/sorteddirmodel.h>
 
 namespace Gwenview
@@ -61,10 +62,13 @@ void DocumentInfoProvider::thumbnailForDocument(const QUrl &url, ThumbnailGroup:
         return;
     }
 
-    QImage image = doc->image();
+    // Scale the unoriented image: applying the orientation to the small
+    // version is much cheaper
+    QImage image = doc->unorientedImage();
     if (image.width() > pixelSize || image.height() > pixelSize) {
         image = image.scaled(pixelSize, pixelSize, Qt::KeepAspectRatio);
     }
+    image = ImageUtils::transformed(image, doc->imageOrientation());
     *outPix = QPixmap::fromImage(image);
     *outFullSize = doc->size();
 }
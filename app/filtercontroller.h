@@ -69,7 +69,7 @@ public:
     };
     NameFilter(SortedDirModel* model)
     : AbstractSortedDirModelFilter(model)
-    , mText()
+    , mFoldedText()
     , mMode(Contains)
     {}
 
@@ -80,31 +80,51 @@ public:
 
     bool acceptsIndex(const QModelIndex& index) const Q_DECL_OVERRIDE
     {
-        if (mText.isEmpty()) {
+        if (mFoldedText.isEmpty()) {
             return true;
         }
+        const bool contains = model()->foldedNameForSourceIndex(index).contains(mFoldedText);
         switch (mMode) {
             case Contains:
-                return index.data().toString().contains(mText, Qt::CaseInsensitive);
+                return contains;
             default: /*DoesNotContain:*/
-                return !index.data().toString().contains(mText, Qt::CaseInsensitive);
+                return !contains;
         }
     }
 
     void setText(const QString& text)
     {
-        mText = text;
-        model()->applyFilters();
+        const QString foldedText = text.toCaseFolded();
+        if (foldedText == mFoldedText) {
+            return;
+        }
+        // Typing more characters can only reduce the number of names
+        // containing the text. An empty text accepts everything.
+        SortedDirModel::FilterChange change = SortedDirModel::FilterChanged;
+        if (mFoldedText.isEmpty()) {
+            change = SortedDirModel::FilterNarrowed;
+        } else if (foldedText.isEmpty()) {
+            change = SortedDirModel::FilterWidened;
+        } else if (foldedText.contains(mFoldedText)) {
+            change = mMode == Contains ? SortedDirModel::FilterNarrowed : SortedDirModel::FilterWidened;
+        } else if (mFoldedText.contains(foldedText)) {
+            change = mMode == Contains ? SortedDirModel::FilterWidened : SortedDirModel::FilterNarrowed;
+        }
+        mFoldedText = foldedText;
+        model()->applyFilters(change);
     }
 
     void setMode(Mode mode)
     {
+        if (mode == mMode) {
+            return;
+        }
         mMode = mode;
         model()->applyFilters();
     }
 
 private:
-    QString mText;
+    QString mFoldedText;
     Mode mMode;
 };
 
@@ -165,12 +185,27 @@ public:
 
     void setDate(const QDate& date)
     {
+        if (date == mDate) {
+            return;
+        }
+        SortedDirModel::FilterChange change = SortedDirModel::FilterChanged;
+        if (!mDate.isValid()) {
+            change = SortedDirModel::FilterNarrowed;
+        } else if (!date.isValid()) {
+            change = SortedDirModel::FilterWidened;
+        } else if (mMode != Equal) {
+            const bool later = date > mDate;
+            change = later == (mMode == GreaterOrEqual) ? SortedDirModel::FilterNarrowed : SortedDirModel::FilterWidened;
+        }
         mDate = date;
-        model()->applyFilters();
+        model()->applyFilters(change);
     }
 
     void setMode(Mode mode)
     {
+        if (mode == mMode) {
+            return;
+        }
         mMode = mode;
         model()->applyFilters();
     }
@@ -235,12 +270,23 @@ public:
 
     void setRating(int value)
     {
+        if (value == mRating) {
+            return;
+        }
+        SortedDirModel::FilterChange change = SortedDirModel::FilterChanged;
+        if (mMode != Equal) {
+            const bool higher = value > mRating;
+            change = higher == (mMode == GreaterOrEqual) ? SortedDirModel::FilterNarrowed : SortedDirModel::FilterWidened;
+        }
         mRating = value;
-        model()->applyFilters();
+        model()->applyFilters(change);
     }
 
     void setMode(Mode mode)
     {
+        if (mode == mMode) {
+            return;
+        }
         mMode = mode;
         model()->applyFilters();
     }
@@ -298,12 +344,24 @@ public:
 
     void setTag(const SemanticInfoTag& tag)
     {
+        if (tag == mTag) {
+            return;
+        }
+        SortedDirModel::FilterChange change = SortedDirModel::FilterChanged;
+        if (mTag.isEmpty()) {
+            change = SortedDirModel::FilterNarrowed;
+        } else if (tag.isEmpty()) {
+            change = SortedDirModel::FilterWidened;
+        }
         mTag = tag;
-        model()->applyFilters();
+        model()->applyFilters(change);
     }
 
     void setWantMatchingTag(bool value)
     {
+        if (value == mWantMatchingTag) {
+            return;
+        }
         mWantMatchingTag = value;
         model()->applyFilters();
     }
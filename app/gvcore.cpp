@@ -361,6 +361,10 @@ void GvCore::setRating(const QUrl &url, int rating)
 
 static void clearModel(QAbstractItemModel* model)
 {
+    // Make sure entries which have not been fetched yet are removed too
+    while (model->canFetchMore(QModelIndex())) {
+        model->fetchMore(QModelIndex());
+    }
     model->removeRows(0, model->rowCount());
 }
 
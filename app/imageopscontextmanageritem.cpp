@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <QApplication>
 #include <QAction>
 #include <QDebug>
+#include <QImageReader>
 
 // KDE
 #include <KLocalizedString>
@@ -33,10 +34,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <KActionCategory>
 
 // Local
+#include "batchedithelper.h"
 #include "viewmainpage.h"
 #include "gvcore.h"
 #include "mainwindow.h"
 #include "sidebar.h"
+#include <lib/batcheditor.h>
 #include <lib/contextmanager.h>
 #include <lib/crop/croptool.h>
 #include <lib/document/documentfactory.h>
@@ -44,6 +47,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <lib/eventwatcher.h>
 #include <lib/redeyereduction/redeyereductiontool.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/jpegcontent.h>
+#include <lib/mimetypeutils.h>
 #include <lib/resize/resizeimageoperation.h>
 #include <lib/resize/resizeimagedialog.h>
 #include <lib/transformimageoperation.h>
@@ -125,6 +130,53 @@ struct ImageOpsContextManagerItem::Private
                 ;
     }
 
+    /**
+     * Returns the urls to edit with a BatchEditor: the selected images, when
+     * several are selected from the browse page. Returns an empty list if the
+     * operation should be applied to the current document instead.
+     */
+    QList<QUrl> batchUrls() const
+    {
+        QList<QUrl> urls;
+        if (mMainWindow->viewMainPage()->isVisible()) {
+            return urls;
+        }
+        const KFileItemList list = q->contextManager()->selectedFileItemList();
+        if (list.count() < 2) {
+            return urls;
+        }
+        Q_FOREACH(const KFileItem& item, list) {
+            urls << item.url();
+        }
+        return urls;
+    }
+
+    bool selectionIsBatchEditable() const
+    {
+        const KFileItemList list = q->contextManager()->selectedFileItemList();
+        if (list.count() < 2) {
+            return false;
+        }
+        Q_FOREACH(const KFileItem& item, list) {
+            if (!item.isLocalFile() || MimeTypeUtils::fileItemKind(item) != MimeTypeUtils::KIND_RASTER_IMAGE) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void applyTransformation(Orientation orientation)
+    {
+        const QList<QUrl> urls = batchUrls();
+        if (urls.isEmpty()) {
+            q->applyImageOperation(new TransformImageOperation(orientation));
+            return;
+        }
+        BatchEditHelper helper(mMainWindow);
+        helper.editor()->setTransformation(orientation);
+        helper.run(urls);
+    }
+
     bool ensureEditable()
     {
         QUrl url = q->contextManager()->currentUrl();
@@ -185,20 +237,22 @@ void ImageOpsContextManagerItem::updateActions()
 {
     bool canModify = contextManager()->currentUrlIsRasterImage();
     bool viewMainPageIsVisible = d->mMainWindow->viewMainPage()->isVisible();
+    bool canBatchModify = false;
     if (!viewMainPageIsVisible) {
-        // Since we only support image operations on one image for now,
-        // disable actions if several images are selected and the document
-        // view is not visible.
+        // When several images are selected and the document view is not
+        // visible, transformations and resizing are applied to all of them
+        // with a BatchEditor. The other operations need the document view.
         if (contextManager()->selectedFileItemList().count() != 1) {
+            canBatchModify = d->selectionIsBatchEditable();
             canModify = false;
         }
     }
 
-    d->mRotateLeftAction->setEnabled(canModify);
-    d->mRotateRightAction->setEnabled(canModify);
-    d->mMirrorAction->setEnabled(canModify);
-    d->mFlipAction->setEnabled(canModify);
-    d->mResizeAction->setEnabled(canModify);
+    d->mRotateLeftAction->setEnabled(canModify || canBatchModify);
+    d->mRotateRightAction->setEnabled(canModify || canBatchModify);
+    d->mMirrorAction->setEnabled(canModify || canBatchModify);
+    d->mFlipAction->setEnabled(canModify || canBatchModify);
+    d->mResizeAction->setEnabled(canModify || canBatchModify);
     d->mCropAction->setEnabled(canModify && viewMainPageIsVisible);
     d->mRedEyeReductionAction->setEnabled(canModify && viewMainPageIsVisible);
 
@@ -207,30 +261,31 @@ void ImageOpsContextManagerItem::updateActions()
 
 void ImageOpsContextManagerItem::rotateLeft()
 {
-    TransformImageOperation* op = new TransformImageOperation(ROT_270);
-    applyImageOperation(op);
+    d->applyTransformation(ROT_270);
 }
 
 void ImageOpsContextManagerItem::rotateRight()
 {
-    TransformImageOperation* op = new TransformImageOperation(ROT_90);
-    applyImageOperation(op);
+    d->applyTransformation(ROT_90);
 }
 
 void ImageOpsContextManagerItem::mirror()
 {
-    TransformImageOperation* op = new TransformImageOperation(HFLIP);
-    applyImageOperation(op);
+    d->applyTransformation(HFLIP);
 }
 
 void ImageOpsContextManagerItem::flip()
 {
-    TransformImageOperation* op = new TransformImageOperation(VFLIP);
-    applyImageOperation(op);
+    d->applyTransformation(VFLIP);
 }
 
 void ImageOpsContextManagerItem::resizeImage()
 {
+    const QList<QUrl> urls = d->batchUrls();
+    if (!urls.isEmpty()) {
+        resizeImages(urls);
+        return;
+    }
     if (!d->ensureEditable()) {
         return;
     }
@@ -241,10 +296,51 @@ void ImageOpsContextManagerItem::resizeImage()
     if (!dialog.exec()) {
         return;
     }
-    ResizeImageOperation* op = new ResizeImageOperation(dialog.size());
+    ResizeImageOperation* op = new ResizeImageOperation(dialog.size(), dialog.filter());
     applyImageOperation(op);
 }
 
+void ImageOpsContextManagerItem::resizeImages(const QList<QUrl>& urls)
+{
+    // Do not load a document for this: it would end up in the document
+    // cache. Reading the header of the first image is enough to show
+    // meaningful sizes in the dialog.
+    const QString path = urls.first().toLocalFile();
+    QImageReader reader(path);
+    QSize originalSize = reader.size();
+    if (!originalSize.isValid()) {
+        // Some image plugins cannot tell the size without decoding
+        originalSize = reader.read().size();
+    } else if (reader.format() == "jpeg" && GwenviewConfig::applyExifOrientation()) {
+        // BatchEditor applies the Exif orientation, so the size the user
+        // sees and resizes is the oriented one
+        JpegContent content;
+        if (content.load(path)) {
+            const Orientation orientation = content.orientation();
+            if (orientation == TRANSPOSE || orientation == ROT_90
+                || orientation == TRANSVERSE || orientation == ROT_270) {
+                originalSize.transpose();
+            }
+        }
+    }
+    if (!originalSize.isValid()) {
+        KMessageBox::sorry(
+            QApplication::activeWindow(),
+            i18nc("@info", "Gwenview cannot edit this kind of image.")
+        );
+        return;
+    }
+    ResizeImageDialog dialog(d->mMainWindow);
+    dialog.setOriginalSize(originalSize);
+    if (!dialog.exec()) {
+        return;
+    }
+    BatchEditHelper helper(d->mMainWindow);
+    helper.editor()->setScaleFactor(qreal(dialog.size().width()) / originalSize.width());
+    helper.editor()->setResizeFilter(dialog.filter());
+    helper.run(urls);
+}
+
 void ImageOpsContextManagerItem::crop()
 {
     if (!d->ensureEditable()) {
@@ -22,6 +22,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #define IMAGEOPSCONTEXTMANAGERITEM_H
 
 // Qt
+#include <QList>
+#include <QUrl>
 
 // KDE
 
@@ -55,6 +57,8 @@ private Q_SLOTS:
     void restoreDefaultImageViewTool();
 
 private:
+    void resizeImages(const QList<QUrl>&);
+
     struct Private;
     Private* const d;
 };
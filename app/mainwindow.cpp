@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Qt
 #include <QApplication>
 #include <QDateTime>
+#include <QDesktopWidget>
 #include <QPushButton>
 #include <QShortcut>
 #include <QSplitter>
@@ -1364,6 +1365,7 @@ void MainWindow::toggleSlideShow()
                 break;
             }
         }
+        d->mSlideShow->setSlideSize(QApplication::desktop()->screenGeometry(this).size());
         d->mSlideShow->start(list);
     }
     updateSlideShowAction();
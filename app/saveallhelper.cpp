@@ -22,9 +22,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "saveallhelper.h"
 
 // Qt
-#include <QFuture>
-#include <QFutureWatcher>
-#include <QSet>
 #include <QStringList>
 #include <QUrl>
 #include <QProgressDialog>
@@ -34,9 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <KMessageBox>
 
 // Local
-#include <lib/document/document.h>
 #include <lib/document/documentfactory.h>
-#include <lib/document/documentjob.h>
+#include <lib/document/savescheduler.h>
 
 namespace Gwenview
 {
@@ -45,7 +41,7 @@ struct SaveAllHelperPrivate
 {
     QWidget* mParent;
     QProgressDialog* mProgressDialog;
-    QSet<DocumentJob*> mJobSet;
+    SaveScheduler* mScheduler;
     QStringList mErrorList;
 };
 
@@ -53,11 +49,18 @@ SaveAllHelper::SaveAllHelper(QWidget* parent)
 : d(new SaveAllHelperPrivate)
 {
     d->mParent = parent;
+    d->mScheduler = new SaveScheduler(this);
+    connect(d->mScheduler, &SaveScheduler::progressChanged, this, &SaveAllHelper::slotProgressChanged);
+    connect(d->mScheduler, &SaveScheduler::failed, this, &SaveAllHelper::slotFailed);
+
     d->mProgressDialog = new QProgressDialog(parent);
-    connect(d->mProgressDialog, &QProgressDialog::canceled, this, &SaveAllHelper::slotCanceled);
+    d->mProgressDialog->setAutoReset(false);
+    d->mProgressDialog->setAutoClose(false);
+    connect(d->mProgressDialog, &QProgressDialog::canceled, d->mScheduler, &SaveScheduler::cancel);
+    connect(d->mScheduler, &SaveScheduler::finished, d->mProgressDialog, &QProgressDialog::accept);
     d->mProgressDialog->setLabelText(i18nc("@info:progress saving all image changes", "Saving..."));
     d->mProgressDialog->setCancelButtonText(i18n("&Stop"));
-    d->mProgressDialog->setMinimum(0);
+    d->mProgressDialog->setRange(0, 100);
 }
 
 SaveAllHelper::~SaveAllHelper()
@@ -68,14 +71,8 @@ SaveAllHelper::~SaveAllHelper()
 void SaveAllHelper::save()
 {
     QList<QUrl> list = DocumentFactory::instance()->modifiedDocumentList();
-    d->mProgressDialog->setRange(0, list.size());
     d->mProgressDialog->setValue(0);
-    Q_FOREACH(const QUrl &url, list) {
-        Document::Ptr doc = DocumentFactory::instance()->load(url);
-        DocumentJob* job = doc->save(url, doc->format());
-        connect(job, &DocumentJob::result, this, &SaveAllHelper::slotResult);
-        d->mJobSet << job;
-    }
+    d->mScheduler->start(list);
 
     d->mProgressDialog->exec();
 
@@ -91,24 +88,19 @@ void SaveAllHelper::save()
     }
 }
 
-void SaveAllHelper::slotCanceled()
+void SaveAllHelper::slotProgressChanged()
 {
-    Q_FOREACH(DocumentJob * job, d->mJobSet) {
-        job->kill();
-    }
+    d->mProgressDialog->setValue(d->mScheduler->percent());
+    d->mProgressDialog->setLabelText(
+        i18nc("@info:progress saving all image changes, %1 and %2 are document counts",
+              "Saving... %1 of %2", d->mScheduler->savedCount(), d->mScheduler->totalCount()));
 }
 
-void SaveAllHelper::slotResult(KJob* _job)
+void SaveAllHelper::slotFailed(const QUrl& url, const QString& errorString)
 {
-    DocumentJob* job = static_cast<DocumentJob*>(_job);
-    if (job->error()) {
-        QUrl url = job->document()->url();
-        QString name = url.fileName().isEmpty() ? url.toDisplayString() : url.fileName();
-        d->mErrorList << xi18nc("@info %1 is the name of the document which failed to save, %2 is the reason for the failure",
-                                "<filename>%1</filename>: %2", name, job->errorString());
-    }
-    d->mJobSet.remove(job);
-    d->mProgressDialog->setValue(d->mProgressDialog->value() + 1);
+    QString name = url.fileName().isEmpty() ? url.toDisplayString() : url.fileName();
+    d->mErrorList << xi18nc("@info %1 is the name of the document which failed to save, %2 is the reason for the failure",
+                            "<filename>%1</filename>: %2", name, errorString);
 }
 
 } // namespace
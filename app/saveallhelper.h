@@ -28,7 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 
-class KJob;
+class QUrl;
 
 namespace Gwenview
 {
@@ -44,8 +44,8 @@ public:
     void save();
 
 private Q_SLOTS:
-    void slotCanceled();
-    void slotResult(KJob*);
+    void slotProgressChanged();
+    void slotFailed(const QUrl& url, const QString& errorString);
 
 private:
     SaveAllHelperPrivate* const d;
@@ -103,13 +103,16 @@ struct ThumbnailPagePrivate : public Ui_ThumbnailPage
 
     void setupDirModel()
     {
+        const MimeTypeUtils::Kinds kinds =
+            MimeTypeUtils::KIND_RASTER_IMAGE
+            | MimeTypeUtils::KIND_SVG_IMAGE
+            | MimeTypeUtils::KIND_VIDEO;
+
         mRecursiveDirModel = new RecursiveDirModel(q);
+        mRecursiveDirModel->setKindFilter(kinds);
 
         KindProxyModel* kindProxyModel = new KindProxyModel(q);
-        kindProxyModel->setKindFilter(
-            MimeTypeUtils::KIND_RASTER_IMAGE
-            | MimeTypeUtils::KIND_SVG_IMAGE
-            | MimeTypeUtils::KIND_VIDEO);
+        kindProxyModel->setKindFilter(kinds);
         kindProxyModel->setSourceModel(mRecursiveDirModel);
 
         QSortFilterProxyModel *sortModel = new QSortFilterProxyModel(q);
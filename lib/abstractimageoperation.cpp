@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "abstractimageoperation.h"
 
 // Qt
+#include <QUndoStack>
 #include <QUrl>
 
 // KDE
@@ -51,6 +52,11 @@ public:
         mOp->undo();
     }
 
+    const AbstractImageOperation* operation() const
+    {
+        return mOp;
+    }
+
 private:
     AbstractImageOperation* mOp;
 };
@@ -84,6 +90,18 @@ Document::Ptr AbstractImageOperation::document() const
     return doc;
 }
 
+int AbstractImageOperation::undoStackMemoryUsage(const QUndoStack* stack)
+{
+    int usage = 0;
+    for (int i = 0; i < stack->count(); ++i) {
+        const ImageOperationCommand* command = dynamic_cast<const ImageOperationCommand*>(stack->command(i));
+        if (command) {
+            usage += command->operation()->memoryUsage();
+        }
+    }
+    return usage;
+}
+
 void AbstractImageOperation::finish(bool ok)
 {
     if (ok) {
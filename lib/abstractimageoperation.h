@@ -58,6 +58,20 @@ public:
     void applyToDocument(Document::Ptr);
     Document::Ptr document() const;
 
+    /**
+     * Returns the number of bytes kept by the operation to be able to undo
+     * it
+     */
+    virtual int memoryUsage() const
+    {
+        return 0;
+    }
+
+    /**
+     * Returns the sum of memoryUsage() for the operations of stack
+     */
+    static int undoStackMemoryUsage(const QUndoStack* stack);
+
 protected:
     virtual void redo() = 0;
     virtual void undo()
@@ -0,0 +1,577 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "batcheditor.h"
+
+// Local
+#include <lib/document/document.h>
+#include <lib/document/documentfactory.h>
+#include <lib/gvdebug.h>
+#include <lib/gwenviewconfig.h>
+#include <lib/imageutils.h>
+#include <lib/jpegcontent.h>
+#include <lib/memoryutils.h>
+
+// KDE
+#include <KLocalizedString>
+
+// Qt
+#include <QAtomicInt>
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QPair>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QSizeF>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+/**
+ * Size of the thumbnail stored in re-encoded JPEG files, same as the one
+ * used when saving a document
+ */
+static const int JPEG_THUMBNAIL_SIZE = 128;
+
+/**
+ * Pool shared by all batches. It is not owned by BatchEditor so that
+ * destroying an editor does not have to wait for its workers: they finish
+ * the files they are writing in the background.
+ */
+static QThreadPool* workerPool()
+{
+    static QThreadPool* pool = 0;
+    if (!pool) {
+        pool = new QThreadPool(qApp);
+        // Decoding and encoding are CPU bound, and reading the next file
+        // while another one is being encoded keeps the disk busy: one worker
+        // per core is enough
+        pool->setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    }
+    return pool;
+}
+
+/**
+ * State shared by the workers of a batch. A new context is created each time
+ * start() is called, so that workers of a cancelled batch cannot affect the
+ * new one.
+ */
+struct BatchEditContext {
+    int mGeneration;
+    // Reset when the editor is destroyed, protected by mMutex
+    BatchEditor* mEditor;
+    QAtomicInt mCancelled;
+    QAtomicInt mRunningWorkers;
+    Orientation mTransformation;
+    qreal mScaleFactor;
+    Resampler::Filter mResizeFilter;
+    bool mApplyExifOrientation;
+    qint64 mMemoryBudget;
+
+    QMutex mMutex;
+    QWaitCondition mMemoryReleased;
+    QList<QUrl> mPendingUrls;
+    qint64 mMemoryInUse;
+
+    bool isCancelled() const
+    {
+        return mCancelled.load() != 0;
+    }
+
+    bool takeNext(QUrl* url)
+    {
+        QMutexLocker locker(&mMutex);
+        if (isCancelled() || mPendingUrls.isEmpty()) {
+            return false;
+        }
+        *url = mPendingUrls.takeFirst();
+        return true;
+    }
+
+    /**
+     * Blocks until bytes fit in the budget. A request is always granted when
+     * nothing else is in use, so that an image bigger than the budget is
+     * processed alone instead of blocking forever. Returns false if the batch
+     * has been cancelled while waiting.
+     */
+    bool acquireMemory(qint64 bytes)
+    {
+        QMutexLocker locker(&mMutex);
+        while (mMemoryInUse > 0 && mMemoryInUse + bytes > mMemoryBudget) {
+            if (isCancelled()) {
+                return false;
+            }
+            mMemoryReleased.wait(&mMutex);
+        }
+        mMemoryInUse += bytes;
+        return true;
+    }
+
+    void releaseMemory(qint64 bytes)
+    {
+        QMutexLocker locker(&mMutex);
+        mMemoryInUse -= bytes;
+        mMemoryReleased.wakeAll();
+    }
+
+    /**
+     * Replaces an amount acquired with acquireMemory() by another one,
+     * without waiting
+     */
+    void adjustMemory(qint64 acquiredBytes, qint64 bytes)
+    {
+        QMutexLocker locker(&mMutex);
+        mMemoryInUse += bytes - acquiredBytes;
+        mMemoryReleased.wakeAll();
+    }
+
+    void cancel()
+    {
+        QMutexLocker locker(&mMutex);
+        mCancelled.store(1);
+        mMemoryReleased.wakeAll();
+    }
+
+    /**
+     * Cancels the batch and stops reporting to the editor, which is being
+     * destroyed
+     */
+    void detach()
+    {
+        QMutexLocker locker(&mMutex);
+        mEditor = 0;
+        mCancelled.store(1);
+        mMemoryReleased.wakeAll();
+    }
+
+    void notifyFileDone(const QUrl& url, const QString& errorString)
+    {
+        QMutexLocker locker(&mMutex);
+        if (mEditor) {
+            QMetaObject::invokeMethod(mEditor, "slotFileDone", Qt::QueuedConnection,
+                                      Q_ARG(int, mGeneration),
+                                      Q_ARG(QUrl, url),
+                                      Q_ARG(QString, errorString));
+        }
+    }
+
+    void notifyWorkerFinished()
+    {
+        QMutexLocker locker(&mMutex);
+        if (mEditor) {
+            QMetaObject::invokeMethod(mEditor, "slotWorkerFinished", Qt::QueuedConnection,
+                                      Q_ARG(int, mGeneration));
+        }
+    }
+};
+
+typedef QSharedPointer<BatchEditContext> BatchEditContextPtr;
+
+struct BatchEditorPrivate {
+    Orientation mTransformation;
+    qreal mScaleFactor;
+    Resampler::Filter mResizeFilter;
+    qint64 mMemoryBudget;
+    BatchEditContextPtr mContext;
+    int mGeneration;
+    int mProcessedCount;
+    int mTotalCount;
+    QElapsedTimer mTimer;
+};
+
+class BatchEditorTask : public QRunnable
+{
+public:
+    BatchEditorTask(const BatchEditContextPtr& context)
+    : mContext(context)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        QUrl url;
+        while (mContext->takeNext(&url)) {
+            QString errorString;
+            if (!process(url, &errorString)) {
+                // Cancelled before the file was replaced: leave it alone
+                break;
+            }
+            mContext->notifyFileDone(url, errorString);
+        }
+        if (mContext->mRunningWorkers.fetchAndAddOrdered(-1) == 1) {
+            mContext->notifyWorkerFinished();
+        }
+    }
+
+private:
+    BatchEditContextPtr mContext;
+
+    /**
+     * Returns false if the batch was cancelled before the file has been
+     * replaced. Otherwise returns true and sets errorString if the file could
+     * not be processed.
+     */
+    bool process(const QUrl& url, QString* errorString)
+    {
+        LOG(url);
+        const QString path = url.toLocalFile();
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            *errorString = file.errorString();
+            return true;
+        }
+        const QByteArray data = file.readAll();
+        file.close();
+
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer);
+        const QByteArray format = reader.format();
+        if (format.isEmpty()) {
+            *errorString = i18nc("@info", "Unknown image format.");
+            return true;
+        }
+
+        // Lossless transformations only rearrange the compressed data, the
+        // other edits need the decoded image, possibly twice during a
+        // rotation, plus the resized copy
+        const bool lossless = format == "jpeg" && mContext->mScaleFactor == 1.;
+        QSize size = reader.size();
+        QImage image;
+        qint64 acquiredMemory = 0;
+        if (!lossless && !size.isValid()) {
+            // Some image plugins cannot tell the size without decoding the
+            // image. Hold the whole budget while decoding, so that the image
+            // is decoded alone, then keep only what it needs.
+            acquiredMemory = mContext->mMemoryBudget;
+            if (!mContext->acquireMemory(acquiredMemory)) {
+                return false;
+            }
+            if (!reader.read(&image)) {
+                mContext->releaseMemory(acquiredMemory);
+                *errorString = reader.errorString();
+                return true;
+            }
+            size = image.size();
+        }
+        const qint64 pixelCount = qint64(size.width()) * size.height();
+        qint64 memory = data.size() * 2;
+        if (!lossless) {
+            const qreal factor = mContext->mScaleFactor;
+            memory += pixelCount * 4 * 2 + qint64(pixelCount * factor * factor * 4);
+        }
+        if (acquiredMemory > 0) {
+            mContext->adjustMemory(acquiredMemory, memory);
+        } else if (!mContext->acquireMemory(memory)) {
+            return false;
+        }
+
+        QByteArray output;
+        if (lossless) {
+            *errorString = transformJpeg(data, &output);
+        } else {
+            *errorString = reencode(&reader, image, format, data, &output);
+        }
+        mContext->releaseMemory(memory);
+        if (!errorString->isEmpty()) {
+            return true;
+        }
+        if (mContext->isCancelled()) {
+            return false;
+        }
+
+        QSaveFile saveFile(path);
+        if (!saveFile.open(QIODevice::WriteOnly)
+            || saveFile.write(output) != output.size()
+            || !saveFile.commit()) {
+            *errorString = saveFile.errorString();
+        }
+        return true;
+    }
+
+    /**
+     * Like a document, files are saved with their Exif orientation applied
+     * to the pixels, if the user enabled it
+     */
+    Orientation exifOrientation(const JpegContent& content) const
+    {
+        if (!mContext->mApplyExifOrientation || content.orientation() == NOT_AVAILABLE) {
+            return NORMAL;
+        }
+        return content.orientation();
+    }
+
+    QString transformJpeg(const QByteArray& data, QByteArray* output) const
+    {
+        JpegContent content;
+        if (!content.loadFromData(data)) {
+            return i18nc("@info", "Could not read JPEG data.");
+        }
+        const Orientation orientation = exifOrientation(content);
+        content.transform(orientation);
+        content.transform(mContext->mTransformation);
+        content.resetOrientation();
+
+        const QImage thumbnail = content.thumbnail();
+        if (!thumbnail.isNull()) {
+            const QImage oriented = ImageUtils::transformed(thumbnail, orientation);
+            content.setThumbnail(ImageUtils::transformed(oriented, mContext->mTransformation));
+        }
+
+        QBuffer buffer(output);
+        buffer.open(QIODevice::WriteOnly);
+        if (!content.save(&buffer)) {
+            return content.errorString();
+        }
+        return QString();
+    }
+
+    /**
+     * @param image the decoded image, or a null image to decode it from
+     * reader
+     */
+    QString reencode(QImageReader* reader, QImage image, const QByteArray& format, const QByteArray& data, QByteArray* output) const
+    {
+        if (image.isNull() && !reader->read(&image)) {
+            return reader->errorString();
+        }
+
+        QScopedPointer<JpegContent> content;
+        if (format == "jpeg") {
+            content.reset(new JpegContent);
+            if (!content->loadFromData(data)) {
+                return i18nc("@info", "Could not read JPEG data.");
+            }
+            image = ImageUtils::transformed(image, exifOrientation(*content));
+        }
+
+        image = ImageUtils::transformed(image, mContext->mTransformation);
+        if (mContext->mScaleFactor != 1.) {
+            const QSize size = (QSizeF(image.size()) * mContext->mScaleFactor).toSize().expandedTo(QSize(1, 1));
+            image = Resampler::scaled(image, size, mContext->mResizeFilter);
+        }
+
+        QBuffer buffer(output);
+        buffer.open(QIODevice::WriteOnly);
+        if (content) {
+            content->setImage(image);
+            if (!content->thumbnail().isNull()) {
+                content->setThumbnail(image.scaled(JPEG_THUMBNAIL_SIZE, JPEG_THUMBNAIL_SIZE, Qt::KeepAspectRatio));
+            }
+            if (!content->save(&buffer)) {
+                return content->errorString();
+            }
+            return QString();
+        }
+
+        QImageWriter writer(&buffer, format);
+        if (!writer.canWrite()) {
+            return i18nc("@info", "Gwenview cannot save this kind of images.");
+        }
+        if (!writer.write(image)) {
+            return writer.errorString();
+        }
+        return QString();
+    }
+};
+
+BatchEditor::BatchEditor(QObject* parent)
+: QObject(parent)
+, d(new BatchEditorPrivate)
+{
+    d->mTransformation = NORMAL;
+    d->mScaleFactor = 1.;
+    d->mResizeFilter = Resampler::Lanczos3;
+    d->mMemoryBudget = qint64(MemoryUtils::getTotalMemory() / 4);
+    d->mGeneration = 0;
+    d->mProcessedCount = 0;
+    d->mTotalCount = 0;
+}
+
+BatchEditor::~BatchEditor()
+{
+    // Do not wait for the workers, they finish in the background
+    if (d->mContext) {
+        d->mContext->detach();
+    }
+    delete d;
+}
+
+void BatchEditor::setTransformation(Orientation orientation)
+{
+    d->mTransformation = orientation;
+}
+
+void BatchEditor::setScaleFactor(qreal factor)
+{
+    GV_RETURN_IF_FAIL(factor > 0);
+    d->mScaleFactor = factor;
+}
+
+void BatchEditor::setResizeFilter(Resampler::Filter filter)
+{
+    d->mResizeFilter = filter;
+}
+
+void BatchEditor::setMemoryBudget(qint64 budget)
+{
+    d->mMemoryBudget = budget;
+}
+
+void BatchEditor::start(const QList<QUrl>& urls)
+{
+    GV_RETURN_IF_FAIL(!isRunning());
+    ++d->mGeneration;
+    d->mProcessedCount = 0;
+    d->mTotalCount = urls.count();
+    d->mTimer.start();
+
+    BatchEditContextPtr context(new BatchEditContext);
+    context->mGeneration = d->mGeneration;
+    context->mEditor = this;
+    context->mTransformation = d->mTransformation;
+    context->mScaleFactor = d->mScaleFactor;
+    context->mResizeFilter = d->mResizeFilter;
+    // Read the config here, in the GUI thread
+    context->mApplyExifOrientation = GwenviewConfig::applyExifOrientation();
+    context->mMemoryBudget = d->mMemoryBudget;
+    context->mMemoryInUse = 0;
+
+    QList<QPair<QUrl, QString> > rejected;
+    Q_FOREACH(const QUrl& url, urls) {
+        if (!url.isLocalFile()) {
+            rejected << qMakePair(url, i18nc("@info", "Only local files can be edited in batch."));
+            continue;
+        }
+        Document::Ptr doc = DocumentFactory::instance()->getCachedDocument(url);
+        if (doc && doc->isModified()) {
+            rejected << qMakePair(url, i18nc("@info", "The image has unsaved changes."));
+            continue;
+        }
+        context->mPendingUrls << url;
+    }
+
+    // Report rejected files through the same path as processed ones, so that
+    // signals are always emitted after start() returns. They are queued
+    // before the workers start, so they cannot arrive after finished().
+    typedef QPair<QUrl, QString> Rejection;
+    Q_FOREACH(const Rejection& rejection, rejected) {
+        QMetaObject::invokeMethod(this, "slotFileDone", Qt::QueuedConnection,
+                                  Q_ARG(int, d->mGeneration),
+                                  Q_ARG(QUrl, rejection.first),
+                                  Q_ARG(QString, rejection.second));
+    }
+
+    const int workerCount = qMin(workerPool()->maxThreadCount(), context->mPendingUrls.count());
+    context->mRunningWorkers.store(workerCount);
+    d->mContext = context;
+    for (int i = 0; i < workerCount; ++i) {
+        workerPool()->start(new BatchEditorTask(context));
+    }
+    if (workerCount == 0) {
+        QMetaObject::invokeMethod(this, "slotWorkerFinished", Qt::QueuedConnection,
+                                  Q_ARG(int, d->mGeneration));
+    }
+}
+
+void BatchEditor::cancel()
+{
+    if (!d->mContext) {
+        return;
+    }
+    d->mContext->cancel();
+}
+
+bool BatchEditor::isRunning() const
+{
+    return !d->mContext.isNull();
+}
+
+int BatchEditor::processedCount() const
+{
+    return d->mProcessedCount;
+}
+
+int BatchEditor::totalCount() const
+{
+    return d->mTotalCount;
+}
+
+qreal BatchEditor::throughput() const
+{
+    if (!d->mTimer.isValid()) {
+        return 0;
+    }
+    const qint64 elapsed = qMax(qint64(1), d->mTimer.elapsed());
+    return d->mProcessedCount * 1000. / elapsed;
+}
+
+void BatchEditor::slotFileDone(int generation, const QUrl& url, const QString& errorString)
+{
+    if (generation != d->mGeneration) {
+        return;
+    }
+    ++d->mProcessedCount;
+    if (errorString.isEmpty()) {
+        // Do not let a cached document show the old content
+        Document::Ptr doc = DocumentFactory::instance()->getCachedDocument(url);
+        if (doc && !doc->isModified()) {
+            doc->reload();
+        }
+    } else {
+        emit failed(url, errorString);
+    }
+    emit progressChanged(d->mProcessedCount, d->mTotalCount);
+}
+
+void BatchEditor::slotWorkerFinished(int generation)
+{
+    if (generation != d->mGeneration) {
+        return;
+    }
+    LOG("Processed" << d->mProcessedCount << "files," << throughput() << "files/s");
+    d->mContext.clear();
+    emit finished();
+}
+
+} // namespace
@@ -0,0 +1,128 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef BATCHEDITOR_H
+#define BATCHEDITOR_H
+
+// Local
+#include <lib/gwenviewlib_export.h>
+#include <lib/orientation.h>
+#include <lib/resampler.h>
+
+// Qt
+#include <QList>
+#include <QObject>
+#include <QUrl>
+
+namespace Gwenview
+{
+
+struct BatchEditorPrivate;
+/**
+ * Applies the same edit to a list of local image files, outside of the
+ * document cache.
+ *
+ * Files are streamed through a fixed-size pool of worker threads, each file
+ * being read, decoded, transformed, encoded and atomically replaced on disk
+ * before the next one is taken. The number of files in flight is bounded by
+ * the number of cores and by a memory budget, so that editing a large
+ * selection never holds more than a few decoded images at once.
+ *
+ * JPEG files which only need a transformation are rotated or flipped
+ * losslessly, without decoding them.
+ *
+ * Documents already present in DocumentFactory are reloaded once their file
+ * has been replaced. Files whose document has unsaved changes are skipped.
+ */
+class GWENVIEWLIB_EXPORT BatchEditor : public QObject
+{
+    Q_OBJECT
+public:
+    BatchEditor(QObject* parent = 0);
+    /**
+     * Cancels processing without waiting for the workers: files which are
+     * being written are finished in the background
+     */
+    ~BatchEditor();
+
+    /**
+     * Transformation to apply to each image, defaults to NORMAL
+     */
+    void setTransformation(Orientation);
+
+    /**
+     * Factor by which the width and height of each image are multiplied,
+     * defaults to 1 (no resizing)
+     */
+    void setScaleFactor(qreal);
+
+    /**
+     * Filter used when resizing, defaults to Resampler::Lanczos3
+     */
+    void setResizeFilter(Resampler::Filter);
+
+    /**
+     * Maximum amount of memory, in bytes, used by the images being processed
+     * at the same time. Defaults to a quarter of the installed memory. A file
+     * which needs more than the budget is still processed, but alone.
+     */
+    void setMemoryBudget(qint64);
+
+    /**
+     * Starts processing urls. Must not be called while running.
+     */
+    void start(const QList<QUrl>& urls);
+
+    /**
+     * Stops processing: files which are being written are finished, the
+     * others are left untouched. finished() is emitted once the workers are
+     * done.
+     */
+    void cancel();
+
+    bool isRunning() const;
+
+    int processedCount() const;
+
+    int totalCount() const;
+
+    /**
+     * Number of files processed per second since start() was called
+     */
+    qreal throughput() const;
+
+Q_SIGNALS:
+    void progressChanged(int processed, int total);
+
+    void failed(const QUrl& url, const QString& errorString);
+
+    void finished();
+
+private Q_SLOTS:
+    void slotFileDone(int generation, const QUrl& url, const QString& errorString);
+    void slotWorkerFinished(int generation);
+
+private:
+    BatchEditorPrivate* const d;
+};
+
+} // namespace
+
+#endif /* BATCHEDITOR_H */
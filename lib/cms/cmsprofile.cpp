@@ -37,6 +37,8 @@ extern "C" {
 // Qt
 #include <QBuffer>
 #include <QDebug>
+#include <QGuiApplication>
+#include <QMutex>
 #include <QtGlobal>
 
 // lcms
@@ -103,6 +105,7 @@ static cmsHPROFILE loadFromJpegData(const QByteArray& data)
 struct ProfilePrivate
 {
     cmsHPROFILE mProfile;
+    QByteArray mId;
 
     void reset()
     {
@@ -186,6 +189,18 @@ cmsHPROFILE Profile::handle() const
     return d->mProfile;
 }
 
+QByteArray Profile::id() const
+{
+    GV_RETURN_VALUE_IF_FAIL(d->mProfile, QByteArray());
+    if (d->mId.isEmpty()) {
+        // Most profiles do not store their ID in their header, compute it
+        cmsMD5computeID(d->mProfile);
+        d->mId.resize(16);
+        cmsGetHeaderProfileID(d->mProfile, reinterpret_cast<cmsUInt8Number*>(d->mId.data()));
+    }
+    return d->mId;
+}
+
 QString Profile::copyright() const
 {
     return d->readInfo(cmsInfoCopyright);
@@ -206,7 +221,7 @@ QString Profile::model() const
     return d->readInfo(cmsInfoModel);
 }
 
-Profile::Ptr Profile::getMonitorProfile()
+Profile::Ptr Profile::loadMonitorProfile()
 {
     cmsHPROFILE hProfile = 0;
     // Get the profile from you config file if the user has set it.
@@ -247,9 +262,63 @@ Profile::Ptr Profile::getMonitorProfile()
     return Profile::Ptr(new Profile(hProfile));
 }
 
+struct ProfileCache
+{
+    ProfileCache()
+    : mScreenWatchInstalled(false)
+    {}
+
+    Profile::Ptr mMonitorProfile;
+    QMutex mSRgbMutex;
+    Profile::Ptr mSRgbProfile;
+    bool mScreenWatchInstalled;
+
+    void installScreenWatch()
+    {
+        if (mScreenWatchInstalled || !qGuiApp) {
+            return;
+        }
+        mScreenWatchInstalled = true;
+        auto invalidate = [] {
+            Profile::invalidateMonitorProfile();
+        };
+        QObject::connect(qGuiApp, &QGuiApplication::screenAdded, qGuiApp, invalidate);
+        QObject::connect(qGuiApp, &QGuiApplication::screenRemoved, qGuiApp, invalidate);
+        QObject::connect(qGuiApp, &QGuiApplication::primaryScreenChanged, qGuiApp, invalidate);
+    }
+};
+
+Q_GLOBAL_STATIC(ProfileCache, profileCache)
+
+Profile::Ptr Profile::getMonitorProfile()
+{
+    ProfileCache* cache = profileCache;
+    if (!cache->mMonitorProfile) {
+        LOG("Loading monitor profile");
+        cache->mMonitorProfile = loadMonitorProfile();
+        cache->installScreenWatch();
+    }
+    return cache->mMonitorProfile;
+}
+
+void Profile::invalidateMonitorProfile()
+{
+    profileCache->mMonitorProfile.reset();
+}
+
 Profile::Ptr Profile::getSRgbProfile()
 {
-    return Profile::Ptr(new Profile(cmsCreate_sRGBProfile()));
+    // Unlike the monitor profile, the sRGB profile is also used by thumbnail
+    // generators, from their threads
+    ProfileCache* cache = profileCache;
+    QMutexLocker locker(&cache->mSRgbMutex);
+    if (!cache->mSRgbProfile) {
+        cache->mSRgbProfile = new Profile(cmsCreate_sRGBProfile());
+        // Compute the id now, so that calling id() later from any thread
+        // does not modify the profile
+        cache->mSRgbProfile->id();
+    }
+    return cache->mSRgbProfile;
 }
 
 } // namespace Cms
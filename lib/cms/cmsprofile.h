@@ -62,13 +62,27 @@ public:
 
     cmsHPROFILE handle() const;
 
+    /**
+     * Returns the MD5 of the profile, computed on first call. Two profiles
+     * with the same id are identical.
+     */
+    QByteArray id() const;
+
     static Profile::Ptr loadFromImageData(const QByteArray& data, const QByteArray& format);
     static Profile::Ptr loadFromExiv2Image(const Exiv2::Image* image);
+
+    /**
+     * Returns the profile of the monitor. It is read once, then cached until
+     * the screen configuration changes or invalidateMonitorProfile() is
+     * called. Must be called from the GUI thread.
+     */
     static Profile::Ptr getMonitorProfile();
+    static void invalidateMonitorProfile();
     static Profile::Ptr getSRgbProfile();
 
 private:
     Profile(cmsHPROFILE);
+    static Profile::Ptr loadMonitorProfile();
     ProfilePrivate* const d;
 };
 
@@ -0,0 +1,199 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "cmstransform.h"
+
+// Local
+#include <gvdebug.h>
+#include <parallelutils.h>
+
+// Qt
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+
+// lcms
+#include <lcms2.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) //qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace Cms
+{
+
+/**
+ * Maximum number of cached transforms. Transforms are small, but there is
+ * usually one per pair of source and target profiles, so there is no need
+ * to keep many of them.
+ */
+static const int MAX_CACHED_TRANSFORMS = 16;
+
+static const cmsUInt32Number INTENT = INTENT_PERCEPTUAL;
+
+/**
+ * Transforming a stripe of pixels on a worker thread only pays off if the
+ * stripe is large enough.
+ */
+static const int MIN_PIXELS_PER_STRIPE = 64 * 1024;
+
+struct TransformCache
+{
+    QMutex mMutex;
+    QHash<QByteArray, Transform::Ptr> mTransforms;
+    // Keys of mTransforms, oldest first
+    QQueue<QByteArray> mKeys;
+
+    Transform::Ptr find(const QByteArray& key) const
+    {
+        return mTransforms.value(key);
+    }
+
+    void insert(const QByteArray& key, const Transform::Ptr& transform)
+    {
+        if (mKeys.count() >= MAX_CACHED_TRANSFORMS) {
+            mTransforms.remove(mKeys.dequeue());
+        }
+        mKeys.enqueue(key);
+        mTransforms.insert(key, transform);
+    }
+};
+
+Q_GLOBAL_STATIC(TransformCache, transformCache)
+
+Transform::Transform(cmsHTRANSFORM transform, int bytesPerPixel)
+: mTransform(transform)
+, mBytesPerPixel(bytesPerPixel)
+{
+}
+
+Transform::~Transform()
+{
+    if (mTransform) {
+        cmsDeleteTransform(mTransform);
+    }
+}
+
+cmsHTRANSFORM Transform::handle() const
+{
+    return mTransform;
+}
+
+void Transform::apply(uchar* bits, int width, int height, int bytesPerLine) const
+{
+    GV_RETURN_IF_FAIL(mTransform);
+    GV_RETURN_IF_FAIL(width > 0);
+    const bool contiguous = bytesPerLine == width * mBytesPerPixel;
+    const cmsHTRANSFORM transform = mTransform;
+    ParallelUtils::forEachRowStripe(height, MIN_PIXELS_PER_STRIPE / width, [=](int begin, int end) {
+        uchar* stripe = bits + begin * bytesPerLine;
+        if (contiguous) {
+            cmsDoTransform(transform, stripe, stripe, width * (end - begin));
+            return;
+        }
+        // Lines are padded, transform them one by one
+        for (int y = begin; y < end; ++y, stripe += bytesPerLine) {
+            cmsDoTransform(transform, stripe, stripe, width);
+        }
+    });
+}
+
+Transform::Ptr Transform::displayTransform(const Profile::Ptr& profile, QImage::Format format)
+{
+    Profile::Ptr monitorProfile = Profile::getMonitorProfile();
+    GV_RETURN_VALUE_IF_FAIL(monitorProfile, Ptr());
+    return cachedTransform(profile, monitorProfile, format);
+}
+
+Transform::Ptr Transform::sRgbTransform(const Profile::Ptr& profile, QImage::Format format)
+{
+    Profile::Ptr sRgbProfile = Profile::getSRgbProfile();
+    GV_RETURN_VALUE_IF_FAIL(profile, Ptr());
+    if (profile->id() == sRgbProfile->id()) {
+        return Ptr();
+    }
+    return cachedTransform(profile, sRgbProfile, format);
+}
+
+Transform::Ptr Transform::cachedTransform(const Profile::Ptr& profile, const Profile::Ptr& targetProfile, QImage::Format format)
+{
+    GV_RETURN_VALUE_IF_FAIL(profile, Ptr());
+    cmsUInt32Number cmsFormat = 0;
+    int bytesPerPixel = 0;
+    switch (format) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+        cmsFormat = TYPE_BGRA_8;
+        bytesPerPixel = 4;
+        break;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+    case QImage::Format_Grayscale8:
+        cmsFormat = TYPE_GRAY_8;
+        bytesPerPixel = 1;
+        break;
+#endif
+    default:
+        qWarning() << "Gwenview can only apply color profile on RGB32 or ARGB32 images";
+        return Ptr();
+    }
+
+    QByteArray key = profile->id() + targetProfile->id();
+    key += QByteArray::number(cmsFormat) + '/' + QByteArray::number(INTENT);
+
+    TransformCache* cache = transformCache;
+    // Keep the lock while creating the transform: lcms profiles must not be
+    // read from several threads at once
+    QMutexLocker locker(&cache->mMutex);
+    Ptr transform = cache->find(key);
+    if (transform) {
+        return transform;
+    }
+    LOG("Creating transform for" << profile->description() << "to" << targetProfile->description());
+    // For 8 bit formats, lcms precalculates the whole pipeline as a device
+    // link LUT sampled with tetrahedral interpolation, so creating the
+    // transform is expensive but applying it is not.
+    // cmsFLAGS_NOCACHE is required to call cmsDoTransform() from several
+    // threads at once: the one pixel cache is not thread-safe.
+    cmsHTRANSFORM hTransform = cmsCreateTransform(profile->handle(), cmsFormat,
+                                                  targetProfile->handle(), cmsFormat,
+                                                  INTENT,
+                                                  cmsFLAGS_BLACKPOINTCOMPENSATION | cmsFLAGS_NOCACHE);
+    if (!hTransform) {
+        qWarning() << "Could not create color transform";
+        return Ptr();
+    }
+    transform = new Transform(hTransform, bytesPerPixel);
+    cache->insert(key, transform);
+    return transform;
+}
+
+} // namespace Cms
+
+} // namespace Gwenview
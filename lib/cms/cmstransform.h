@@ -0,0 +1,89 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef CMSTRANSFORM_H
+#define CMSTRANSFORM_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Local
+#include <lib/cms/cmsprofile.h>
+
+// Qt
+#include <QExplicitlySharedDataPointer>
+#include <QImage>
+#include <QSharedData>
+
+typedef void* cmsHTRANSFORM;
+
+namespace Gwenview
+{
+
+namespace Cms
+{
+
+/**
+ * Wrapper for lcms color transform
+ */
+class GWENVIEWLIB_EXPORT Transform : public QSharedData
+{
+public:
+    typedef QExplicitlySharedDataPointer<Transform> Ptr;
+
+    ~Transform();
+
+    cmsHTRANSFORM handle() const;
+
+    /**
+     * Transforms the pixels of an image in place. bits must point to height
+     * lines of width pixels, in the format the transform was created for.
+     * Large images are processed in stripes on several threads.
+     */
+    void apply(uchar* bits, int width, int height, int bytesPerLine) const;
+
+    /**
+     * Returns a transform converting images of the given format from
+     * profile to the monitor profile, or a null pointer if the format is not
+     * supported.
+     *
+     * Creating a transform is expensive, so transforms are cached: calling
+     * this function again with an identical profile, for example for each
+     * rect of a document, is cheap. Must be called from the GUI thread.
+     */
+    static Ptr displayTransform(const Profile::Ptr& profile, QImage::Format format);
+
+    /**
+     * Returns a cached transform converting images of the given format from
+     * profile to sRGB, or a null pointer if the format is not supported or
+     * profile is already sRGB. Can be called from any thread.
+     */
+    static Ptr sRgbTransform(const Profile::Ptr& profile, QImage::Format format);
+
+private:
+    Transform(cmsHTRANSFORM, int bytesPerPixel);
+    static Ptr cachedTransform(const Profile::Ptr& profile, const Profile::Ptr& targetProfile, QImage::Format format);
+    cmsHTRANSFORM mTransform;
+    int mBytesPerPixel;
+};
+
+} // namespace Cms
+} // namespace Gwenview
+
+#endif /* CMSTRANSFORM_H */
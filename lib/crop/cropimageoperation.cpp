@@ -32,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "document/document.h"
 #include "document/documentjob.h"
 #include "document/abstractdocumenteditor.h"
+#include "imageundodata.h"
 
 namespace Gwenview
 {
@@ -39,8 +40,9 @@ namespace Gwenview
 class CropJob : public ThreadedDocumentJob
 {
 public:
-    CropJob(const QRect& rect)
+    CropJob(const QRect& rect, ImageUndoData* undoData)
         : mRect(rect)
+        , mUndoData(undoData)
     {}
 
     void threadedStart() Q_DECL_OVERRIDE
@@ -50,18 +52,22 @@ public:
         }
         const QImage src = document()->image();
         const QImage dst = src.copy(mRect);
-        document()->editor()->setImage(dst);
+        // Only the pixels outside of the crop rect need to be kept for undo
+        mUndoData->store(src, dst, mRect.topLeft());
+        // Lets JPEG documents crop without recompressing the image
+        document()->editor()->crop(mRect, dst);
         setError(NoError);
     }
 
 private:
     QRect mRect;
+    ImageUndoData* mUndoData;
 };
 
 struct CropImageOperationPrivate
 {
     QRect mRect;
-    QImage mOriginalImage;
+    ImageUndoData mUndoData;
 };
 
 CropImageOperation::CropImageOperation(const QRect& rect)
@@ -78,8 +84,7 @@ CropImageOperation::~CropImageOperation()
 
 void CropImageOperation::redo()
 {
-    d->mOriginalImage = document()->image();
-    redoAsDocumentJob(new CropJob(d->mRect));
+    redoAsDocumentJob(new CropJob(d->mRect, &d->mUndoData));
 }
 
 void CropImageOperation::undo()
@@ -88,7 +93,12 @@ void CropImageOperation::undo()
         qWarning() << "!document->editor()";
         return;
     }
-    document()->editor()->setImage(d->mOriginalImage);
+    document()->editor()->setImage(d->mUndoData.restore(document()->image()));
+}
+
+int CropImageOperation::memoryUsage() const
+{
+    return d->mUndoData.memoryUsage();
 }
 
 } // namespace
@@ -44,6 +44,7 @@ public:
 
     virtual void redo() Q_DECL_OVERRIDE;
     virtual void undo() Q_DECL_OVERRIDE;
+    virtual int memoryUsage() const Q_DECL_OVERRIDE;
 
 private:
     CropImageOperationPrivate* const d;
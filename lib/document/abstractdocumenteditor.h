@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/orientation.h>
 
 class QImage;
+class QRect;
 
 namespace Gwenview
 {
@@ -64,6 +65,19 @@ public:
      * AbstractImageOperation and applied through Document::undoStack().
      */
     virtual void applyTransformation(Orientation) = 0;
+
+    /**
+     * Crops the document image to rect. croppedImage must be the current
+     * image cropped to rect: implementations which cannot crop in a
+     * lossless way just call setImage() with it.
+     *
+     * This method should only be called from a subclass of
+     * AbstractImageOperation and applied through Document::undoStack().
+     */
+    virtual void crop(const QRect& /*rect*/, const QImage& croppedImage)
+    {
+        setImage(croppedImage);
+    }
 };
 
 } // namespace
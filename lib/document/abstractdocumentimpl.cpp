@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Local
 #include "document.h"
+#include "document_p.h"
 
 namespace Gwenview
 {
@@ -57,9 +58,14 @@ void AbstractDocumentImpl::switchToImpl(AbstractDocumentImpl*  impl)
     d->mDocument->switchToImpl(impl);
 }
 
-void AbstractDocumentImpl::setDocumentImage(const QImage& image)
+void AbstractDocumentImpl::setDocumentImage(const QImage& image, Orientation orientation)
 {
-    d->mDocument->setImageInternal(image);
+    d->mDocument->setImageInternal(image, orientation);
+}
+
+void AbstractDocumentImpl::setDocumentImageOrientation(Orientation orientation)
+{
+    d->mDocument->setImageOrientation(orientation);
 }
 
 void AbstractDocumentImpl::setDocumentImageSize(const QSize& size)
@@ -77,9 +83,9 @@ void AbstractDocumentImpl::setDocumentKind(MimeTypeUtils::Kind kind)
     d->mDocument->setKind(kind);
 }
 
-void AbstractDocumentImpl::setDocumentExiv2Image(Exiv2::Image::AutoPtr image)
+void AbstractDocumentImpl::setDocumentExiv2Image(Exiv2::Image::AutoPtr image, const QByteArray& fullMetaInfoData)
 {
-    d->mDocument->setExiv2Image(image);
+    d->mDocument->setExiv2Image(image, fullMetaInfoData);
 }
 
 void AbstractDocumentImpl::setDocumentDownSampledImage(const QImage& image, int invertedZoom)
@@ -87,6 +93,11 @@ void AbstractDocumentImpl::setDocumentDownSampledImage(const QImage& image, int
     d->mDocument->setDownSampledImage(image, invertedZoom);
 }
 
+int AbstractDocumentImpl::documentRequestedInvertedZoom() const
+{
+    return d->mDocument->d->mRequestedInvertedZoom;
+}
+
 void AbstractDocumentImpl::setDocumentErrorString(const QString& string)
 {
     d->mDocument->setErrorString(string);
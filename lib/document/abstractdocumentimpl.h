@@ -95,6 +95,15 @@ public:
         return 0;
     }
 
+    /**
+     * Returns how much bytes the implementation uses on top of the document
+     * image and raw data. Emit memoryUsageChanged() when it grows.
+     */
+    virtual int memoryUsage() const
+    {
+        return 0;
+    }
+
 Q_SIGNALS:
     void imageRectUpdated(const QRect&);
     void metaInfoLoaded();
@@ -102,14 +111,35 @@ Q_SIGNALS:
     void loadingFailed();
     void isAnimatedUpdated();
     void editorUpdated();
+    void memoryUsageChanged();
 
 protected:
-    void setDocumentImage(const QImage& image);
+    /**
+     * @param orientation the orientation which has not been applied to image
+     * yet, see Document::imageOrientation()
+     */
+    void setDocumentImage(const QImage& image, Orientation orientation = NORMAL);
     void setDocumentImageSize(const QSize& size);
+    /**
+     * Sets the orientation of the pixels which are going to be loaded, must
+     * be called before any image or down sampled image is set
+     */
+    void setDocumentImageOrientation(Orientation);
     void setDocumentKind(MimeTypeUtils::Kind);
     void setDocumentFormat(const QByteArray& format);
-    void setDocumentExiv2Image(Exiv2::Image::AutoPtr);
+    /**
+     * If fullMetaInfoData is set, image only contains the metadata needed to
+     * display the document, the complete metadata is read from
+     * fullMetaInfoData when Document::metaInfo() is first called.
+     */
+    void setDocumentExiv2Image(Exiv2::Image::AutoPtr, const QByteArray& fullMetaInfoData = QByteArray());
     void setDocumentDownSampledImage(const QImage&, int invertedZoom);
+    /**
+     * Returns the invertedZoom of the down sampled image the views asked for
+     * since the document image was last set, or 1 if they did not ask for
+     * any
+     */
+    int documentRequestedInvertedZoom() const;
     void setDocumentCmsProfile(Cms::Profile::Ptr profile);
     void setDocumentErrorString(const QString&);
     void switchToImpl(AbstractDocumentImpl*  impl);
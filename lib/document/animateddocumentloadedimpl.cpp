@@ -21,24 +21,38 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Self
 #include "animateddocumentloadedimpl.h"
 
+// STL
+#include <limits>
+
 // Qt
-#include <QBuffer>
 #include <QImage>
-#include <QMovie>
+#include <QTimer>
 #include <QDebug>
 
 // KDE
 
 // Local
+#include "animatedframedecoder.h"
 
 namespace Gwenview
 {
 
+/**
+ * Minimum delay between two frames, in milliseconds. Some animations use 0,
+ * which would keep a core busy.
+ */
+static const int MIN_FRAME_DELAY = 10;
+
 struct AnimatedDocumentLoadedImplPrivate
 {
     QByteArray mRawData;
-    QBuffer mMovieBuffer;
-    QMovie mMovie;
+    AnimatedFrameDecoder* mDecoder;
+    QTimer mTimer;
+    int mNextFrame;
+    int mLoopsDone;
+    int mReportedMemoryUsage;
+    bool mPlaying;
+    bool mWaitingForFrame;
 };
 
 AnimatedDocumentLoadedImpl::AnimatedDocumentLoadedImpl(Document* document, const QByteArray& rawData)
@@ -46,16 +60,21 @@ AnimatedDocumentLoadedImpl::AnimatedDocumentLoadedImpl(Document* document, const
 , d(new AnimatedDocumentLoadedImplPrivate)
 {
     d->mRawData = rawData;
-
-    connect(&d->mMovie, &QMovie::frameChanged, this, &AnimatedDocumentLoadedImpl::slotFrameChanged);
-
-    d->mMovieBuffer.setBuffer(&d->mRawData);
-    d->mMovieBuffer.open(QIODevice::ReadOnly);
-    d->mMovie.setDevice(&d->mMovieBuffer);
+    d->mDecoder = new AnimatedFrameDecoder(rawData);
+    d->mNextFrame = 0;
+    d->mLoopsDone = 0;
+    d->mReportedMemoryUsage = 0;
+    d->mPlaying = false;
+    d->mWaitingForFrame = false;
+
+    d->mTimer.setSingleShot(true);
+    connect(&d->mTimer, &QTimer::timeout, this, &AnimatedDocumentLoadedImpl::showNextFrame);
+    connect(d->mDecoder, &AnimatedFrameDecoder::frameDecoded, this, &AnimatedDocumentLoadedImpl::slotFrameDecoded);
 }
 
 AnimatedDocumentLoadedImpl::~AnimatedDocumentLoadedImpl()
 {
+    delete d->mDecoder;
     delete d;
 }
 
@@ -81,11 +100,72 @@ QByteArray AnimatedDocumentLoadedImpl::rawData() const
     return d->mRawData;
 }
 
-void AnimatedDocumentLoadedImpl::slotFrameChanged(int /*frameNumber*/)
+void AnimatedDocumentLoadedImpl::showNextFrame()
 {
-    QImage image = d->mMovie.currentImage();
-    setDocumentImage(image);
-    emit imageRectUpdated(image.rect());
+    if (!d->mPlaying) {
+        return;
+    }
+    const int frameCount = d->mDecoder->frameCount();
+    if (frameCount == 0) {
+        // Decoding failed
+        d->mPlaying = false;
+        return;
+    }
+    if (frameCount > 0 && d->mNextFrame >= frameCount) {
+        d->mNextFrame = 0;
+        ++d->mLoopsDone;
+        const int loopCount = d->mDecoder->loopCount();
+        if (loopCount >= 0 && d->mLoopsDone > loopCount) {
+            d->mPlaying = false;
+            return;
+        }
+    }
+
+    // Read the requested zoom before setting the image, since setting the
+    // image resets it
+    const int invertedZoom = documentRequestedInvertedZoom();
+    d->mDecoder->setInvertedZoom(invertedZoom);
+
+    AnimatedFrame frame;
+    if (!d->mDecoder->takeFrame(d->mNextFrame, &frame)) {
+        d->mWaitingForFrame = true;
+        return;
+    }
+    d->mWaitingForFrame = false;
+
+    setDocumentImage(frame.image);
+    if (invertedZoom > 1) {
+        // Give the views the down sampled image they used for the previous
+        // frame, so that they do not have to wait for it
+        if (frame.invertedZoom != invertedZoom) {
+            frame.downSampledImage = frame.image.scaled(frame.image.size() / invertedZoom, Qt::KeepAspectRatio, Qt::FastTransformation);
+            d->mDecoder->updateDownSampledImage(d->mNextFrame, frame.downSampledImage, invertedZoom);
+        }
+        if (!frame.downSampledImage.size().isEmpty()) {
+            setDocumentDownSampledImage(frame.downSampledImage, invertedZoom);
+        }
+    }
+    emit imageRectUpdated(frame.image.rect());
+
+    ++d->mNextFrame;
+    d->mTimer.start(qMax(frame.delay, MIN_FRAME_DELAY));
+}
+
+void AnimatedDocumentLoadedImpl::slotFrameDecoded()
+{
+    const int usage = memoryUsage();
+    if (usage > d->mReportedMemoryUsage) {
+        d->mReportedMemoryUsage = usage;
+        emit memoryUsageChanged();
+    }
+    if (d->mWaitingForFrame) {
+        showNextFrame();
+    }
+}
+
+int AnimatedDocumentLoadedImpl::memoryUsage() const
+{
+    return int(qMin(d->mDecoder->memoryUsage(), qint64(std::numeric_limits<int>::max())));
 }
 
 bool AnimatedDocumentLoadedImpl::isAnimated() const
@@ -95,18 +175,22 @@ bool AnimatedDocumentLoadedImpl::isAnimated() const
 
 void AnimatedDocumentLoadedImpl::startAnimation()
 {
-    d->mMovie.start();
-    if (d->mMovie.state() == QMovie::NotRunning) {
-        // This is true with qt-copy as of 2008.08.23
-        //qDebug() << "QMovie didn't start. This can happen in some cases when starting for the second time.";
-        //qDebug() << "Trying to start again, it usually fixes the bug.";
-        d->mMovie.start();
+    if (!d->mDecoder->isRunning()) {
+        d->mDecoder->start(QThread::LowPriority);
+    }
+    if (d->mPlaying) {
+        return;
     }
+    d->mPlaying = true;
+    d->mLoopsDone = 0;
+    showNextFrame();
 }
 
 void AnimatedDocumentLoadedImpl::stopAnimation()
 {
-    d->mMovie.stop();
+    d->mPlaying = false;
+    d->mWaitingForFrame = false;
+    d->mTimer.stop();
 }
 
 } // namespace
@@ -45,9 +45,11 @@ public:
     virtual bool isAnimated() const Q_DECL_OVERRIDE;
     virtual void startAnimation() Q_DECL_OVERRIDE;
     virtual void stopAnimation() Q_DECL_OVERRIDE;
+    virtual int memoryUsage() const Q_DECL_OVERRIDE;
 
 private Q_SLOTS:
-    void slotFrameChanged(int frameNumber);
+    void showNextFrame();
+    void slotFrameDecoded();
 
 private:
     AnimatedDocumentLoadedImplPrivate* const d;
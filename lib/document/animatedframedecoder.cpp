@@ -0,0 +1,249 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "animatedframedecoder.h"
+
+// Qt
+#include <QBuffer>
+#include <QDebug>
+#include <QImageReader>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+/**
+ * Default maximum amount of memory used by decoded frames, in bytes
+ */
+static const qint64 MAX_FRAMES_BYTES = 128 * 1024 * 1024;
+
+/**
+ * Maximum number of frames decoded ahead, when all frames do not fit in the
+ * memory budget
+ */
+static const int MAX_FRAMES_AHEAD = 8;
+
+AnimatedFrameDecoder::AnimatedFrameDecoder(const QByteArray& data)
+: mData(data)
+, mInvertedZoom(1)
+, mFrameCount(-1)
+, mLoopCount(-1)
+, mCapacity(2)
+, mMaxFramesBytes(MAX_FRAMES_BYTES)
+, mFramesBytes(0)
+, mDecodingBytes(0)
+, mKeepAllFrames(false)
+, mAllFramesDecoded(false)
+, mCancel(false)
+{
+}
+
+AnimatedFrameDecoder::~AnimatedFrameDecoder()
+{
+    cancel();
+    wait();
+}
+
+void AnimatedFrameDecoder::cancel()
+{
+    QMutexLocker lock(&mMutex);
+    mCancel = true;
+    mCond.wakeOne();
+}
+
+void AnimatedFrameDecoder::setMemoryBudget(qint64 bytes)
+{
+    QMutexLocker lock(&mMutex);
+    mMaxFramesBytes = bytes;
+}
+
+void AnimatedFrameDecoder::setInvertedZoom(int invertedZoom)
+{
+    QMutexLocker lock(&mMutex);
+    mInvertedZoom = invertedZoom;
+}
+
+int AnimatedFrameDecoder::frameCount() const
+{
+    QMutexLocker lock(&mMutex);
+    return mFrameCount;
+}
+
+int AnimatedFrameDecoder::loopCount() const
+{
+    QMutexLocker lock(&mMutex);
+    return mLoopCount;
+}
+
+qint64 AnimatedFrameDecoder::memoryUsage() const
+{
+    QMutexLocker lock(&mMutex);
+    return mFramesBytes + mDecodingBytes;
+}
+
+qint64 AnimatedFrameDecoder::frameMemoryUsage(const AnimatedFrame& frame)
+{
+    return qint64(frame.image.byteCount()) + frame.downSampledImage.byteCount();
+}
+
+bool AnimatedFrameDecoder::takeFrame(int number, AnimatedFrame* frame)
+{
+    QMutexLocker lock(&mMutex);
+    QMap<int, AnimatedFrame>::Iterator it = mFrames.find(number);
+    if (it == mFrames.end()) {
+        return false;
+    }
+    *frame = it.value();
+    if (!mKeepAllFrames) {
+        mFramesBytes -= frameMemoryUsage(it.value());
+        mFrames.erase(it);
+        mCond.wakeOne();
+    }
+    return true;
+}
+
+void AnimatedFrameDecoder::updateDownSampledImage(int number, const QImage& image, int invertedZoom)
+{
+    QMutexLocker lock(&mMutex);
+    QMap<int, AnimatedFrame>::Iterator it = mFrames.find(number);
+    if (it == mFrames.end()) {
+        return;
+    }
+    mFramesBytes -= it->downSampledImage.byteCount();
+    it->downSampledImage = image;
+    it->invertedZoom = invertedZoom;
+    mFramesBytes += image.byteCount();
+}
+
+bool AnimatedFrameDecoder::waitForRoom()
+{
+    QMutexLocker lock(&mMutex);
+    while (!mCancel && (mAllFramesDecoded || (!mKeepAllFrames && mFrames.count() >= mCapacity))) {
+        mCond.wait(&mMutex);
+    }
+    return !mCancel;
+}
+
+void AnimatedFrameDecoder::run()
+{
+    QBuffer buffer;
+    buffer.setData(mData);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    const QByteArray format = reader.format();
+
+    const QSize size = reader.size();
+    const qint64 frameBytes = qMax(qint64(1), qint64(size.width()) * size.height() * 4);
+    const int imageCount = reader.imageCount();
+    {
+        QMutexLocker lock(&mMutex);
+        mLoopCount = reader.loopCount();
+        mKeepAllFrames = imageCount > 0 && imageCount * frameBytes <= mMaxFramesBytes;
+        mCapacity = qBound(2, int(qMin(mMaxFramesBytes / frameBytes, qint64(MAX_FRAMES_AHEAD))), MAX_FRAMES_AHEAD);
+        // The reader composes each frame on top of the previous one, so it
+        // keeps a full size canvas while decoding
+        mDecodingBytes = frameBytes;
+        LOG("imageCount=" << imageCount << "keepAllFrames=" << mKeepAllFrames << "capacity=" << mCapacity);
+    }
+
+    int number = 0;
+    while (waitForRoom()) {
+        AnimatedFrame frame;
+        if (!reader.read(&frame.image)) {
+            QMutexLocker lock(&mMutex);
+            if (number == 0) {
+                qWarning() << "Could not decode animation:" << reader.errorString();
+                mFrameCount = 0;
+                mAllFramesDecoded = true;
+                mDecodingBytes = 0;
+                lock.unlock();
+                emit frameDecoded();
+                return;
+            }
+            // End of the animation. Now that we know how many frames there
+            // are, check whether they all fit in memory after all.
+            mFrameCount = number;
+            if (mKeepAllFrames) {
+                LOG("All" << number << "frames decoded");
+                mAllFramesDecoded = true;
+                mDecodingBytes = 0;
+                continue;
+            }
+            if (number * frameBytes <= mMaxFramesBytes) {
+                LOG("Keeping all" << number << "frames from now on");
+                mKeepAllFrames = true;
+            }
+            lock.unlock();
+            // Start again from the first frame
+            buffer.seek(0);
+            reader.setDevice(&buffer);
+            reader.setFormat(format);
+            number = 0;
+            continue;
+        }
+        frame.delay = reader.nextImageDelay();
+
+        int invertedZoom;
+        {
+            QMutexLocker lock(&mMutex);
+            invertedZoom = mInvertedZoom;
+        }
+        frame.invertedZoom = 1;
+        if (invertedZoom > 1) {
+            // Same as DocumentPrivate::downSampleImage()
+            const QImage downSampledImage = frame.image.scaled(frame.image.size() / invertedZoom, Qt::KeepAspectRatio, Qt::FastTransformation);
+            if (!downSampledImage.size().isEmpty()) {
+                frame.downSampledImage = downSampledImage;
+                frame.invertedZoom = invertedZoom;
+            }
+        }
+
+        {
+            QMutexLocker lock(&mMutex);
+            // After switching to keeping all frames, frames of the first pass
+            // which have not been taken yet are replaced
+            QMap<int, AnimatedFrame>::Iterator it = mFrames.find(number);
+            if (it != mFrames.end()) {
+                mFramesBytes -= frameMemoryUsage(it.value());
+                it.value() = frame;
+            } else {
+                mFrames.insert(number, frame);
+            }
+            mFramesBytes += frameMemoryUsage(frame);
+        }
+        ++number;
+        emit frameDecoded();
+    }
+}
+
+} // namespace
@@ -0,0 +1,134 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef ANIMATEDFRAMEDECODER_H
+#define ANIMATEDFRAMEDECODER_H
+
+// Qt
+#include <QByteArray>
+#include <QImage>
+#include <QMap>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+struct AnimatedFrame
+{
+    QImage image;
+    /** Down sampled version of image, if invertedZoom > 1 */
+    QImage downSampledImage;
+    int invertedZoom;
+    /** How long the frame should be shown, in milliseconds */
+    int delay;
+};
+
+/**
+ * Decodes the frames of an animated image ahead of playback, in a thread.
+ *
+ * If all frames fit in the memory budget they are decoded once and kept, so
+ * that following loops do not decode anything. Otherwise a few frames are
+ * decoded ahead and dropped once they have been shown.
+ */
+class AnimatedFrameDecoder : public QThread
+{
+    Q_OBJECT
+public:
+    AnimatedFrameDecoder(const QByteArray& data);
+    ~AnimatedFrameDecoder();
+
+    /**
+     * Maximum number of bytes used by decoded frames, defaults to 128 MB.
+     * Must be called before start().
+     */
+    void setMemoryBudget(qint64 bytes);
+
+    /**
+     * Frames decoded after this call also get a version down sampled by
+     * invertedZoom, see Document::downSampledImageForZoom()
+     */
+    void setInvertedZoom(int invertedZoom);
+
+    /**
+     * Gets frame number. Returns false if it has not been decoded yet, in
+     * which case frameDecoded() is emitted when it is ready.
+     */
+    bool takeFrame(int number, AnimatedFrame* frame);
+
+    /**
+     * Stores a new down sampled image for a kept frame, so that it is not
+     * computed again on the next loop
+     */
+    void updateDownSampledImage(int number, const QImage& image, int invertedZoom);
+
+    /**
+     * Returns the number of frames, or -1 if it is not known yet
+     */
+    int frameCount() const;
+
+    /**
+     * Returns the number of times the animation should be repeated, -1
+     * meaning forever. See QImageReader::loopCount().
+     */
+    int loopCount() const;
+
+    /**
+     * Returns the number of bytes used by the decoded frames and by the
+     * decoding buffers
+     */
+    qint64 memoryUsage() const;
+
+    void cancel();
+
+Q_SIGNALS:
+    void frameDecoded();
+
+protected:
+    virtual void run() Q_DECL_OVERRIDE;
+
+private:
+    bool waitForRoom();
+    static qint64 frameMemoryUsage(const AnimatedFrame& frame);
+
+    QByteArray mData;
+    mutable QMutex mMutex;
+    QWaitCondition mCond;
+    QMap<int, AnimatedFrame> mFrames;
+    int mInvertedZoom;
+    int mFrameCount;
+    int mLoopCount;
+    int mCapacity;
+    qint64 mMaxFramesBytes;
+    qint64 mFramesBytes;
+    qint64 mDecodingBytes;
+    bool mKeepAllFrames;
+    bool mAllFramesDecoded;
+    bool mCancel;
+};
+
+} // namespace
+
+#endif /* ANIMATEDFRAMEDECODER_H */
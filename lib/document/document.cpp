@@ -23,19 +23,26 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Qt
 #include <QApplication>
 #include <QImage>
+#include <QThread>
 #include <QUndoStack>
 #include <QUrl>
 #include <QDebug>
 
+// STL
+#include <utility>
+
 // KDE
 #include <KLocalizedString>
 #include <KJobUiDelegate>
 
 // Local
+#include "abstractimageoperation.h"
 #include "documentjob.h"
 #include "emptydocumentimpl.h"
+#include "exiv2imageloader.h"
 #include "gvdebug.h"
 #include "imagemetainfomodel.h"
+#include "imageutils.h"
 #include "loadingdocumentimpl.h"
 #include "loadingjob.h"
 #include "savejob.h"
@@ -131,6 +138,32 @@ void DocumentPrivate::downSampleImage(int invertedZoom)
     q->downSampledImageReady();
 }
 
+void DocumentPrivate::applyImageOrientation()
+{
+    LOG("orientation=" << mImageOrientation);
+    mImage = ImageUtils::transformed(std::move(mImage), mImageOrientation);
+    // Down sampled images are small, transforming them is cheaper than
+    // loading them again
+    QMap<int, QImage>::Iterator it = mDownSampledImageMap.begin(), end = mDownSampledImageMap.end();
+    for (; it != end; ++it) {
+        it.value() = ImageUtils::transformed(std::move(it.value()), mImageOrientation);
+    }
+    mImageOrientation = NORMAL;
+}
+
+void DocumentPrivate::loadFullMetaInfo()
+{
+    LOG("");
+    Exiv2ImageLoader loader;
+    if (loader.load(mFullMetaInfoData)) {
+        mExiv2Image = loader.popImage();
+    } else {
+        qWarning() << "Could not load metadata of" << mUrl << ":" << loader.errorMessage();
+    }
+    mFullMetaInfoData = QByteArray();
+    mImageMetaInfoModel.setExiv2Image(mExiv2Image.get());
+}
+
 //- DownSamplingJob ---------------------------------------
 void DownSamplingJob::doStart()
 {
@@ -174,7 +207,10 @@ void Document::reload()
     d->mSize = QSize();
     d->mImage = QImage();
     d->mDownSampledImageMap.clear();
+    d->mImageOrientation = NORMAL;
+    d->mRequestedInvertedZoom = 1;
     d->mExiv2Image.reset();
+    d->mFullMetaInfoData = QByteArray();
     d->mKind = MimeTypeUtils::KIND_UNKNOWN;
     d->mFormat = QByteArray();
     d->mImageMetaInfoModel.setUrl(d->mUrl);
@@ -186,10 +222,27 @@ void Document::reload()
 }
 
 const QImage& Document::image() const
+{
+    if (d->mImageOrientation != NORMAL && !d->mImage.isNull()) {
+        // Transforming replaces images the GUI thread reads while painting,
+        // so it must not happen in a job thread. ThreadedDocumentJob takes
+        // care of applying the orientation before starting its thread.
+        GV_RETURN_VALUE_IF_FAIL(QThread::currentThread() == qApp->thread(), d->mImage);
+        d->applyImageOrientation();
+    }
+    return d->mImage;
+}
+
+const QImage& Document::unorientedImage() const
 {
     return d->mImage;
 }
 
+Orientation Document::imageOrientation() const
+{
+    return d->mImageOrientation;
+}
+
 /**
  * invertedZoom is the biggest power of 2 for which zoom < 1/invertedZoom.
  * Example:
@@ -227,6 +280,21 @@ const QImage& Document::downSampledImageForZoom(qreal zoom) const
     return d->mDownSampledImageMap[invertedZoom];
 }
 
+QImage Document::smallestImageForSize(const QSize& size) const
+{
+    QImage result = image();
+    // The map is sorted by inverted zoom: the last matching image is the
+    // smallest one
+    QMap<int, QImage>::ConstIterator it = d->mDownSampledImageMap.constBegin(), end = d->mDownSampledImageMap.constEnd();
+    for (; it != end; ++it) {
+        const QImage& image = it.value();
+        if (image.width() >= size.width() && image.height() >= size.height()) {
+            result = image;
+        }
+    }
+    return result;
+}
+
 Document::LoadingState Document::loadingState() const
 {
     return d->mImpl->loadingState();
@@ -251,17 +319,28 @@ void Document::switchToImpl(AbstractDocumentImpl* impl)
             this, SIGNAL(imageRectUpdated(QRect)));
     connect(d->mImpl, SIGNAL(isAnimatedUpdated()),
             this, SIGNAL(isAnimatedUpdated()));
+    connect(d->mImpl, SIGNAL(memoryUsageChanged()),
+            this, SLOT(emitMemoryUsageChanged()));
     d->mImpl->init();
 }
 
-void Document::setImageInternal(const QImage& image)
+void Document::setImageInternal(const QImage& image, Orientation orientation)
 {
     d->mImage = image;
     d->mDownSampledImageMap.clear();
+    d->mImageOrientation = orientation;
+    d->mRequestedInvertedZoom = 1;
 
     // If we didn't get the image size before decoding the full image, set it
     // now
-    setSize(d->mImage.size());
+    setSize(ImageUtils::transformedSize(d->mImage.size(), orientation));
+}
+
+void Document::setImageOrientation(Orientation orientation)
+{
+    // Only meant to be called before any pixel has been loaded
+    GV_RETURN_IF_FAIL(d->mImage.isNull() && d->mDownSampledImageMap.isEmpty());
+    d->mImageOrientation = orientation;
 }
 
 QUrl Document::url() const
@@ -299,6 +378,9 @@ void Document::waitUntilLoaded()
 DocumentJob* Document::save(const QUrl &url, const QByteArray& format)
 {
     waitUntilLoaded();
+    // Saving happens in a separate thread, make sure the orientation has
+    // been applied before
+    image();
     DocumentJob* job = d->mImpl->save(url, format);
     if (!job) {
         qWarning() << "Implementation does not support saving!";
@@ -363,9 +445,16 @@ bool Document::hasAlphaChannel() const
 
 int Document::memoryUsage() const
 {
-    // FIXME: Take undo stack into account
     int usage = d->mImage.byteCount();
-    usage += rawData().length();
+    const QByteArray data = rawData();
+    usage += data.length();
+    // Data kept to load the full metadata later is usually the file content,
+    // only count it if it is not shared with the raw data
+    if (d->mFullMetaInfoData.constData() != data.constData()) {
+        usage += d->mFullMetaInfoData.length();
+    }
+    usage += AbstractImageOperation::undoStackMemoryUsage(&d->mUndoStack);
+    usage += d->mImpl->memoryUsage();
     return usage;
 }
 
@@ -389,10 +478,17 @@ AbstractDocumentEditor* Document::editor()
     return d->mImpl->editor();
 }
 
-void Document::setExiv2Image(Exiv2::Image::AutoPtr image)
+void Document::setExiv2Image(Exiv2::Image::AutoPtr image, const QByteArray& fullMetaInfoData)
 {
     d->mExiv2Image = image;
-    d->mImageMetaInfoModel.setExiv2Image(d->mExiv2Image.get());
+    d->mFullMetaInfoData = fullMetaInfoData;
+    if (fullMetaInfoData.isNull()) {
+        d->mImageMetaInfoModel.setExiv2Image(d->mExiv2Image.get());
+    } else {
+        // Do not waste time filling the model now, metaInfo() will take care
+        // of it. Just get rid of the entries of the previous image.
+        d->mImageMetaInfoModel.setExiv2Image(0);
+    }
     emit metaInfoUpdated();
 }
 
@@ -415,6 +511,9 @@ void Document::setErrorString(const QString& string)
 
 ImageMetaInfoModel* Document::metaInfo() const
 {
+    if (!d->mFullMetaInfoData.isNull()) {
+        d->loadFullMetaInfo();
+    }
     return &d->mImageMetaInfoModel;
 }
 
@@ -443,6 +542,7 @@ bool Document::prepareDownSampledImageForZoom(qreal zoom)
     }
 
     int invertedZoom = invertedZoomForZoom(zoom);
+    d->mRequestedInvertedZoom = invertedZoom;
     if (d->mDownSampledImageMap.contains(invertedZoom)) {
         LOG("downSampledImageForZoom=" << zoom << "invertedZoom=" << invertedZoom << "ready");
         return true;
@@ -473,6 +573,11 @@ void Document::emitLoaded()
     emit loaded(d->mUrl);
 }
 
+void Document::emitMemoryUsageChanged()
+{
+    emit memoryUsageChanged(d->mUrl);
+}
+
 void Document::emitLoadingFailed()
 {
     emit loadingFailed(d->mUrl);
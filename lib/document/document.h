@@ -32,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include <lib/mimetypeutils.h>
+#include <lib/orientation.h>
 #include <lib/cms/cmsprofile.h>
 
 class QImage;
@@ -64,6 +65,11 @@ class ImageMetaInfoModel;
  * images load much faster than the full image but you need to load the full
  * image to manipulate it (use startLoadingFullImage() to do so).
  *
+ * The EXIF orientation of the image is not applied to the pixels when it is
+ * loaded: views display unorientedImage() and downSampledImageForZoom()
+ * transformed by imageOrientation(). The orientation is applied to the pixels
+ * the first time image() is called.
+ *
  * To get a Document instance for url, ask for one with
  * DocumentFactory::instance()->load(url);
  */
@@ -115,10 +121,41 @@ public:
 
     bool isModified() const;
 
+    /**
+     * Returns the image, with its orientation applied. If this has not been
+     * done yet, the pixels are transformed now, so only call this when the
+     * actual pixels are needed, for example to edit or print the image.
+     * The transformation must happen in the GUI thread: ThreadedDocumentJob
+     * does it before starting its thread.
+     */
     const QImage& image() const;
 
+    /**
+     * Returns the image as it has been decoded: imageOrientation() must be
+     * applied to get the image as it should be displayed.
+     */
+    const QImage& unorientedImage() const;
+
+    /**
+     * Returns the orientation to apply to unorientedImage() and
+     * downSampledImageForZoom(). Returns NORMAL once image() has been called.
+     */
+    Orientation imageOrientation() const;
+
+    /**
+     * Returns a down sampled version of unorientedImage(), imageOrientation()
+     * has not been applied to it.
+     */
     const QImage& downSampledImageForZoom(qreal zoom) const;
 
+    /**
+     * Returns the smallest of image() and its already available down sampled
+     * versions which is at least size big. Use it to create small versions
+     * of the image without scaling the full image. Like image(), applies the
+     * orientation first, so it must be called from the GUI thread.
+     */
+    QImage smallestImageForSize(const QSize& size) const;
+
     /**
      * Returns an implementation of AbstractDocumentEditor if this document can
      * be edited.
@@ -215,10 +252,16 @@ Q_SIGNALS:
     void isAnimatedUpdated();
     void busyChanged(const QUrl&, bool);
     void allTasksDone();
+    /**
+     * Emitted when memoryUsage() grows without the document being modified,
+     * for example when an animation keeps its decoded frames
+     */
+    void memoryUsageChanged(const QUrl&);
 
 private Q_SLOTS:
     void emitMetaInfoLoaded();
     void emitLoaded();
+    void emitMemoryUsageChanged();
     void emitLoadingFailed();
     void slotUndoIndexChanged();
     void slotSaveResult(KJob*);
@@ -230,11 +273,12 @@ private:
     friend struct DocumentPrivate;
     friend class DownSamplingJob;
 
-    void setImageInternal(const QImage&);
+    void setImageInternal(const QImage&, Orientation orientation = NORMAL);
+    void setImageOrientation(Orientation);
     void setKind(MimeTypeUtils::Kind);
     void setFormat(const QByteArray&);
     void setSize(const QSize&);
-    void setExiv2Image(Exiv2::Image::AutoPtr);
+    void setExiv2Image(Exiv2::Image::AutoPtr, const QByteArray& fullMetaInfoData = QByteArray());
     void setDownSampledImage(const QImage&, int invertedZoom);
     void switchToImpl(AbstractDocumentImpl* impl);
     void setErrorString(const QString&);
@@ -54,7 +54,16 @@ struct DocumentPrivate
     QSize mSize;
     QImage mImage;
     QMap<int, QImage> mDownSampledImageMap;
+    // Orientation which has not been applied to mImage and
+    // mDownSampledImageMap yet
+    Orientation mImageOrientation;
+    // invertedZoom of the last prepareDownSampledImageForZoom() call for
+    // the current image
+    int mRequestedInvertedZoom;
     Exiv2::Image::AutoPtr mExiv2Image;
+    // If not null, mExiv2Image only contains essential metadata and
+    // mImageMetaInfoModel has not been filled yet
+    QByteArray mFullMetaInfoData;
     MimeTypeUtils::Kind mKind;
     QByteArray mFormat;
     ImageMetaInfoModel mImageMetaInfoModel;
@@ -66,6 +75,8 @@ struct DocumentPrivate
     void scheduleImageLoading(int invertedZoom);
     void scheduleImageDownSampling(int invertedZoom);
     void downSampleImage(int invertedZoom);
+    void applyImageOrientation();
+    void loadFullMetaInfo();
 };
 
 
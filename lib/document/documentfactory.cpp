@@ -183,6 +183,7 @@ Document::Ptr DocumentFactory::load(const QUrl &url)
     connect(doc, &Document::saved, this, &DocumentFactory::slotSaved);
     connect(doc, &Document::modified, this, &DocumentFactory::slotModified);
     connect(doc, &Document::busyChanged, this, &DocumentFactory::slotBusyChanged);
+    connect(doc, &Document::memoryUsageChanged, this, &DocumentFactory::slotMemoryUsageChanged);
 
     // Create DocumentInfo instance
     info = new DocumentInfo;
@@ -260,6 +261,15 @@ void DocumentFactory::slotBusyChanged(const QUrl &url, bool busy)
     emit documentBusyStateChanged(url, busy);
 }
 
+void DocumentFactory::slotMemoryUsageChanged(const QUrl &url)
+{
+    // The save bar checks the memory used by modified documents when this
+    // list changes
+    if (d->mModifiedDocumentList.contains(url)) {
+        emit modifiedDocumentListChanged();
+    }
+}
+
 QUndoGroup* DocumentFactory::undoGroup()
 {
     return &d->mUndoGroup;
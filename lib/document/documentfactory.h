@@ -85,6 +85,7 @@ private Q_SLOTS:
     void slotSaved(const QUrl&, const QUrl&);
     void slotModified(const QUrl&);
     void slotBusyChanged(const QUrl&, bool);
+    void slotMemoryUsageChanged(const QUrl&);
 
 private:
     DocumentFactory();
@@ -84,6 +84,9 @@ bool DocumentJob::checkDocumentEditor()
 
 void ThreadedDocumentJob::doStart()
 {
+    // Jobs work on document()->image(): make sure the orientation has been
+    // applied to it in the GUI thread, see Document::image()
+    document()->image();
     QFuture<void> future = QtConcurrent::run(this, &ThreadedDocumentJob::threadedStart);
     QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
     connect(watcher, SIGNAL(finished()), SLOT(emitResult()));
@@ -25,7 +25,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <QByteArray>
 #include <QImage>
 #include <QImageWriter>
-#include <QMatrix>
 #include <QDebug>
 #include <QUrl>
 
@@ -63,7 +62,8 @@ DocumentLoadedImpl::~DocumentLoadedImpl()
 void DocumentLoadedImpl::init()
 {
     if (!d->mQuietInit) {
-        emit imageRectUpdated(document()->image().rect());
+        // Do not use document()->image(), it would apply the orientation
+        emit imageRectUpdated(QRect(QPoint(0, 0), document()->size()));
         emit loaded();
     }
 }
@@ -78,6 +78,10 @@ Document::LoadingState DocumentLoadedImpl::loadingState() const
     return Document::Loaded;
 }
 
+void DocumentLoadedImpl::prepareSave(const QByteArray& /*format*/)
+{
+}
+
 bool DocumentLoadedImpl::saveInternal(QIODevice* device, const QByteArray& format)
 {
     QImageWriter writer(device, format);
@@ -108,9 +112,7 @@ void DocumentLoadedImpl::setImage(const QImage& image)
 
 void DocumentLoadedImpl::applyTransformation(Orientation orientation)
 {
-    QImage image = document()->image();
-    QMatrix matrix = ImageUtils::transformMatrix(orientation);
-    image = image.transformed(matrix);
+    const QImage image = ImageUtils::transformed(document()->image(), orientation);
     setDocumentImage(image);
     imageRectUpdated(image.rect());
 }
@@ -58,6 +58,13 @@ public:
     //
 
 protected:
+    /**
+     * Called by SaveJob in the GUI thread, before saveInternal() is called
+     * in a separate thread. Lets implementations get what they need from the
+     * document while it is safe to do so.
+     */
+    virtual void prepareSave(const QByteArray& format);
+
     virtual bool saveInternal(QIODevice* device, const QByteArray& format);
 
     // AbstractDocumentEditor
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 // Qt
 #include <QImage>
 #include <QIODevice>
+#include <QRect>
 
 // KDE
 
@@ -33,9 +34,39 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 namespace Gwenview
 {
 
+/**
+ * Size of the thumbnail stored in the Exif data
+ */
+static const int THUMBNAIL_SIZE = 128;
+
+/**
+ * Images more than this times bigger than the thumbnail are first reduced
+ * with a fast transformation
+ */
+static const int FAST_REDUCTION_FACTOR = 4;
+
+/**
+ * Creates the Exif thumbnail from sourceImage, the smallest down sampled
+ * image available, instead of scaling the full image
+ */
+static QImage createThumbnail(const QImage& sourceImage)
+{
+    const QSize size = sourceImage.size().scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio);
+    QImage source = sourceImage;
+    if (source.width() > size.width() * FAST_REDUCTION_FACTOR) {
+        // Smooth scaling reads every source pixel: quickly get rid of most of
+        // them first, the smooth pass hides the artifacts
+        source = source.scaled(size * FAST_REDUCTION_FACTOR / 2, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+    }
+    return source.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
 struct JpegDocumentLoadedImplPrivate
 {
     JpegContent* mJpegContent;
+    // Image the Exif thumbnail is created from. Picked in the GUI thread by
+    // prepareSave(), since the down sampled images may change while saving.
+    QImage mThumbnailSource;
 };
 
 JpegDocumentLoadedImpl::JpegDocumentLoadedImpl(Document* doc, JpegContent* jpegContent)
@@ -52,14 +83,22 @@ JpegDocumentLoadedImpl::~JpegDocumentLoadedImpl()
     delete d;
 }
 
+void JpegDocumentLoadedImpl::prepareSave(const QByteArray& format)
+{
+    if (format == "jpeg") {
+        const QSize size = document()->size().scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio);
+        d->mThumbnailSource = document()->smallestImageForSize(size);
+    }
+}
+
 bool JpegDocumentLoadedImpl::saveInternal(QIODevice* device, const QByteArray& format)
 {
     if (format == "jpeg") {
         d->mJpegContent->resetOrientation();
-        if (!d->mJpegContent->thumbnail().isNull()) {
-            QImage thumbnail = document()->image().scaled(128, 128, Qt::KeepAspectRatio);
-            d->mJpegContent->setThumbnail(thumbnail);
+        if (!d->mJpegContent->thumbnail().isNull() && !d->mThumbnailSource.isNull()) {
+            d->mJpegContent->setThumbnail(createThumbnail(d->mThumbnailSource));
         }
+        d->mThumbnailSource = QImage();
 
         bool ok = d->mJpegContent->save(device);
         if (!ok) {
@@ -79,8 +118,24 @@ void JpegDocumentLoadedImpl::setImage(const QImage& image)
 
 void JpegDocumentLoadedImpl::applyTransformation(Orientation orientation)
 {
+    const bool lossless = d->mJpegContent->canTransformLosslessly(orientation);
     DocumentLoadedImpl::applyTransformation(orientation);
-    d->mJpegContent->transform(orientation);
+    if (lossless) {
+        d->mJpegContent->transform(orientation);
+    } else {
+        // A pending crop would not be aligned on MCUs anymore
+        d->mJpegContent->setImage(document()->image());
+    }
+}
+
+void JpegDocumentLoadedImpl::crop(const QRect& rect, const QImage& croppedImage)
+{
+    if (d->mJpegContent->canCropLosslessly(rect)) {
+        d->mJpegContent->crop(rect);
+        DocumentLoadedImpl::setImage(croppedImage);
+    } else {
+        setImage(croppedImage);
+    }
 }
 
 QByteArray JpegDocumentLoadedImpl::rawData() const
@@ -45,11 +45,13 @@ public:
     virtual QByteArray rawData() const Q_DECL_OVERRIDE;
 
 protected:
+    virtual void prepareSave(const QByteArray& format) Q_DECL_OVERRIDE;
     virtual bool saveInternal(QIODevice* device, const QByteArray& format) Q_DECL_OVERRIDE;
 
     // AbstractDocumentEditor
     virtual void setImage(const QImage&) Q_DECL_OVERRIDE;
     virtual void applyTransformation(Orientation orientation) Q_DECL_OVERRIDE;
+    virtual void crop(const QRect& rect, const QImage& croppedImage) Q_DECL_OVERRIDE;
     //
 
 private:
@@ -100,7 +100,12 @@ struct LoadingDocumentImplPrivate
     QByteArray mData;
     QByteArray mFormat;
     QSize mImageSize;
+    // Orientation to apply to mImage, it is left to Document
+    Orientation mImageOrientation;
     Exiv2::Image::AutoPtr mExiv2Image;
+    // True if mExiv2Image only contains essential metadata, see
+    // Exiv2ImageLoader::loadEssentials()
+    bool mExiv2ImageIsPartial;
     std::unique_ptr<JpegContent> mJpegContent;
     QImage mImage;
     Cms::Profile::Ptr mCmsProfile;
@@ -257,9 +262,12 @@ struct LoadingDocumentImplPrivate
         LOG("mFormat" << mFormat);
         GV_RETURN_VALUE_IF_FAIL(!mFormat.isEmpty(), false);
 
+        // Only read the metadata needed to display the image here, the rest
+        // is read when it is needed, see Document::metaInfo()
         Exiv2ImageLoader loader;
-        if (loader.load(mData)) {
+        if (loader.loadEssentials(mData)) {
             mExiv2Image = loader.popImage();
+            mExiv2ImageIsPartial = mExiv2Image->mimeType() == "image/jpeg";
         }
 
         if (mFormat == "jpeg" && mExiv2Image.get()) {
@@ -275,6 +283,9 @@ struct LoadingDocumentImplPrivate
             // Use the size from JpegContent, as its correctly transposed if the
             // image has been rotated
             mImageSize = mJpegContent->size();
+            if (GwenviewConfig::applyExifOrientation()) {
+                mImageOrientation = mJpegContent->orientation();
+            }
 
             mCmsProfile = Cms::Profile::loadFromExiv2Image(mExiv2Image.get());
 
@@ -318,12 +329,6 @@ struct LoadingDocumentImplPrivate
             return;
         }
 
-        if (mJpegContent.get() && GwenviewConfig::applyExifOrientation()) {
-            Gwenview::Orientation orientation = mJpegContent->orientation();
-            QMatrix matrix = ImageUtils::transformMatrix(orientation);
-            mImage = mImage.transformed(matrix);
-        }
-
         if (reader.supportsAnimation()
                 && reader.nextImageDelay() > 0 // Assume delay == 0 <=> only one frame
            ) {
@@ -356,9 +361,11 @@ LoadingDocumentImpl::LoadingDocumentImpl(Document* document)
 {
     d->q = this;
     d->mMetaInfoLoaded = false;
+    d->mExiv2ImageIsPartial = false;
     d->mAnimated = false;
     d->mDownSampledImageLoaded = false;
     d->mImageDataInvertedZoom = 0;
+    d->mImageOrientation = NORMAL;
 
     connect(&d->mMetaInfoFutureWatcher, SIGNAL(finished()),
             SLOT(slotMetaInfoLoaded()));
@@ -462,7 +469,7 @@ bool LoadingDocumentImpl::isEditable() const
 
 Document::LoadingState LoadingDocumentImpl::loadingState() const
 {
-    if (!document()->image().isNull()) {
+    if (!document()->unorientedImage().isNull()) {
         return Document::Loaded;
     } else if (d->mMetaInfoLoaded) {
         return Document::MetaInfoLoaded;
@@ -487,8 +494,9 @@ void LoadingDocumentImpl::slotMetaInfoLoaded()
     }
 
     setDocumentFormat(d->mFormat);
+    setDocumentImageOrientation(d->mImageOrientation);
     setDocumentImageSize(d->mImageSize);
-    setDocumentExiv2Image(d->mExiv2Image);
+    setDocumentExiv2Image(d->mExiv2Image, d->mExiv2ImageIsPartial ? d->mData : QByteArray());
     setDocumentCmsProfile(d->mCmsProfile);
 
     d->mMetaInfoLoaded = true;
@@ -514,8 +522,10 @@ void LoadingDocumentImpl::slotImageLoaded()
         return;
     }
 
+    // mImageSize has the orientation applied, mImage has not
+    const QSize unorientedImageSize = ImageUtils::transformedSize(d->mImageSize, d->mImageOrientation);
     if (d->mAnimated) {
-        if (d->mImage.size() == d->mImageSize) {
+        if (d->mImage.size() == unorientedImageSize) {
             // We already decoded the first frame at the right size, let's show
             // it
             setDocumentImage(d->mImage);
@@ -528,7 +538,7 @@ void LoadingDocumentImpl::slotImageLoaded()
         return;
     }
 
-    if (d->mImageDataInvertedZoom != 1 && d->mImage.size() != d->mImageSize) {
+    if (d->mImageDataInvertedZoom != 1 && d->mImage.size() != unorientedImageSize) {
         LOG("Loaded a down sampled image");
         d->mDownSampledImageLoaded = true;
         // We loaded a down sampled image
@@ -537,7 +547,7 @@ void LoadingDocumentImpl::slotImageLoaded()
     }
 
     LOG("Loaded a full image");
-    setDocumentImage(d->mImage);
+    setDocumentImage(d->mImage, d->mImageOrientation);
     DocumentLoadedImpl* impl;
     if (d->mJpegContent.get()) {
         impl = new JpegDocumentLoadedImpl(
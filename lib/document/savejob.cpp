@@ -22,6 +22,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "savejob.h"
 
 // Qt
+#include <QAtomicInt>
+#include <QBuffer>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QScopedPointer>
@@ -30,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QApplication>
 #include <QTemporaryFile>
 #include <QSaveFile>
+#include <QThreadPool>
 
 // KDE
 #include <KIO/CopyJob>
@@ -43,6 +46,21 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 namespace Gwenview
 {
 
+/**
+ * Runs the writes of all save jobs, one at a time: images are encoded in
+ * parallel, but writing several files at once would only make the disk seek
+ * between them
+ */
+static QThreadPool* writePool()
+{
+    static QThreadPool* pool = 0;
+    if (!pool) {
+        pool = new QThreadPool(qApp);
+        pool->setMaxThreadCount(1);
+    }
+    return pool;
+}
+
 struct SaveJobPrivate
 {
     DocumentLoadedImpl* mImpl;
@@ -52,8 +70,13 @@ struct SaveJobPrivate
     QScopedPointer<QTemporaryFile> mTemporaryFile;
     QScopedPointer<QSaveFile> mSaveFile;
     QScopedPointer<QFutureWatcher<void> > mInternalSaveWatcher;
+    // Encoded image, waiting for its turn to be written
+    QByteArray mData;
+    bool mWriteSucceeded;
 
     bool mKillReceived;
+    // Tells a queued write that the job has been killed
+    QAtomicInt mWriteCancelled;
 };
 
 SaveJob::SaveJob(DocumentLoadedImpl* impl, const QUrl &url, const QByteArray& format)
@@ -63,6 +86,7 @@ SaveJob::SaveJob(DocumentLoadedImpl* impl, const QUrl &url, const QByteArray& fo
     d->mOldUrl = impl->document()->url();
     d->mNewUrl = url;
     d->mFormat = format;
+    d->mWriteSucceeded = false;
     d->mKillReceived = false;
     setCapabilities(Killable);
 }
@@ -74,13 +98,26 @@ SaveJob::~SaveJob()
 
 void SaveJob::saveInternal()
 {
-    if (!d->mImpl->saveInternal(d->mSaveFile.data(), d->mFormat)) {
-        d->mSaveFile->cancelWriting();
+    QBuffer buffer(&d->mData);
+    buffer.open(QIODevice::WriteOnly);
+    if (!d->mImpl->saveInternal(&buffer, d->mFormat)) {
+        d->mData.clear();
         setError(UserDefinedError + 2);
         setErrorText(d->mImpl->document()->errorString());
     }
 }
 
+void SaveJob::writeInternal()
+{
+    if (d->mWriteCancelled.load()) {
+        d->mSaveFile->cancelWriting();
+    } else if (d->mSaveFile->write(d->mData) != d->mData.size()) {
+        d->mSaveFile->cancelWriting();
+    }
+    d->mWriteSucceeded = d->mSaveFile->commit();
+    d->mData.clear();
+}
+
 void SaveJob::doStart()
 {
     if (d->mKillReceived) {
@@ -110,6 +147,7 @@ void SaveJob::doStart()
         return;
     }
 
+    d->mImpl->prepareSave(d->mFormat);
     QFuture<void> future = QtConcurrent::run(this, &SaveJob::saveInternal);
     d->mInternalSaveWatcher.reset(new QFutureWatcher<void>(this));
     connect(d->mInternalSaveWatcher.data(), SIGNAL(finished()), SLOT(finishSave()));
@@ -124,14 +162,29 @@ void SaveJob::finishSave()
     }
 
     if (error()) {
+        d->mSaveFile->cancelWriting();
         emitResult();
         return;
     }
 
-    if (!d->mSaveFile->commit()) {
+    QFuture<void> future = QtConcurrent::run(writePool(), this, &SaveJob::writeInternal);
+    d->mInternalSaveWatcher.reset(new QFutureWatcher<void>(this));
+    connect(d->mInternalSaveWatcher.data(), SIGNAL(finished()), SLOT(finishWrite()));
+    d->mInternalSaveWatcher->setFuture(future);
+}
+
+void SaveJob::finishWrite()
+{
+    d->mInternalSaveWatcher.reset(0);
+    if (d->mKillReceived) {
+        return;
+    }
+
+    if (!d->mWriteSucceeded) {
         setErrorText(xi18nc("@info", "Could not overwrite file, check that you have the necessary rights to write in <filename>%1</filename>.",
                             d->mNewUrl.toString()));
         setError(UserDefinedError + 3);
+        emitResult();
         return;
     }
 
@@ -165,6 +218,7 @@ QUrl SaveJob::newUrl() const
 bool SaveJob::doKill()
 {
     d->mKillReceived = true;
+    d->mWriteCancelled.store(1);
     if (d->mInternalSaveWatcher) {
         d->mInternalSaveWatcher->waitForFinished();
     }
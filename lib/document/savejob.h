@@ -45,7 +45,15 @@ class GWENVIEWLIB_EXPORT SaveJob : public DocumentJob
 public:
     SaveJob(DocumentLoadedImpl* impl, const QUrl &url, const QByteArray& format);
     ~SaveJob();
+    /**
+     * Encodes the image in memory. Runs in a worker thread.
+     */
     void saveInternal();
+    /**
+     * Writes the encoded image. Runs in a pool shared by all save jobs, which
+     * writes one file at a time.
+     */
+    void writeInternal();
 
     QUrl oldUrl() const;
     QUrl newUrl() const;
@@ -59,6 +67,7 @@ protected:
 
 private Q_SLOTS:
     void finishSave();
+    void finishWrite();
 
 private:
     SaveJobPrivate* const d;
@@ -0,0 +1,233 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "savescheduler.h"
+
+// Local
+#include <lib/document/document.h>
+#include <lib/document/documentfactory.h>
+#include <lib/document/documentjob.h>
+#include <lib/memoryutils.h>
+
+// Qt
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+#include <QUndoStack>
+
+// STL
+#include <algorithm>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+/**
+ * Saves are always allowed to use this much memory, even if the system
+ * reports less free memory: swapping a bit is better than saving one
+ * document at a time
+ */
+static const qint64 MIN_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+struct SaveSchedulerPrivate {
+    SaveScheduler* q;
+    bool mRunning;
+    QList<QUrl> mPendingUrls;
+    QHash<QUrl, qint64> mEstimates;
+    QHash<KJob*, QUrl> mRunningJobs;
+    qint64 mMemoryBudget;
+    qint64 mMemoryInUse;
+    int mMaxRunningJobs;
+    int mSavedCount;
+    int mTotalCount;
+    qint64 mSavedSize;
+    qint64 mTotalSize;
+
+    /**
+     * Memory needed to save doc: a converted copy of the image for the
+     * encoder, and the encoded data. The size of the current file is a
+     * good guess for the latter.
+     */
+    static qint64 estimateSaveMemory(const Document::Ptr& doc)
+    {
+        const QSize size = doc->size();
+        const qint64 decodedSize = qint64(size.width()) * size.height() * 4;
+        qint64 encodedSize = 0;
+        if (doc->url().isLocalFile()) {
+            encodedSize = QFileInfo(doc->url().toLocalFile()).size();
+        }
+        if (encodedSize <= 0) {
+            encodedSize = decodedSize / 4;
+        }
+        return qMax(qint64(1), decodedSize + encodedSize);
+    }
+
+    void fileDone(const QUrl& url, const QString& errorString)
+    {
+        ++mSavedCount;
+        mSavedSize += mEstimates.value(url);
+        if (!errorString.isEmpty()) {
+            emit q->failed(url, errorString);
+        }
+        emit q->progressChanged();
+    }
+};
+
+SaveScheduler::SaveScheduler(QObject* parent)
+: QObject(parent)
+, d(new SaveSchedulerPrivate)
+{
+    d->q = this;
+    d->mRunning = false;
+    d->mMemoryBudget = MIN_MEMORY_BUDGET;
+    d->mMemoryInUse = 0;
+    d->mMaxRunningJobs = qMax(1, QThread::idealThreadCount());
+    d->mSavedCount = 0;
+    d->mTotalCount = 0;
+    d->mSavedSize = 0;
+    d->mTotalSize = 0;
+}
+
+SaveScheduler::~SaveScheduler()
+{
+    delete d;
+}
+
+void SaveScheduler::start(const QList<QUrl>& urls)
+{
+    d->mRunning = true;
+    d->mPendingUrls = urls;
+    std::sort(d->mPendingUrls.begin(), d->mPendingUrls.end());
+    d->mEstimates.clear();
+    d->mTotalSize = 0;
+    Q_FOREACH(const QUrl& url, d->mPendingUrls) {
+        Document::Ptr doc = DocumentFactory::instance()->load(url);
+        const qint64 estimate = SaveSchedulerPrivate::estimateSaveMemory(doc);
+        d->mEstimates.insert(url, estimate);
+        d->mTotalSize += estimate;
+    }
+    d->mSavedCount = 0;
+    d->mSavedSize = 0;
+    d->mTotalCount = urls.count();
+    d->mMemoryInUse = 0;
+    // Only use half of the free memory: the undo data of the saved documents
+    // is released as we go, but the rest of the application keeps running
+    d->mMemoryBudget = qMax(MIN_MEMORY_BUDGET, qint64(MemoryUtils::getFreeMemory() / 2));
+    LOG("Saving" << d->mTotalCount << "documents, memory budget:" << d->mMemoryBudget);
+    // Start asynchronously, so that signals are always emitted after start()
+    // returns
+    QMetaObject::invokeMethod(this, "startNextJobs", Qt::QueuedConnection);
+}
+
+void SaveScheduler::cancel()
+{
+    if (!d->mRunning) {
+        return;
+    }
+    d->mRunning = false;
+    d->mPendingUrls.clear();
+    const QList<KJob*> jobs = d->mRunningJobs.keys();
+    d->mRunningJobs.clear();
+    d->mMemoryInUse = 0;
+    Q_FOREACH(KJob* job, jobs) {
+        job->kill();
+    }
+    emit finished();
+}
+
+void SaveScheduler::startNextJobs()
+{
+    if (!d->mRunning) {
+        return;
+    }
+    while (!d->mPendingUrls.isEmpty() && d->mRunningJobs.count() < d->mMaxRunningJobs) {
+        const QUrl url = d->mPendingUrls.first();
+        const qint64 estimate = d->mEstimates.value(url);
+        if (!d->mRunningJobs.isEmpty() && d->mMemoryInUse + estimate > d->mMemoryBudget) {
+            LOG("Waiting for memory, in use:" << d->mMemoryInUse << "needed:" << estimate);
+            break;
+        }
+        d->mPendingUrls.removeFirst();
+        Document::Ptr doc = DocumentFactory::instance()->load(url);
+        DocumentJob* job = doc->save(url, doc->format());
+        if (!job) {
+            d->fileDone(url, doc->errorString());
+            continue;
+        }
+        d->mMemoryInUse += estimate;
+        d->mRunningJobs.insert(job, url);
+        connect(job, &DocumentJob::result, this, &SaveScheduler::slotResult);
+    }
+    if (d->mRunningJobs.isEmpty() && d->mPendingUrls.isEmpty()) {
+        d->mRunning = false;
+        emit finished();
+    }
+}
+
+int SaveScheduler::savedCount() const
+{
+    return d->mSavedCount;
+}
+
+int SaveScheduler::totalCount() const
+{
+    return d->mTotalCount;
+}
+
+int SaveScheduler::percent() const
+{
+    if (d->mTotalSize == 0) {
+        return 100;
+    }
+    return int(d->mSavedSize * 100 / d->mTotalSize);
+}
+
+void SaveScheduler::slotResult(KJob* job)
+{
+    if (!d->mRunningJobs.contains(job)) {
+        return;
+    }
+    const QUrl url = d->mRunningJobs.take(job);
+    d->mMemoryInUse -= d->mEstimates.value(url);
+
+    QString errorString;
+    if (job->error()) {
+        errorString = job->errorString();
+    } else {
+        // The saved image is now the reference: release the memory held by
+        // the undo data
+        DocumentJob* documentJob = static_cast<DocumentJob*>(job);
+        documentJob->document()->undoStack()->clear();
+    }
+    d->fileDone(url, errorString);
+    startNextJobs();
+}
+
+} // namespace
@@ -0,0 +1,96 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef SAVESCHEDULER_H
+#define SAVESCHEDULER_H
+
+// Local
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QList>
+#include <QObject>
+#include <QUrl>
+
+class KJob;
+
+namespace Gwenview
+{
+
+struct SaveSchedulerPrivate;
+/**
+ * Saves a list of modified documents, without starting all the saves at once.
+ *
+ * Each save encodes a full image in its own thread and holds the encoded
+ * data, so the number of saves in flight is limited by the number of cores
+ * and by an estimation of the memory they need, compared to the free memory
+ * available when start() is called. Documents are saved in url order.
+ * Encoding is done in parallel, but SaveJob writes the encoded files one at
+ * a time.
+ *
+ * Once a document has been saved, its undo data is released.
+ */
+class GWENVIEWLIB_EXPORT SaveScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    SaveScheduler(QObject* parent = 0);
+    ~SaveScheduler();
+
+    /**
+     * Starts saving the documents of urls, which must be loaded. finished()
+     * is emitted once all of them have been saved or have failed.
+     */
+    void start(const QList<QUrl>& urls);
+
+    /**
+     * Kills the saves in flight and drops the pending ones. finished() is
+     * emitted right away.
+     */
+    void cancel();
+
+    int savedCount() const;
+
+    int totalCount() const;
+
+    /**
+     * Progress of the whole batch, weighted by the estimated size of each
+     * document
+     */
+    int percent() const;
+
+Q_SIGNALS:
+    void progressChanged();
+
+    void failed(const QUrl& url, const QString& errorString);
+
+    void finished();
+
+private Q_SLOTS:
+    void startNextJobs();
+    void slotResult(KJob*);
+
+private:
+    SaveSchedulerPrivate* const d;
+};
+
+} // namespace
+
+#endif /* SAVESCHEDULER_H */
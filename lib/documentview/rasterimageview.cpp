@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/documentview/abstractrasterimageviewtool.h>
 #include <lib/imagescaler.h>
 #include <lib/cms/cmsprofile.h>
+#include <lib/cms/cmstransform.h>
 #include <lib/gvdebug.h>
 
 // KDE
@@ -36,9 +37,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QPointer>
 #include <QDebug>
 
-// LCMS2
-#include <lcms2.h>
-
 
 namespace Gwenview
 {
@@ -68,48 +66,21 @@ struct RasterImageViewPrivate
     QPointer<AbstractRasterImageViewTool> mTool;
 
     bool mApplyDisplayTransform; // Defaults to true. Can be set to false if there is no need or no way to apply color profile
-    cmsHTRANSFORM mDisplayTransform;
+    Cms::Transform::Ptr mDisplayTransform;
 
     void updateDisplayTransform(QImage::Format format)
     {
         GV_RETURN_IF_FAIL(format != QImage::Format_Invalid);
-        mApplyDisplayTransform = false;
-        if (mDisplayTransform) {
-            cmsDeleteTransform(mDisplayTransform);
-        }
-        mDisplayTransform = 0;
-
         Cms::Profile::Ptr profile = q->document()->cmsProfile();
         if (!profile) {
             // The assumption that something unmarked is *probably* sRGB is better than failing to apply any transform when one
             // has a wide-gamut screen.
             profile = Cms::Profile::getSRgbProfile();
         }
-        Cms::Profile::Ptr monitorProfile = Cms::Profile::getMonitorProfile();
-        if (!monitorProfile) {
-            qWarning() << "Could not get monitor color profile";
-            return;
-        }
-
-        cmsUInt32Number cmsFormat = 0;
-        switch (format) {
-        case QImage::Format_RGB32:
-        case QImage::Format_ARGB32:
-            cmsFormat = TYPE_BGRA_8;
-            break;
-#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
-        case QImage::Format_Grayscale8:
-            cmsFormat = TYPE_GRAY_8;
-            break;
-#endif
-        default:
-            qWarning() << "Gwenview can only apply color profile on RGB32 or ARGB32 images";
-            return;
-        }
-        mDisplayTransform = cmsCreateTransform(profile->handle(), cmsFormat,
-                                               monitorProfile->handle(), cmsFormat,
-                                               INTENT_PERCEPTUAL, cmsFLAGS_BLACKPOINTCOMPENSATION);
-        mApplyDisplayTransform = true;
+        // Transforms are cached, so this is cheap unless the document or the
+        // monitor profile changed
+        mDisplayTransform = Cms::Transform::displayTransform(profile, format);
+        mApplyDisplayTransform = bool(mDisplayTransform);
     }
 
     void createBackgroundTexture()
@@ -198,7 +169,6 @@ RasterImageView::RasterImageView(QGraphicsItem* parent)
     d->q = this;
     d->mEmittedCompleted = false;
     d->mApplyDisplayTransform = true;
-    d->mDisplayTransform = 0;
 
     d->mAlphaBackgroundMode = AlphaBackgroundCheckBoard;
     d->mAlphaBackgroundColor = Qt::black;
@@ -214,9 +184,6 @@ RasterImageView::RasterImageView(QGraphicsItem* parent)
 
 RasterImageView::~RasterImageView()
 {
-    if (d->mDisplayTransform) {
-        cmsDeleteTransform(d->mDisplayTransform);
-    }
     delete d;
 }
 
@@ -321,8 +288,9 @@ void RasterImageView::updateFromScaler(int zoomedImageLeft, int zoomedImageTop,
     if (d->mApplyDisplayTransform) {
         d->updateDisplayTransform(image.format());
         if (d->mDisplayTransform) {
-            quint8 *bytes = const_cast<quint8*>(image.bits());
-            cmsDoTransform(d->mDisplayTransform, bytes, bytes, image.width() * image.height());
+            // Transform in place, without detaching the image
+            uchar* bytes = const_cast<uchar*>(image.bits());
+            d->mDisplayTransform->apply(bytes, image.width(), image.height(), image.bytesPerLine());
         }
     }
 
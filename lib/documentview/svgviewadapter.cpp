@@ -23,27 +23,35 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Qt
 #include <QCursor>
-#include <QGraphicsSvgItem>
 #include <QGraphicsTextItem>
 #include <QGraphicsWidget>
+#include <QPainter>
 #include <QSvgRenderer>
 #include <QDebug>
 
+// std
+#include <cmath>
+
 // KDE
 
 // Local
 #include "document/documentfactory.h"
 #include <qgraphicssceneevent.h>
 #include <lib/gvdebug.h>
+#include <lib/svgtilerenderer.h>
 
 namespace Gwenview
 {
 
 /// SvgImageView ////
+static const int TILE_SIZE = SvgTileRenderer::TILE_SIZE;
+
 SvgImageView::SvgImageView(QGraphicsItem* parent)
 : AbstractImageView(parent)
-, mSvgItem(new QGraphicsSvgItem(this))
+, mTileRenderer(new SvgTileRenderer(this))
+, mPreviousZoom(0)
 {
+    connect(mTileRenderer, &SvgTileRenderer::tileReady, this, &SvgImageView::slotTileReady);
 }
 
 void SvgImageView::loadFromDocument()
@@ -61,15 +69,18 @@ void SvgImageView::loadFromDocument()
 
 void SvgImageView::finishLoadFromDocument()
 {
-    QSvgRenderer* renderer = document()->svgRenderer();
-    GV_RETURN_IF_FAIL(renderer);
-    mSvgItem->setSharedRenderer(renderer);
+    Document::Ptr doc = document();
+    GV_RETURN_IF_FAIL(doc);
+    GV_RETURN_IF_FAIL(doc->svgRenderer());
+    mTileRenderer->setData(doc->rawData(), doc->size());
+    mPreviousZoom = 0;
     if (zoomToFit()) {
         setZoom(computeZoomToFit(), QPointF(-1, -1), ForceUpdate);
     } else if (zoomToFitWidth()) {
         setZoom(computeZoomToFitWidth(), QPointF(-1, -1), ForceUpdate);
     } else {
-        mSvgItem->setScale(zoom());
+        mTileRenderer->setCurrentZoom(zoom());
+        update();
     }
     applyPendingScrollPos();
     completed();
@@ -77,23 +88,94 @@ void SvgImageView::finishLoadFromDocument()
 
 void SvgImageView::onZoomChanged()
 {
-    mSvgItem->setScale(zoom());
-    adjustItemPos();
+    mTileRenderer->setCurrentZoom(zoom());
+    update();
 }
 
 void SvgImageView::onImageOffsetChanged()
 {
-    adjustItemPos();
+    update();
 }
 
 void SvgImageView::onScrollPosChanged(const QPointF& /* oldPos */)
 {
-    adjustItemPos();
+    update();
+}
+
+void SvgImageView::slotTileReady(qreal tileZoom)
+{
+    if (tileZoom == zoom()) {
+        update();
+    }
+}
+
+QRect SvgImageView::visibleTileRange() const
+{
+    const QRectF zoomedRect = QRectF(QPointF(0, 0), documentSize() * zoom());
+    const QRectF visibleRect = QRectF(scrollPos(), size()) & zoomedRect;
+    if (visibleRect.isEmpty()) {
+        return QRect();
+    }
+    const int left = int(visibleRect.left()) / TILE_SIZE;
+    const int top = int(visibleRect.top()) / TILE_SIZE;
+    const int right = int(std::ceil(visibleRect.right()) - 1) / TILE_SIZE;
+    const int bottom = int(std::ceil(visibleRect.bottom()) - 1) / TILE_SIZE;
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+void SvgImageView::paint(QPainter* painter, const QStyleOptionGraphicsItem* /*option*/, QWidget* /*widget*/)
+{
+    if (!document() || documentSize().isEmpty()) {
+        return;
+    }
+    const qreal currentZoom = zoom();
+    const QPointF origin = (imageOffset() - scrollPos()).toPoint();
+    const QRect range = visibleTileRange();
+    bool complete = true;
+    for (int row = range.top(); row <= range.bottom(); ++row) {
+        for (int col = range.left(); col <= range.right(); ++col) {
+            const QPointF tilePos(col * TILE_SIZE, row * TILE_SIZE);
+            const QPixmap pix = mTileRenderer->tile(currentZoom, col, row);
+            if (pix.isNull()) {
+                complete = false;
+                drawFallbackTile(painter, origin, QRectF(tilePos, QSizeF(TILE_SIZE, TILE_SIZE)));
+            } else {
+                painter->drawPixmap(origin + tilePos, pix);
+            }
+        }
+    }
+    if (complete) {
+        mPreviousZoom = currentZoom;
+    }
 }
 
-void SvgImageView::adjustItemPos()
+void SvgImageView::drawFallbackTile(QPainter* painter, const QPointF& origin, const QRectF& zoomedRect)
 {
-    mSvgItem->setPos(imageOffset() - scrollPos());
+    if (mPreviousZoom <= 0) {
+        return;
+    }
+    const qreal ratio = zoom() / mPreviousZoom;
+    // Tiles of the previous zoom covering zoomedRect
+    const QRectF previousRect(zoomedRect.topLeft() / ratio, zoomedRect.size() / ratio);
+    const int left = int(previousRect.left()) / TILE_SIZE;
+    const int top = int(previousRect.top()) / TILE_SIZE;
+    const int right = int(std::ceil(previousRect.right()) - 1) / TILE_SIZE;
+    const int bottom = int(std::ceil(previousRect.bottom()) - 1) / TILE_SIZE;
+
+    painter->save();
+    painter->setClipRect(zoomedRect.translated(origin));
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, ratio < 1);
+    for (int row = top; row <= bottom; ++row) {
+        for (int col = left; col <= right; ++col) {
+            const QPixmap pix = mTileRenderer->cachedTile(mPreviousZoom, col, row);
+            if (pix.isNull()) {
+                continue;
+            }
+            const QRectF target(QPointF(col * TILE_SIZE, row * TILE_SIZE) * ratio, QSizeF(pix.size()) * ratio);
+            painter->drawPixmap(target.translated(origin), pix, QRectF(pix.rect()));
+        }
+    }
+    painter->restore();
 }
 
 //// SvgViewAdapter ////
@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Exiv2
 #include <exiv2/error.hpp>
+#include <exiv2/exif.hpp>
 #include <exiv2/types.hpp>
 
 // Local
@@ -78,6 +79,74 @@ bool Exiv2ImageLoader::load(const QByteArray& data)
     return true;
 }
 
+/**
+ * Walks the JPEG markers until the start of the image data, extracting the
+ * EXIF block and the comment. JPEG segments are at most 64KB long, so this
+ * reads a bounded amount of data whatever the size of the XMP or IPTC
+ * blocks.
+ */
+static void readJpegEssentials(const QByteArray& data, Exiv2::Image* image)
+{
+    const uchar* ptr = reinterpret_cast<const uchar*>(data.constData());
+    const int size = data.size();
+    bool exifFound = false;
+    int pos = 2; // Skip SOI marker
+    while (pos + 4 <= size) {
+        if (ptr[pos] != 0xFF) {
+            break;
+        }
+        const uchar marker = ptr[pos + 1];
+        if (marker == 0xFF) {
+            // Fill byte
+            ++pos;
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) {
+            // SOS or EOI: no more metadata
+            break;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+            // Markers without a length
+            pos += 2;
+            continue;
+        }
+        const int length = (ptr[pos + 2] << 8) | ptr[pos + 3];
+        if (length < 2 || pos + 2 + length > size) {
+            break;
+        }
+        const uchar* segment = ptr + pos + 4;
+        const int segmentSize = length - 2;
+        if (marker == 0xE1 && !exifFound && segmentSize > 6 && memcmp(segment, "Exif\0\0", 6) == 0) {
+            Exiv2::ExifData exifData;
+            Exiv2::ExifParser::decode(exifData, segment + 6, segmentSize - 6);
+            image->setExifData(exifData);
+            exifFound = true;
+        } else if (marker == 0xFE) {
+            std::string comment(reinterpret_cast<const char*>(segment), segmentSize);
+            // Strip trailing NUL characters, like Exiv2 does
+            comment = comment.substr(0, comment.find_last_not_of('\0') + 1);
+            image->setComment(comment);
+        }
+        pos += 2 + length;
+    }
+}
+
+bool Exiv2ImageLoader::loadEssentials(const QByteArray& data)
+{
+    try {
+        d->mImage = Exiv2::ImageFactory::open((unsigned char*)data.constData(), data.size());
+        if (d->mImage->mimeType() == "image/jpeg") {
+            readJpegEssentials(data, d->mImage.get());
+        } else {
+            d->mImage->readMetadata();
+        }
+    } catch (const Exiv2::Error& error) {
+        d->mErrorMessage = error.what();
+        return false;
+    }
+    return true;
+}
+
 QString Exiv2ImageLoader::errorMessage() const
 {
     return d->mErrorMessage;
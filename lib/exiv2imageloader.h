@@ -53,6 +53,14 @@ public:
 
     bool load(const QString&);
     bool load(const QByteArray&);
+
+    /**
+     * Like load(const QByteArray&), but for JPEG images only reads the EXIF
+     * block and the comment, which contain everything needed to display
+     * the image (orientation, date, embedded color profile). XMP and IPTC
+     * data are skipped. Other formats are fully loaded.
+     */
+    bool loadEssentials(const QByteArray&);
     QString errorMessage() const;
     Exiv2::Image::AutoPtr popImage();
 
@@ -0,0 +1,63 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "fileitemsortkey.h"
+
+// Local
+#include <lib/archiveutils.h>
+#include <lib/timeutils.h>
+
+// Qt
+#include <QCollator>
+#include <QDateTime>
+
+namespace Gwenview
+{
+
+FileItemSortKey::FileItemSortKey(const KFileItem& item, const QCollator& collator)
+: mItem(item)
+, mIsDirOrArchive(ArchiveUtils::fileItemIsDirOrArchive(item))
+, mIsHidden(item.isHidden())
+, mSize(item.size())
+, mNameKey(collator.sortKey(item.text()))
+, mDateTime(0)
+, mDateTimeValid(false)
+{
+}
+
+qint64 FileItemSortKey::dateTime() const
+{
+    if (!mDateTimeValid) {
+        mDateTime = TimeUtils::dateTimeForFileItem(mItem).toMSecsSinceEpoch();
+        mDateTimeValid = true;
+    }
+    return mDateTime;
+}
+
+const QString& FileItemSortKey::foldedName() const
+{
+    if (mFoldedName.isNull()) {
+        mFoldedName = mItem.text().toCaseFolded();
+    }
+    return mFoldedName;
+}
+
+} // namespace
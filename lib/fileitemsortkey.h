@@ -0,0 +1,98 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef FILEITEMSORTKEY_H
+#define FILEITEMSORTKEY_H
+
+// Local
+#include <lib/gwenviewlib_export.h>
+
+// KDE
+#include <KFileItem>
+
+// Qt
+#include <QCollatorSortKey>
+
+class QCollator;
+
+namespace Gwenview
+{
+
+/**
+ * Holds everything needed to compare two file items when sorting, so that
+ * the costly parts (mime type determination, collation, date lookup) are
+ * done once per item instead of once per comparison.
+ */
+class GWENVIEWLIB_EXPORT FileItemSortKey
+{
+public:
+    /**
+     * @param collator used to compute the name key. It must not be modified
+     * as long as keys created with it are compared.
+     */
+    FileItemSortKey(const KFileItem& item, const QCollator& collator);
+
+    bool isDirOrArchive() const
+    {
+        return mIsDirOrArchive;
+    }
+
+    bool isHidden() const
+    {
+        return mIsHidden;
+    }
+
+    KIO::filesize_t size() const
+    {
+        return mSize;
+    }
+
+    /**
+     * Returns the date of the item, as returned by
+     * TimeUtils::dateTimeForFileItem(), in msecs since epoch. It is
+     * computed on first call, because it may require reading the file.
+     */
+    qint64 dateTime() const;
+
+    int compareName(const FileItemSortKey& other) const
+    {
+        return mNameKey.compare(other.mNameKey);
+    }
+
+    /**
+     * Returns the case folded name of the item, computed on first call.
+     * Not used for sorting, but handy for name filters.
+     */
+    const QString& foldedName() const;
+
+private:
+    KFileItem mItem;
+    bool mIsDirOrArchive;
+    bool mIsHidden;
+    KIO::filesize_t mSize;
+    QCollatorSortKey mNameKey;
+    mutable qint64 mDateTime;
+    mutable bool mDateTimeValid;
+    mutable QString mFoldedName;
+};
+
+} // namespace
+
+#endif /* FILEITEMSORTKEY_H */
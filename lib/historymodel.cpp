@@ -25,9 +25,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QDir>
 #include <QFile>
 #include <QDebug>
+#include <QHash>
+#include <QLockFile>
 #include <QUrl>
 #include <QMimeDatabase>
-#include <QTemporaryFile>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QtConcurrentRun>
 
 // KDE
 #include <KConfig>
@@ -41,89 +48,259 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Local
 #include <lib/urlutils.h>
 
+// STL
+#include <algorithm>
+
 namespace Gwenview
 {
 
-struct HistoryItem : public QStandardItem
+/**
+ * Name of the file holding the history, in the storage dir
+ */
+static const char* HISTORY_FILE_NAME = "history";
+
+/**
+ * Number of items created at startup, and each time a view asks for more
+ */
+static const int FETCH_BATCH_SIZE = 10;
+
+/**
+ * Records are appended to the history file in batches, at most once every
+ * FLUSH_DELAY milliseconds
+ */
+static const int FLUSH_DELAY = 1000;
+
+/**
+ * The history file is rewritten with only the live entries when it contains
+ * more than max(MIN_COMPACTION_RECORD_COUNT, COMPACTION_RATIO * maxCount)
+ * records
+ */
+static const int MIN_COMPACTION_RECORD_COUNT = 100;
+static const int COMPACTION_RATIO = 4;
+
+/**
+ * The history file is read backwards in blocks of this size
+ */
+static const qint64 READ_BLOCK_SIZE = 4096;
+
+/**
+ * An entry of the history file. The file contains one record per line:
+ * "<ISO date time>\t<encoded url>" when the url is visited and
+ * "-\t<encoded url>" when it is removed from the history. Later records
+ * override earlier ones.
+ */
+struct HistoryRecord
 {
-    void save() const
-    {
-        KConfig config(mConfigPath, KConfig::SimpleConfig);
-        KConfigGroup group(&config, "general");
-        group.writeEntry("url", mUrl.toString());
-        group.writeEntry("dateTime", mDateTime.toString(Qt::ISODate));
-        config.sync();
+    QUrl url;
+    // Invalid for removals
+    QDateTime dateTime;
+};
+
+static bool recordIsMoreRecent(const HistoryRecord& record1, const HistoryRecord& record2)
+{
+    return record1.dateTime > record2.dateTime;
+}
+
+static QByteArray recordLine(const QUrl& url, const QDateTime& dateTime)
+{
+    const QByteArray prefix = dateTime.isValid() ? dateTime.toString(Qt::ISODate).toLatin1() : QByteArray("-");
+    // Fully encoded urls cannot contain tabs or new lines
+    return prefix + '\t' + url.toEncoded() + '\n';
+}
+
+static bool parseRecordLine(const QByteArray& line, HistoryRecord* record)
+{
+    const int pos = line.indexOf('\t');
+    if (pos == -1) {
+        return false;
+    }
+    record->url = QUrl::fromEncoded(line.mid(pos + 1));
+    if (!record->url.isValid()) {
+        return false;
     }
+    const QByteArray prefix = line.left(pos);
+    if (prefix == "-") {
+        record->dateTime = QDateTime();
+        return true;
+    }
+    record->dateTime = QDateTime::fromString(QString::fromLatin1(prefix), Qt::ISODate);
+    return record->dateTime.isValid();
+}
 
-    static HistoryItem* create(const QUrl &url, const QDateTime& dateTime, const QString& storageDir)
-    {
-        if (!QDir().mkpath(storageDir)) {
-            qCritical() << "Could not create history dir" << storageDir;
-            return 0;
-        }
-        QTemporaryFile file(storageDir + QStringLiteral("/gvhistoryXXXXXXrc"));
-        file.setAutoRemove(false);
-        if (!file.open()) {
-            qCritical() << "Could not create history file";
-            return 0;
-        }
+static QString lockFilePath(const QString& path)
+{
+    return path + QStringLiteral(".lock");
+}
 
-        HistoryItem* item = new HistoryItem(url, dateTime, file.fileName());
-        item->save();
-        return item;
+// Called from the write thread
+static void appendToFile(const QString& path, const QByteArray& data)
+{
+    // Other Gwenview instances may be writing to the file
+    QLockFile lockFile(lockFilePath(path));
+    if (!lockFile.lock()) {
+        qCritical() << "Could not lock history file" << path;
+        return;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCritical() << "Could not open history file" << path;
+        return;
+    }
+    if (file.write(data) != data.size()) {
+        qCritical() << "Could not write history file" << path;
     }
+}
 
-    static HistoryItem* load(const QString& fileName)
+/**
+ * Called from the write thread. Appends data to the history file, then
+ * rewrites it with one record for each of the maxCount most recent entries.
+ * The file is read again first, so that the records written by other
+ * instances are kept. Finally removes obsoleteFiles.
+ */
+static void compactFile(const QString& path, const QByteArray& data, int maxCount, const QStringList& obsoleteFiles)
+{
+    QLockFile lockFile(lockFilePath(path));
+    if (!lockFile.lock()) {
+        qCritical() << "Could not lock history file" << path;
+        return;
+    }
+    QByteArray content;
     {
-        KConfig config(fileName, KConfig::SimpleConfig);
-        KConfigGroup group(&config, "general");
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly)) {
+            content = file.readAll();
+        }
+    }
+    content += data;
 
-        QUrl url(group.readEntry("url"));
-        if (!url.isValid()) {
-            qCritical() << "Invalid url" << url;
-            return 0;
+    QHash<QUrl, QDateTime> dateTimeForUrl;
+    Q_FOREACH(const QByteArray& line, content.split('\n')) {
+        HistoryRecord record;
+        if (line.isEmpty() || !parseRecordLine(line, &record)) {
+            continue;
         }
-        QDateTime dateTime = QDateTime::fromString(group.readEntry("dateTime"), Qt::ISODate);
-        if (!dateTime.isValid()) {
-            qCritical() << "Invalid dateTime" << dateTime;
-            return 0;
+        if (record.dateTime.isValid()) {
+            dateTimeForUrl.insert(record.url, record.dateTime);
+        } else {
+            dateTimeForUrl.remove(record.url);
         }
+    }
+    QList<HistoryRecord> records;
+    records.reserve(dateTimeForUrl.count());
+    for (auto it = dateTimeForUrl.constBegin(), end = dateTimeForUrl.constEnd(); it != end; ++it) {
+        records << HistoryRecord { it.key(), it.value() };
+    }
+    std::sort(records.begin(), records.end(), recordIsMoreRecent);
 
-        return new HistoryItem(url, dateTime, fileName);
+    // Oldest first, so that the file stays in chronological order as new
+    // records are appended
+    QByteArray compactedContent;
+    for (int pos = qMin(records.count(), maxCount) - 1; pos >= 0; --pos) {
+        compactedContent += recordLine(records.at(pos).url, records.at(pos).dateTime);
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCritical() << "Could not open history file" << path;
+        return;
     }
+    file.write(compactedContent);
+    if (!file.commit()) {
+        qCritical() << "Could not write history file" << path;
+        return;
+    }
+    Q_FOREACH(const QString& obsoleteFile, obsoleteFiles) {
+        QFile::remove(obsoleteFile);
+    }
+}
 
-    QUrl url() const
+/**
+ * Reads the lines of a file backwards, so that the most recent records of
+ * the history file can be read without reading the whole file
+ */
+class BackwardLineReader
+{
+public:
+    BackwardLineReader()
+    : mPos(0)
+    , mLineCount(0)
+    {}
+
+    bool open(const QString& path)
     {
-        return mUrl;
+        mFile.setFileName(path);
+        if (!mFile.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        mPos = mFile.size();
+        return true;
     }
 
-    QDateTime dateTime() const
+    bool atStart() const
     {
-        return mDateTime;
+        return mPos == 0 && mBuffer.isEmpty();
     }
 
-    void setDateTime(const QDateTime& dateTime)
+    /**
+     * Reads the line before the previously read one. Returns false once the
+     * start of the file has been reached.
+     */
+    bool readPreviousLine(QByteArray* line)
     {
-        if (mDateTime != dateTime) {
-            mDateTime = dateTime;
-            save();
+        Q_FOREVER {
+            const int pos = mBuffer.lastIndexOf('\n');
+            if (pos != -1) {
+                *line = mBuffer.mid(pos + 1);
+                mBuffer.truncate(pos);
+                ++mLineCount;
+                return true;
+            }
+            if (mPos == 0) {
+                if (mBuffer.isEmpty()) {
+                    return false;
+                }
+                *line = mBuffer;
+                mBuffer.clear();
+                ++mLineCount;
+                return true;
+            }
+            const qint64 size = qMin(mPos, READ_BLOCK_SIZE);
+            mPos -= size;
+            QByteArray block;
+            if (!mFile.seek(mPos) || (block = mFile.read(size)).size() != size) {
+                qCritical() << "Could not read history file" << mFile.fileName();
+                mPos = 0;
+                mBuffer.clear();
+                return false;
+            }
+            mBuffer.prepend(block);
         }
     }
 
-    void unlink()
+    /**
+     * Estimates the number of lines of the file from the length of the lines
+     * read so far
+     */
+    int estimatedLineCount() const
     {
-        QFile::remove(mConfigPath);
+        const qint64 readSize = mFile.size() - mPos - mBuffer.size();
+        if (readSize <= 0) {
+            return 0;
+        }
+        return int(mFile.size() * mLineCount / readSize);
     }
 
 private:
-    QUrl mUrl;
-    QDateTime mDateTime;
-    QString mConfigPath;
+    QFile mFile;
+    qint64 mPos;
+    QByteArray mBuffer;
+    int mLineCount;
+};
 
-    HistoryItem(const QUrl &url, const QDateTime& dateTime, const QString& configPath)
+struct HistoryItem : public QStandardItem
+{
+    HistoryItem(const QUrl &url, const QDateTime& dateTime)
         : mUrl(url)
-        , mDateTime(dateTime)
-        , mConfigPath(configPath) {
+        , mDateTime(dateTime) {
         setText(mUrl.toDisplayString());
 
         QMimeDatabase db;
@@ -139,6 +316,25 @@ private:
         setData(i18n("Last visited: %1", date), Qt::ToolTipRole);
     }
 
+    QUrl url() const
+    {
+        return mUrl;
+    }
+
+    QDateTime dateTime() const
+    {
+        return mDateTime;
+    }
+
+    void setDateTime(const QDateTime& dateTime)
+    {
+        mDateTime = dateTime;
+    }
+
+private:
+    QUrl mUrl;
+    QDateTime mDateTime;
+
     bool operator<(const QStandardItem& other) const Q_DECL_OVERRIDE {
         return mDateTime > static_cast<const HistoryItem*>(&other)->mDateTime;
     }
@@ -151,55 +347,255 @@ struct HistoryModelPrivate
     int mMaxCount;
 
     QMap<QUrl, HistoryItem*> mHistoryItemForUrl;
+    // Entries for which no item has been created yet, most recent first. They
+    // are all older than the entries which have an item.
+    QList<HistoryRecord> mPendingRecords;
+
+    // Reads the history file from its end, as more entries are needed
+    QScopedPointer<BackwardLineReader> mReader;
+    // Urls whose most recent record has been read or written by this model.
+    // Older records of these urls are ignored by readRecords().
+    QSet<QUrl> mKnownUrls;
+
+    // Number of records in the history file, including unsaved ones
+    int mRecordCount;
+    QByteArray mUnsavedData;
+    QTimer* mFlushTimer;
+    // Runs one write at a time, so that writes reach the file in order
+    QThreadPool mWritePool;
+
+    QString historyFilePath() const
+    {
+        return QDir(mStorageDir).filePath(HISTORY_FILE_NAME);
+    }
 
     void load()
     {
-        QDir dir(mStorageDir);
-        if (!dir.exists()) {
+        const QString path = historyFilePath();
+        if (QFile::exists(path)) {
+            mReader.reset(new BackwardLineReader);
+            if (!mReader->open(path)) {
+                qCritical() << "Could not open history file" << path;
+                mReader.reset();
+            }
+            createItems(FETCH_BATCH_SIZE);
+            if (mReader) {
+                mRecordCount = mReader->estimatedLineCount();
+            }
+            if (mRecordCount > compactionThreshold()) {
+                compact();
+            }
+            return;
+        }
+
+        QHash<QUrl, QDateTime> dateTimeForUrl;
+        const QStringList obsoleteFiles = importRcFiles(&dateTimeForUrl);
+        if (obsoleteFiles.isEmpty()) {
             return;
         }
-        Q_FOREACH(const QString & name, dir.entryList(QStringList() << "*rc")) {
-            HistoryItem* item = HistoryItem::load(dir.filePath(name));
-            if (!item) {
+        QList<HistoryRecord> records;
+        records.reserve(dateTimeForUrl.count());
+        for (auto it = dateTimeForUrl.constBegin(), end = dateTimeForUrl.constEnd(); it != end; ++it) {
+            records << HistoryRecord { it.key(), it.value() };
+        }
+        std::sort(records.begin(), records.end(), recordIsMoreRecent);
+        mPendingRecords = records.mid(0, mMaxCount);
+        QByteArray data;
+        for (int pos = mPendingRecords.count() - 1; pos >= 0; --pos) {
+            const HistoryRecord& record = mPendingRecords.at(pos);
+            mKnownUrls.insert(record.url);
+            data += recordLine(record.url, record.dateTime);
+        }
+        createItems(FETCH_BATCH_SIZE);
+        compact(data, obsoleteFiles);
+    }
+
+    /**
+     * Reads the history stored by older versions, which used one KConfig
+     * file per url. Returns the paths of the files which have been read.
+     */
+    QStringList importRcFiles(QHash<QUrl, QDateTime>* dateTimeForUrl)
+    {
+        QDir dir(mStorageDir);
+        QStringList paths;
+        Q_FOREACH(const QString& name, dir.entryList(QStringList() << "*rc")) {
+            const QString path = dir.filePath(name);
+            paths << path;
+            KConfig config(path, KConfig::SimpleConfig);
+            KConfigGroup group(&config, "general");
+            QUrl url(group.readEntry("url"));
+            QDateTime dateTime = QDateTime::fromString(group.readEntry("dateTime"), Qt::ISODate);
+            if (!url.isValid() || !dateTime.isValid()) {
+                qCritical() << "Invalid history file" << path;
                 continue;
             }
+            if (!dateTimeForUrl->contains(url) || dateTimeForUrl->value(url) < dateTime) {
+                dateTimeForUrl->insert(url, dateTime);
+            }
+        }
+        return paths;
+    }
 
-            QUrl itemUrl = item->url();
-            if (UrlUtils::urlIsFastLocalFile(itemUrl)) {
-                if (!QFile::exists(itemUrl.path())) {
-                    qDebug() << "Removing" << itemUrl.path() << "from recent folders. It does not exist anymore";
-                    item->unlink();
-                    delete item;
-                    continue;
-                }
+    bool isFull() const
+    {
+        return q->rowCount() + mPendingRecords.count() >= mMaxCount;
+    }
+
+    bool canReadRecords() const
+    {
+        return mReader && !mReader->atStart() && !isFull();
+    }
+
+    /**
+     * Reads the history file backwards until count entries have been added
+     * to the pending records
+     */
+    void readRecords(int count)
+    {
+        QByteArray line;
+        while (count > 0 && canReadRecords()) {
+            if (!mReader->readPreviousLine(&line)) {
+                break;
+            }
+            if (line.isEmpty()) {
+                continue;
+            }
+            HistoryRecord record;
+            if (!parseRecordLine(line, &record)) {
+                qWarning() << "Invalid history record" << line;
+                continue;
+            }
+            if (mKnownUrls.contains(record.url)) {
+                continue;
+            }
+            mKnownUrls.insert(record.url);
+            if (!record.dateTime.isValid()) {
+                continue;
             }
+            mPendingRecords << record;
+            --count;
+        }
+        // Records of the file are not sorted if other instances wrote to it
+        // or if the system clock changed
+        std::stable_sort(mPendingRecords.begin(), mPendingRecords.end(), recordIsMoreRecent);
+    }
 
-            HistoryItem* existingItem = mHistoryItemForUrl.value(item->url());
-            if (existingItem) {
-                // We already know this url(!) update existing item dateTime
-                // and get rid of duplicate
-                if (existingItem->dateTime() < item->dateTime()) {
-                    existingItem->setDateTime(item->dateTime());
+    /**
+     * Creates items for the count most recent pending records, reading more
+     * records from the history file when needed
+     */
+    void createItems(int count)
+    {
+        bool created = false;
+        while (count > 0) {
+            if (mPendingRecords.isEmpty()) {
+                readRecords(count);
+                if (mPendingRecords.isEmpty()) {
+                    break;
                 }
-                item->unlink();
-                delete item;
-            } else {
-                mHistoryItemForUrl.insert(item->url(), item);
-                q->appendRow(item);
             }
+            const HistoryRecord record = mPendingRecords.takeFirst();
+            if (UrlUtils::urlIsFastLocalFile(record.url) && !QFile::exists(record.url.path())) {
+                qDebug() << "Removing" << record.url.path() << "from recent folders. It does not exist anymore";
+                appendRecord(record.url, QDateTime());
+                continue;
+            }
+            HistoryItem* item = new HistoryItem(record.url, record.dateTime);
+            mHistoryItemForUrl.insert(record.url, item);
+            q->appendRow(item);
+            created = true;
+            --count;
+        }
+        if (created) {
+            q->sort(0);
+        }
+    }
+
+    void removePendingRecord(const QUrl& url)
+    {
+        auto it = std::find_if(mPendingRecords.begin(), mPendingRecords.end(), [&url](const HistoryRecord& record) {
+            return record.url == url;
+        });
+        if (it != mPendingRecords.end()) {
+            mPendingRecords.erase(it);
         }
-        q->sort(0);
     }
 
     void garbageCollect()
     {
-        while (q->rowCount() > mMaxCount) {
-            HistoryItem* item = static_cast<HistoryItem*>(q->takeRow(q->rowCount() - 1).at(0));
-            mHistoryItemForUrl.remove(item->url());
-            item->unlink();
-            delete item;
+        while (q->rowCount() + mPendingRecords.count() > mMaxCount) {
+            QUrl url;
+            if (!mPendingRecords.isEmpty()) {
+                url = mPendingRecords.takeLast().url;
+            } else {
+                HistoryItem* item = static_cast<HistoryItem*>(q->takeRow(q->rowCount() - 1).at(0));
+                url = item->url();
+                mHistoryItemForUrl.remove(url);
+                delete item;
+            }
+            appendRecord(url, QDateTime());
+        }
+    }
+
+    /**
+     * Records a visit to url, or its removal if dateTime is invalid. Records
+     * are written in batches by flush().
+     */
+    void appendRecord(const QUrl& url, const QDateTime& dateTime)
+    {
+        mKnownUrls.insert(url);
+        mUnsavedData += recordLine(url, dateTime);
+        ++mRecordCount;
+        if (!mFlushTimer->isActive()) {
+            mFlushTimer->start();
         }
     }
+
+    int compactionThreshold() const
+    {
+        return qMax(MIN_COMPACTION_RECORD_COUNT, COMPACTION_RATIO * mMaxCount);
+    }
+
+    bool createStorageDir() const
+    {
+        if (!QDir().mkpath(mStorageDir)) {
+            qCritical() << "Could not create history dir" << mStorageDir;
+            return false;
+        }
+        return true;
+    }
+
+    void flush()
+    {
+        mFlushTimer->stop();
+        if (mRecordCount > compactionThreshold()) {
+            compact();
+            return;
+        }
+        if (mUnsavedData.isEmpty() || !createStorageDir()) {
+            return;
+        }
+        QtConcurrent::run(&mWritePool, appendToFile, historyFilePath(), mUnsavedData);
+        mUnsavedData.clear();
+    }
+
+    /**
+     * Appends data and the unsaved records to the history file, then has it
+     * compacted by the write thread
+     */
+    void compact(const QByteArray& data = QByteArray(), const QStringList& obsoleteFiles = QStringList())
+    {
+        mFlushTimer->stop();
+        const QByteArray unsavedData = data + mUnsavedData;
+        mUnsavedData.clear();
+        if (!createStorageDir()) {
+            return;
+        }
+        // The file may contain entries this model does not know about yet,
+        // assume it ends up full
+        mRecordCount = mMaxCount;
+        QtConcurrent::run(&mWritePool, compactFile, historyFilePath(), unsavedData, mMaxCount, obsoleteFiles);
+    }
 };
 
 HistoryModel::HistoryModel(QObject* parent, const QString& storageDir, int maxCount)
@@ -209,32 +605,60 @@ HistoryModel::HistoryModel(QObject* parent, const QString& storageDir, int maxCo
     d->q = this;
     d->mStorageDir = storageDir;
     d->mMaxCount = maxCount;
+    d->mRecordCount = 0;
+    d->mWritePool.setMaxThreadCount(1);
+    d->mFlushTimer = new QTimer(this);
+    d->mFlushTimer->setInterval(FLUSH_DELAY);
+    d->mFlushTimer->setSingleShot(true);
+    connect(d->mFlushTimer, &QTimer::timeout, this, [this]() {
+        d->flush();
+    });
     d->load();
 }
 
 HistoryModel::~HistoryModel()
 {
+    d->flush();
+    d->mWritePool.waitForDone();
     delete d;
 }
 
 void HistoryModel::addUrl(const QUrl &url, const QDateTime& _dateTime)
 {
     QDateTime dateTime = _dateTime.isValid() ? _dateTime : QDateTime::currentDateTime();
+    d->appendRecord(url, dateTime);
     HistoryItem* historyItem = d->mHistoryItemForUrl.value(url);
     if (historyItem) {
         historyItem->setDateTime(dateTime);
         sort(0);
+        return;
+    }
+    d->removePendingRecord(url);
+    if (!d->mPendingRecords.isEmpty() && dateTime < d->mPendingRecords.first().dateTime) {
+        // Older than entries which have not been fetched yet
+        const HistoryRecord record = { url, dateTime };
+        auto it = std::upper_bound(d->mPendingRecords.begin(), d->mPendingRecords.end(), record, recordIsMoreRecent);
+        d->mPendingRecords.insert(it, record);
     } else {
-        historyItem = HistoryItem::create(url, dateTime, d->mStorageDir);
-        if (!historyItem) {
-            qCritical() << "Could not save history for url" << url;
-            return;
-        }
+        historyItem = new HistoryItem(url, dateTime);
         d->mHistoryItemForUrl.insert(url, historyItem);
         appendRow(historyItem);
         sort(0);
-        d->garbageCollect();
     }
+    d->garbageCollect();
+}
+
+bool HistoryModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && (!d->mPendingRecords.isEmpty() || d->canReadRecords());
+}
+
+void HistoryModel::fetchMore(const QModelIndex& parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+    d->createItems(FETCH_BATCH_SIZE);
 }
 
 bool HistoryModel::removeRows(int start, int count, const QModelIndex& parent)
@@ -244,7 +668,7 @@ bool HistoryModel::removeRows(int start, int count, const QModelIndex& parent)
         HistoryItem* historyItem = static_cast<HistoryItem*>(item(row, 0));
         Q_ASSERT(historyItem);
         d->mHistoryItemForUrl.remove(historyItem->url());
-        historyItem->unlink();
+        d->appendRecord(historyItem->url(), QDateTime());
     }
     return QStandardItemModel::removeRows(start, count, parent);
 }
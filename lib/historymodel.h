@@ -39,7 +39,11 @@ struct HistoryModelPrivate;
 /**
  * A model which maintains a list of urls in the dir specified by the
  * storageDir parameter of its ctor.
- * Each url is stored in a separate KConfig file to avoid concurrency issues.
+ * The urls are stored in a single append-only file, which is compacted when
+ * it grows too much. Changes are written in batches, in a separate thread,
+ * under a lock file so that several instances can share the storage dir.
+ * The file is read from its end: only the most recent entries are read at
+ * startup, views get the others through fetchMore().
  */
 class GWENVIEWLIB_EXPORT HistoryModel : public QStandardItemModel
 {
@@ -52,6 +56,10 @@ public:
 
     virtual bool removeRows(int row, int count, const QModelIndex& parent = QModelIndex()) Q_DECL_OVERRIDE;
 
+    bool canFetchMore(const QModelIndex& parent) const Q_DECL_OVERRIDE;
+
+    void fetchMore(const QModelIndex& parent) Q_DECL_OVERRIDE;
+
 private:
     HistoryModelPrivate* const d;
 };
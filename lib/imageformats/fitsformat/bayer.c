@@ -1723,7 +1723,7 @@ dc1394error_t dc1394_bayer_VNG(const uint8_t *bayer, uint8_t *dst, int sx, int s
                                dc1394color_filter_t pattern)
 {
     const int height = sy, width = sx;
-    static const signed char *cp;
+    const signed char *cp;
     /* the following has the same type as the image */
     uint8_t(*brow[5])[3], *pix; /* [FD] */
     int code[8][2][320], *ip, gval[8], gmin, gmax, sum[4];
@@ -1867,7 +1867,7 @@ dc1394error_t dc1394_bayer_VNG_uint16(const uint16_t *bayer, uint16_t *dst, int
                                       dc1394color_filter_t pattern, int bits)
 {
     const int height = sy, width = sx;
-    static const signed char *cp;
+    const signed char *cp;
     /* the following has the same type as the image */
     uint16_t(*brow[5])[3], *pix; /* [FD] */
     int code[8][2][320], *ip, gval[8], gmin, gmax, sum[4];
@@ -2009,7 +2009,7 @@ dc1394error_t dc1394_bayer_VNG_uint16(const uint16_t *bayer, uint16_t *dst, int
 }
 
 /* AHD interpolation ported from dcraw to libdc1394 by Samuel Audet */
-static dc1394bool_t ahd_inited = DC1394_FALSE; /* WARNING: not multi-processor safe */
+static dc1394bool_t ahd_inited = DC1394_FALSE; /* see dc1394_bayer_init() */
 
 #define CLIPOUT(x)         LIM(x, 0, 255)
 #define CLIPOUT16(x, bits) LIM(x, 0, ((1 << bits) - 1))
@@ -2056,6 +2056,15 @@ static void cam_to_cielab(uint16_t cam[3], float lab[3]) /* [SA] */
     }
 }
 
+void dc1394_bayer_init(void)
+{
+    if (ahd_inited == DC1394_FALSE)
+    {
+        cam_to_cielab(NULL, NULL);
+        ahd_inited = DC1394_TRUE;
+    }
+}
+
 /*
    Adaptive Homogeneity-Directed interpolation is based on
    the work of Keigo Hirakawa, Thomas Parks, and Paul Lee.
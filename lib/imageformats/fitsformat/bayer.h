@@ -258,6 +258,13 @@ typedef struct
 extern "C" {
 #endif
 
+/**
+ * Fills the tables used by DC1394_BAYER_METHOD_AHD. The decoding functions
+ * do it on first use, which is not thread-safe: call this before decoding
+ * from several threads.
+ */
+void dc1394_bayer_init(void);
+
 /**
  * Perform de-mosaicing on an 8-bit image buffer
  */
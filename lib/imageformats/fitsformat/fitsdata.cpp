@@ -22,10 +22,148 @@ Gwenview: an image viewer
 
 #include "fitsdata.h"
 
+#include <lib/parallelutils.h>
+
 #include <QApplication>
+#include <QAtomicInt>
+#include <QBuffer>
+#include <QFile>
 #include <QImage>
+#include <QMutex>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <math.h>
+#include <vector>
+
+namespace
+{
+
+/**
+ * Minimum number of samples processed by each thread when computing
+ * statistics or converting the image
+ */
+const int MIN_SAMPLES_PER_STRIPE = 256 * 1024;
+
+/**
+ * Number of samples whose mean and M2 are computed with two passes before
+ * being merged: small enough for the second pass to hit the cache
+ */
+const int STATS_BLOCK_SIZE = 4096;
+
+/**
+ * Mean and sum of squared differences from the mean (M2) of a range of
+ * samples. Ranges are combined with the pairwise formula of Chan et al., so
+ * that they can be computed independently.
+ */
+struct PartialStats
+{
+    double count { 0 };
+    double mean { 0 };
+    double m2 { 0 };
+
+    void merge(const PartialStats &other)
+    {
+        if (other.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        const double total = count + other.count;
+        const double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count = total;
+    }
+};
+
+template <typename T>
+PartialStats blockStats(const T *buffer, int count)
+{
+    PartialStats stats;
+    if (std::numeric_limits<T>::has_quiet_NaN) {
+        // NaN is the usual value of blank samples in floating point images,
+        // leave them out
+        double sum     = 0;
+        int validCount = 0;
+        for (int i = 0; i < count; i++) {
+            if (!std::isnan(buffer[i])) {
+                sum += buffer[i];
+                validCount++;
+            }
+        }
+        if (validCount == 0) {
+            return stats;
+        }
+        stats.count = validCount;
+        stats.mean  = sum / validCount;
+        double m2   = 0;
+        for (int i = 0; i < count; i++) {
+            if (!std::isnan(buffer[i])) {
+                const double delta = buffer[i] - stats.mean;
+                m2 += delta * delta;
+            }
+        }
+        stats.m2 = m2;
+        return stats;
+    }
+
+    // Two simple loops, which compilers can vectorize, unlike the serial
+    // recurrence of Welford's method
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += buffer[i];
+    }
+    stats.count = count;
+    stats.mean  = sum / count;
+    double m2   = 0;
+    for (int i = 0; i < count; i++) {
+        const double delta = buffer[i] - stats.mean;
+        m2 += delta * delta;
+    }
+    stats.m2 = m2;
+    return stats;
+}
+
+/**
+ * Number of rows demosaiced above and below each tile, so that the
+ * interpolation of the rows of the tile is not affected by the tile borders.
+ * Must be even to keep the Bayer pattern.
+ */
+const int BAYER_TILE_MARGIN = 8;
+
+dc1394error_t decodeBayer(const uint8_t *bayer, uint8_t *rgb, int width, int height,
+                          dc1394color_filter_t tile, dc1394bayer_method_t method)
+{
+    return dc1394_bayer_decoding_8bit(bayer, rgb, width, height, tile, method);
+}
+
+dc1394error_t decodeBayer(const uint16_t *bayer, uint16_t *rgb, int width, int height,
+                          dc1394color_filter_t tile, dc1394bayer_method_t method)
+{
+    return dc1394_bayer_decoding_16bit(bayer, rgb, width, height, tile, method, 16);
+}
+
+/**
+ * Clamps value between dataMin and dataMax, then maps it linearly to 0-255.
+ * NaN, the usual blank value of floating point images, is mapped like
+ * dataMax.
+ */
+inline unsigned char stretch(float value, float dataMin, float dataMax, float scale, float zero)
+{
+    if (std::isnan(value)) {
+        // Casting NaN to an integer is undefined
+        value = dataMax;
+    }
+    value = std::min(std::max(value, dataMin), dataMax) * scale + zero;
+    // Written so that a NaN coming from the parameters gives 0
+    return (unsigned char)std::min(255.f, std::max(0.f, value));
+}
+
+} // namespace
 
 FITSData::FITSData()
 {
@@ -46,45 +184,64 @@ FITSData::~FITSData()
     }
 }
 
-bool FITSData::loadFITS(QIODevice &buffer)
+bool FITSData::openFITS(QIODevice &buffer)
 {
-    int status = 0, anynull = 0;
+    int status = 0;
     long naxes[3];
     char error_status[512];
-    QString errMessage;
-    qint64 oldPos = buffer.pos();
-    QByteArray imageData;
-    char* imageDataBuf = nullptr;
-    size_t imageDataSize = 0;
-
-    buffer.seek(0);
-    imageData = buffer.readAll();
-    imageDataBuf = imageData.data();
-    imageDataSize = (size_t)imageData.size();
 
     if (fptr) {
         fits_close_file(fptr, &status);
+        fptr   = nullptr;
+        status = 0;
+    }
+    fileData.clear();
+
+    QFile *file     = qobject_cast<QFile *>(&buffer);
+    QBuffer *memory = qobject_cast<QBuffer *>(&buffer);
+    if (file && !file->fileName().isEmpty() && !file->fileName().startsWith(':')) {
+        // Let cfitsio read the file itself, instead of loading all of it in
+        // memory first. fits_open_diskfile() does not interpret brackets in
+        // the file name as the extended file name syntax.
+        filename = file->fileName();
+        if (fits_open_diskfile(&fptr, QFile::encodeName(filename).constData(), READONLY, &status)) {
+            fptr = nullptr;
+        }
+    } else {
+        if (memory) {
+            // Read directly from the buffer, it outlives us
+            fileAddress = const_cast<char *>(memory->data().constData());
+            fileSize    = memory->data().size();
+        } else {
+            qint64 oldPos = buffer.pos();
+            buffer.seek(0);
+            fileData = buffer.readAll();
+            buffer.seek(oldPos);
+            fileAddress = fileData.data();
+            fileSize    = fileData.size();
+        }
+        // cfitsio keeps pointers to fileAddress and fileSize, they must
+        // remain valid as long as the file is open
+        if (fits_open_memfile(&fptr, "", READONLY, &fileAddress, &fileSize, 3000, nullptr, &status)) {
+            fptr = nullptr;
+        }
     }
-
-    if (fits_open_memfile(&fptr, "", READONLY, reinterpret_cast<void**>(&imageDataBuf), &imageDataSize, 3000, nullptr, &status)) {
+    if (!fptr) {
         fits_report_error(stderr, status);
         fits_get_errstatus(status, error_status);
-        errMessage = QString("Could not open file %1. Error %2").arg(filename, QString::fromUtf8(error_status));
-        buffer.seek(oldPos);
+        lastError = QString("Could not open file %1. Error %2").arg(filename, QString::fromUtf8(error_status));
         return false;
     }
 
     if (fits_get_img_param(fptr, 3, &(stats.bitpix), &(stats.ndim), naxes, &status)) {
         fits_report_error(stderr, status);
         fits_get_errstatus(status, error_status);
-        errMessage = QString("FITS file open error (fits_get_img_param): %1").arg(QString::fromUtf8(error_status));
-        buffer.seek(oldPos);
+        lastError = QString("FITS file open error (fits_get_img_param): %1").arg(QString::fromUtf8(error_status));
         return false;
     }
 
     if (stats.ndim < 2) {
-        errMessage = "1D FITS images are not supported.";
-        buffer.seek(oldPos);
+        lastError = "1D FITS images are not supported.";
         return false;
     }
 
@@ -125,7 +282,7 @@ bool FITSData::loadFITS(QIODevice &buffer)
         stats.bytesPerPixel = sizeof(double);
         break;
     default:
-        errMessage = QString("Bit depth %1 is not supported.").arg(stats.bitpix);
+        lastError = QString("Bit depth %1 is not supported.").arg(stats.bitpix);
         return false;
         break;
     }
@@ -135,8 +292,7 @@ bool FITSData::loadFITS(QIODevice &buffer)
     }
 
     if (naxes[0] == 0 || naxes[1] == 0) {
-        errMessage = QString("Image has invalid dimensions %1x%2").arg(naxes[0], naxes[1]);
-        buffer.seek(oldPos);
+        lastError = QString("Image has invalid dimensions %1x%2").arg(naxes[0], naxes[1]);
         return false;
     }
 
@@ -144,26 +300,75 @@ bool FITSData::loadFITS(QIODevice &buffer)
     stats.height              = naxes[1];
     stats.samples_per_channel = stats.width * stats.height;
 
-    clearImageBuffers();
-
     channels = naxes[2];
+    return true;
+}
 
-    imageBuffer = new uint8_t[stats.samples_per_channel * channels * stats.bytesPerPixel];
+bool FITSData::loadFITSHeader(QIODevice &buffer)
+{
+    return openFITS(buffer);
+}
 
-    long nelements = stats.samples_per_channel * channels;
+bool FITSData::loadFITS(QIODevice &buffer, const QSize &scaledSize)
+{
+    int status = 0, anynull = 0;
 
-    if (fits_read_img(fptr, data_type, 1, nelements, 0, imageBuffer, &anynull, &status)) {
-        char errmsg[512];
-        fits_get_errstatus(status, errmsg);
-        errMessage = QString("Error reading image: %1").arg(errmsg);
-        fits_report_error(stderr, status);
-        buffer.seek(oldPos);
+    if (!openFITS(buffer)) {
         return false;
     }
 
+    clearImageBuffers();
+
+    // Subsampling a Bayer mosaic would mix up the color sites, but the
+    // mosaic can be demosaiced at half size
+    const bool hasBayerPattern = checkDebayer();
+    int factor = 1;
+    debayerHalfSize = false;
+    if (scaledSize.isValid() && !scaledSize.isEmpty()) {
+        factor = qMax(1, qMin(stats.width / scaledSize.width(), stats.height / scaledSize.height()));
+        if (hasBayerPattern) {
+            debayerHalfSize = factor >= 2;
+            factor = 1;
+        }
+    }
+
+    if (factor == 1) {
+        imageBuffer = new uint8_t[size_t(stats.samples_per_channel) * channels * stats.bytesPerPixel];
+
+        long nelements = stats.samples_per_channel * channels;
+
+        if (fits_read_img(fptr, data_type, 1, nelements, 0, imageBuffer, &anynull, &status)) {
+            char errmsg[512];
+            fits_get_errstatus(status, errmsg);
+            lastError = QString("Error reading image: %1").arg(errmsg);
+            fits_report_error(stderr, status);
+            return false;
+        }
+    } else {
+        // Only read one pixel out of factor in each direction: cfitsio skips
+        // the others, so the full size image is never stored in memory
+        long fpixel[3] = { 1, 1, 1 };
+        long lpixel[3] = { stats.width, stats.height, channels };
+        long inc[3]    = { factor, factor, 1 };
+
+        stats.width               = (stats.width - 1) / factor + 1;
+        stats.height              = (stats.height - 1) / factor + 1;
+        stats.samples_per_channel = stats.width * stats.height;
+
+        imageBuffer = new uint8_t[size_t(stats.samples_per_channel) * channels * stats.bytesPerPixel];
+
+        if (fits_read_subset(fptr, data_type, fpixel, lpixel, inc, nullptr, imageBuffer, &anynull, &status)) {
+            char errmsg[512];
+            fits_get_errstatus(status, errmsg);
+            lastError = QString("Error reading image: %1").arg(errmsg);
+            fits_report_error(stderr, status);
+            return false;
+        }
+    }
+
     calculateStats();
 
-    if (checkDebayer()) {
+    if (hasBayerPattern) {
         bayerBuffer = imageBuffer;
         debayer();
     }
@@ -299,68 +504,58 @@ int FITSData::calculateMinMax(bool refresh)
 template <typename T>
 void FITSData::calculateMinMax()
 {
-    T *buffer = reinterpret_cast<T *>(imageBuffer);
-
-    if (channels == 1) {
-        for (unsigned int i = 0; i < stats.samples_per_channel; i++) {
-            if (buffer[i] < stats.min[0]) {
-                stats.min[0] = buffer[i];
-            } else
-            if (buffer[i] > stats.max[0]) {
-                stats.max[0] = buffer[i];
-            }
-        }
-    }
-    else
-    {
-        int g_offset = stats.samples_per_channel;
-        int b_offset = stats.samples_per_channel * 2;
-
-        for (unsigned int i = 0; i < stats.samples_per_channel; i++) {
-            if (buffer[i] < stats.min[0]) {
-                stats.min[0] = buffer[i];
-            } else
-            if (buffer[i] > stats.max[0]) {
-                stats.max[0] = buffer[i];
-            }
-
-            if (buffer[i + g_offset] < stats.min[1]) {
-                stats.min[1] = buffer[i + g_offset];
-            } else
-            if (buffer[i + g_offset] > stats.max[1]) {
-                stats.max[1] = buffer[i + g_offset];
+    const T *buffer = reinterpret_cast<T *>(imageBuffer);
+    const int width = stats.width;
+    const int channelCount = channels == 1 ? 1 : 3;
+    QMutex mutex;
+
+    for (int channel = 0; channel < channelCount; channel++) {
+        const T *channelBuffer = buffer + size_t(stats.samples_per_channel) * channel;
+
+        Gwenview::ParallelUtils::forEachRowStripe(stats.height, MIN_SAMPLES_PER_STRIPE / width, [&](int begin, int end) {
+            const T *it   = channelBuffer + size_t(begin) * width;
+            const T *last = channelBuffer + size_t(end) * width;
+            // Independent min and max reductions, so that both are updated
+            // for every sample and the loop can be vectorized
+            T minValue = std::numeric_limits<T>::max();
+            T maxValue = std::numeric_limits<T>::lowest();
+            for (; it != last; ++it) {
+                minValue = std::min(minValue, *it);
+                maxValue = std::max(maxValue, *it);
             }
 
-            if (buffer[i + b_offset] < stats.min[2]) {
-                stats.min[2] = buffer[i + b_offset];
-            } else
-            if (buffer[i + b_offset] > stats.max[2]) {
-                stats.max[2] = buffer[i + b_offset];
-            }
-        }
+            QMutexLocker locker(&mutex);
+            stats.min[channel] = std::min(stats.min[channel], double(minValue));
+            stats.max[channel] = std::max(stats.max[channel], double(maxValue));
+        });
     }
 }
 
 template <typename T>
 void FITSData::runningAverageStdDev()
 {
-    T *buffer     = reinterpret_cast<T *>(imageBuffer);
-    int m_n       = 2;
-    double m_oldM = 0, m_newM = 0, m_oldS = 0, m_newS = 0;
-
-    m_oldM = m_newM = buffer[0];
-    for (unsigned int i = 1; i < stats.samples_per_channel; i++) {
-        m_newM = m_oldM + (buffer[i] - m_oldM) / m_n;
-        m_newS = m_oldS + (buffer[i] - m_oldM) * (buffer[i] - m_newM);
+    const T *buffer = reinterpret_cast<T *>(imageBuffer);
+    const int width = stats.width;
+    PartialStats total;
+    QMutex mutex;
+
+    Gwenview::ParallelUtils::forEachRowStripe(stats.height, MIN_SAMPLES_PER_STRIPE / width, [&](int begin, int end) {
+        const T *stripe    = buffer + size_t(begin) * width;
+        const size_t count = size_t(end - begin) * width;
+        PartialStats stripeStats;
+
+        for (size_t offset = 0; offset < count; offset += STATS_BLOCK_SIZE) {
+            const int blockSize = int(std::min(count - offset, size_t(STATS_BLOCK_SIZE)));
+            stripeStats.merge(blockStats(stripe + offset, blockSize));
+        }
 
-        m_oldM = m_newM;
-        m_oldS = m_newS;
-        m_n++;
-    }
+        QMutexLocker locker(&mutex);
+        total.merge(stripeStats);
+    });
 
-    double variance = (m_n == 2 ? 0 : m_newS / (m_n - 2));
+    double variance = (total.count < 2 ? 0 : total.m2 / (total.count - 1));
 
-    stats.mean[0]   = m_newM;
+    stats.mean[0]   = total.mean;
     stats.stddev[0] = sqrt(variance);
 }
 
@@ -456,115 +651,168 @@ bool FITSData::debayer()
 
 bool FITSData::debayer_8bit()
 {
-    dc1394error_t error_code;
+    return debayer<uint8_t>();
+}
 
-    int rgb_size               = stats.samples_per_channel * 3 * stats.bytesPerPixel;
-    uint8_t *destinationBuffer = new uint8_t[rgb_size];
+bool FITSData::debayer_16bit()
+{
+    return debayer<uint16_t>();
+}
 
-    int ds1394_height      = stats.height;
-    uint8_t *dc1394_source = bayerBuffer;
+template <typename T>
+bool FITSData::debayer()
+{
+    const T *source = reinterpret_cast<const T *>(bayerBuffer);
+    const int width = stats.width;
+    int height      = stats.height;
 
     if (debayerParams.offsetY == 1) {
-        dc1394_source += stats.width;
-        ds1394_height--;
+        source += width;
+        height--;
     }
 
     if (debayerParams.offsetX == 1) {
-        dc1394_source++;
+        source++;
     }
 
-    error_code = dc1394_bayer_decoding_8bit(dc1394_source, destinationBuffer, stats.width, ds1394_height,
-                                            debayerParams.filter, debayerParams.method);
-
-    if (error_code != DC1394_SUCCESS) {
+    const bool ok = debayerHalfSize ? debayerSuperPixel(source, width, height) : debayerTiled(source, width, height);
+    if (!ok) {
         channels = 1;
-        delete[] destinationBuffer;
         return false;
     }
 
-    if (channels == 1) {
-        delete[] imageBuffer;
-        imageBuffer = new uint8_t[rgb_size];
-    }
-
-    // Data in R1G1B1, we need to copy them into 3 layers for FITS
-
-    uint8_t *rBuff = imageBuffer;
-    uint8_t *gBuff = imageBuffer + (stats.width * stats.height);
-    uint8_t *bBuff = imageBuffer + (stats.width * stats.height * 2);
-
-    int imax = stats.samples_per_channel * 3 - 3;
-    for (int i = 0; i <= imax; i += 3) {
-        *rBuff++ = destinationBuffer[i];
-        *gBuff++ = destinationBuffer[i + 1];
-        *bBuff++ = destinationBuffer[i + 2];
-    }
-
-    channels = 3;
-    delete[] destinationBuffer;
+    channels    = 3;
     bayerBuffer = nullptr;
     return true;
 }
 
-bool FITSData::debayer_16bit()
+template <typename T>
+bool FITSData::debayerTiled(const T *source, int width, int height)
 {
-    dc1394error_t error_code;
-
-    int rgb_size               = stats.samples_per_channel * 3 * stats.bytesPerPixel;
-    uint8_t *destinationBuffer = new uint8_t[rgb_size];
-
-    uint16_t *buffer    = reinterpret_cast<uint16_t *>(bayerBuffer);
-    uint16_t *dstBuffer = reinterpret_cast<uint16_t *>(destinationBuffer);
+    const size_t planeSize = stats.samples_per_channel;
+    uint8_t *destination   = new uint8_t[planeSize * 3 * sizeof(T)];
+    T *rPlane              = reinterpret_cast<T *>(destination);
+    T *gPlane              = rPlane + planeSize;
+    T *bPlane              = gPlane + planeSize;
+    QAtomicInt failed;
+
+    // Tiles are decoded concurrently, but the AHD tables are filled lazily
+    // by the first decoding
+    if (debayerParams.method == DC1394_BAYER_METHOD_AHD) {
+        dc1394_bayer_init();
+    }
+
+    // Stripes start on even rows, so that each tile has the same Bayer
+    // pattern as the whole image
+    const int pairCount = (height + 1) / 2;
+    Gwenview::ParallelUtils::forEachRowStripe(pairCount, MIN_SAMPLES_PER_STRIPE / (2 * width), [&](int beginPair, int endPair) {
+        const int begin      = beginPair * 2;
+        const int end        = std::min(endPair * 2, height);
+        const int tileBegin  = std::max(0, begin - BAYER_TILE_MARGIN);
+        const int tileEnd    = std::min(height, end + BAYER_TILE_MARGIN);
+        const int tileHeight = tileEnd - tileBegin;
+
+        std::vector<T> rgb(size_t(tileHeight) * width * 3);
+        if (decodeBayer(source + size_t(tileBegin) * width, rgb.data(), width, tileHeight,
+                        debayerParams.filter, debayerParams.method) != DC1394_SUCCESS) {
+            failed.store(1);
+            return;
+        }
 
-    int ds1394_height       = stats.height;
-    uint16_t *dc1394_source = buffer;
+        // Data in R1G1B1, copy the rows of the tile which are not part of
+        // its margins into 3 layers for FITS
+        for (int y = begin; y < end; y++) {
+            const T *in = rgb.data() + size_t(y - tileBegin) * width * 3;
+            T *r        = rPlane + size_t(y) * width;
+            T *g        = gPlane + size_t(y) * width;
+            T *b        = bPlane + size_t(y) * width;
+            for (int x = 0; x < width; x++) {
+                r[x] = in[x * 3];
+                g[x] = in[x * 3 + 1];
+                b[x] = in[x * 3 + 2];
+            }
+        }
+    });
 
-    if (debayerParams.offsetY == 1) {
-        dc1394_source += stats.width;
-        ds1394_height--;
+    if (failed.load()) {
+        delete[] destination;
+        return false;
     }
 
-    if (debayerParams.offsetX == 1) {
-        dc1394_source++;
+    // The last row is skipped when the pattern starts on the second row
+    for (int y = height; y < stats.height; y++) {
+        std::fill_n(rPlane + size_t(y) * width, width, T(0));
+        std::fill_n(gPlane + size_t(y) * width, width, T(0));
+        std::fill_n(bPlane + size_t(y) * width, width, T(0));
     }
 
-    error_code = dc1394_bayer_decoding_16bit(dc1394_source, dstBuffer, stats.width, ds1394_height, debayerParams.filter,
-                                             debayerParams.method, 16);
+    delete[] imageBuffer;
+    imageBuffer = destination;
+    return true;
+}
 
-    if (error_code != DC1394_SUCCESS) {
-        channels = 1;
-        delete[] destinationBuffer;
+template <typename T>
+bool FITSData::debayerSuperPixel(const T *source, int width, int height)
+{
+    const int halfWidth  = width / 2;
+    const int halfHeight = height / 2;
+    if (halfWidth == 0 || halfHeight == 0) {
         return false;
     }
 
-    if (channels == 1) {
-        delete[] imageBuffer;
-        imageBuffer = new uint8_t[rgb_size];
-
-        if (!imageBuffer) {
-            delete[] destinationBuffer;
-            return false;
-        }
-    }
-
-    buffer = reinterpret_cast<uint16_t *>(imageBuffer);
-
-    // Data in R1G1B1, we need to copy them into 3 layers for FITS
-
-    uint16_t *rBuff = buffer;
-    uint16_t *gBuff = buffer + (stats.width * stats.height);
-    uint16_t *bBuff = buffer + (stats.width * stats.height * 2);
-
-    int imax = stats.samples_per_channel * 3 - 3;
-    for (int i = 0; i <= imax; i += 3) {
-        *rBuff++ = dstBuffer[i];
-        *gBuff++ = dstBuffer[i + 1];
-        *bBuff++ = dstBuffer[i + 2];
+    // Position of the red and blue sites in each 2x2 cell, green sites are
+    // on the other diagonal
+    int redX = 0, redY = 0;
+    switch (debayerParams.filter)
+    {
+    case DC1394_COLOR_FILTER_RGGB:
+        redX = 0;
+        redY = 0;
+        break;
+    case DC1394_COLOR_FILTER_GBRG:
+        redX = 0;
+        redY = 1;
+        break;
+    case DC1394_COLOR_FILTER_GRBG:
+        redX = 1;
+        redY = 0;
+        break;
+    case DC1394_COLOR_FILTER_BGGR:
+        redX = 1;
+        redY = 1;
+        break;
+    default:
+        return false;
     }
+    const int blueX = 1 - redX;
+    const int blueY = 1 - redY;
+
+    const size_t planeSize = size_t(halfWidth) * halfHeight;
+    uint8_t *destination   = new uint8_t[planeSize * 3 * sizeof(T)];
+    T *rPlane              = reinterpret_cast<T *>(destination);
+    T *gPlane              = rPlane + planeSize;
+    T *bPlane              = gPlane + planeSize;
+
+    Gwenview::ParallelUtils::forEachRowStripe(halfHeight, MIN_SAMPLES_PER_STRIPE / (4 * halfWidth), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            const T *cell[2] = { source + size_t(y * 2) * width, source + size_t(y * 2 + 1) * width };
+            T *r = rPlane + size_t(y) * halfWidth;
+            T *g = gPlane + size_t(y) * halfWidth;
+            T *b = bPlane + size_t(y) * halfWidth;
+            for (int x = 0; x < halfWidth; x++) {
+                const int cellX = x * 2;
+                r[x] = cell[redY][cellX + redX];
+                b[x] = cell[blueY][cellX + blueX];
+                g[x] = (int(cell[redY][cellX + blueX]) + cell[blueY][cellX + redX]) / 2;
+            }
+        }
+    });
 
-    channels = 3;
-    delete[] destinationBuffer;
-    bayerBuffer = nullptr;
+    delete[] imageBuffer;
+    imageBuffer               = destination;
+    stats.width               = halfWidth;
+    stats.height              = halfHeight;
+    stats.samples_per_channel = planeSize;
     return true;
 }
 
@@ -576,55 +824,62 @@ QString FITSData::getLastError() const
 template <typename T>
 void FITSData::convertToQImage(double dataMin, double dataMax, double scale, double zero, QImage &image)
 {
-    T *buffer = (T*)getImageBuffer();
+    const T *buffer = reinterpret_cast<const T *>(getImageBuffer());
     const T limit   = std::numeric_limits<T>::max();
-    T bMin    = dataMin < 0 ? 0 : dataMin;
-    T bMax    = dataMax > limit ? limit : dataMax;
-    uint16_t w    = getWidth();
-    uint16_t h    = getHeight();
-    uint32_t size = getSize();
-    double val;
+    const T bMin    = dataMin < 0 ? 0 : dataMin;
+    const T bMax    = dataMax > limit ? limit : dataMax;
+    const int w     = getWidth();
+    const size_t size = getSize();
+    // Get the pointer once: calling scanLine() from the worker threads would
+    // make each of them check whether the image must be detached
+    uchar *bits = image.bits();
+    const int stride = image.bytesPerLine();
+
+    // Single precision is more than enough to compute 8 bit values, and lets
+    // compilers process twice as many samples per vector instruction
+    const float fMin   = bMin;
+    const float fMax   = bMax;
+    const float fScale = scale;
+    const float fZero  = zero;
 
     if (getNumOfChannels() == 1) {
-        /* Fill in pixel values using indexed map, linear scale */
-        for (int j = 0; j < h; j++) {
-            unsigned char *scanLine = image.scanLine(j);
-
-            for (int i = 0; i < w; i++) {
-                val         = qBound(bMin, buffer[j * w + i], bMax);
-                val         = val * scale + zero;
-                scanLine[i] = qBound<unsigned char>(0, (unsigned char)val, 255);
+        Gwenview::ParallelUtils::forEachRowStripe(getHeight(), MIN_SAMPLES_PER_STRIPE / w, [&](int begin, int end) {
+            for (int j = begin; j < end; j++) {
+                unsigned char *scanLine = bits + size_t(j) * stride;
+                const T *line           = buffer + size_t(j) * w;
+
+                for (int i = 0; i < w; i++) {
+                    scanLine[i] = stretch(line[i], fMin, fMax, fScale, fZero);
+                }
             }
-        }
+        });
     }
     else
     {
-        double rval = 0, gval = 0, bval = 0;
-        QRgb value;
-        /* Fill in pixel values using indexed map, linear scale */
-        for (int j = 0; j < h; j++) {
-            QRgb *scanLine = reinterpret_cast<QRgb *>((image.scanLine(j)));
-
-            for (int i = 0; i < w; i++) {
-                rval = qBound(bMin, buffer[j * w + i], bMax);
-                gval = qBound(bMin, buffer[j * w + i + size], bMax);
-                bval = qBound(bMin, buffer[j * w + i + size * 2], bMax);
-
-                value = qRgb(rval * scale + zero, gval * scale + zero, bval * scale + zero);
-
-                scanLine[i] = value;
+        Gwenview::ParallelUtils::forEachRowStripe(getHeight(), MIN_SAMPLES_PER_STRIPE / w, [&](int begin, int end) {
+            for (int j = begin; j < end; j++) {
+                QRgb *scanLine = reinterpret_cast<QRgb *>(bits + size_t(j) * stride);
+                const T *rLine = buffer + size_t(j) * w;
+                const T *gLine = rLine + size;
+                const T *bLine = rLine + size * 2;
+
+                for (int i = 0; i < w; i++) {
+                    scanLine[i] = qRgb(stretch(rLine[i], fMin, fMax, fScale, fZero),
+                                       stretch(gLine[i], fMin, fMax, fScale, fZero),
+                                       stretch(bLine[i], fMin, fMax, fScale, fZero));
+                }
             }
-        }
+        });
     }
 }
 
-QImage FITSData::FITSToImage(QIODevice &buffer)
+QImage FITSData::FITSToImage(QIODevice &buffer, const QSize &scaledSize)
 {
     QImage fitsImage;
     double min, max;
     FITSData data;
 
-    bool rc = data.loadFITS(buffer);
+    bool rc = data.loadFITS(buffer, scaledSize);
 
     if (rc == false) {
         return fitsImage;
@@ -693,5 +948,11 @@ QImage FITSData::FITSToImage(QIODevice &buffer)
         break;
     }
 
+    // The image has been subsampled to a size close to scaledSize, finish
+    // the job
+    if (scaledSize.isValid() && !scaledSize.isEmpty() && fitsImage.size() != scaledSize) {
+        fitsImage = fitsImage.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
     return fitsImage;
 }
@@ -37,6 +37,7 @@ typedef enum { FITS_NORMAL, FITS_FOCUS, FITS_GUIDE, FITS_CALIBRATE, FITS_ALIGN }
 #include <QObject>
 #include <QRect>
 #include <QRectF>
+#include <QSize>
 
 class QProgressDialog;
 
@@ -46,8 +47,11 @@ class FITSData
     FITSData();
     ~FITSData();
 
-    /* Loads FITS image, scales it, and displays it in the GUI */
-    bool loadFITS(QIODevice &buffer);
+    /* Loads FITS image, scales it, and displays it in the GUI. If scaledSize is valid, the image is
+       subsampled while being read, so that it is not much bigger than scaledSize */
+    bool loadFITS(QIODevice &buffer, const QSize &scaledSize = QSize());
+    /* Only loads the FITS header: size, data type and records, but no pixels */
+    bool loadFITSHeader(QIODevice &buffer);
     /* Calculate stats */
     void calculateStats(bool refresh = false);
 
@@ -78,18 +82,25 @@ class FITSData
     // FITS Record
     int getFITSRecord(QString &recordList, int &nkeys);
 
-    // Create autostretch image from FITS File
-    static QImage FITSToImage(QIODevice &buffer);
+    // Create autostretch image from FITS File, of size scaledSize if it is valid
+    static QImage FITSToImage(QIODevice &buffer, const QSize &scaledSize = QSize());
 
     QString getLastError() const;
 
   private:
+    bool openFITS(QIODevice &buffer);
     int calculateMinMax(bool refresh = false);
     bool checkDebayer();
 
     // Templated functions
     template <typename T>
     bool debayer();
+    /* Demosaics horizontal tiles on several threads, writing to the 3 layers directly */
+    template <typename T>
+    bool debayerTiled(const T *source, int width, int height);
+    /* Turns each 2x2 cell in one pixel, producing an image of half the size */
+    template <typename T>
+    bool debayerSuperPixel(const T *source, int width, int height);
 
     template <typename T>
     void calculateMinMax();
@@ -102,6 +113,11 @@ class FITSData
 
     /// Pointer to CFITSIO FITS file struct
     fitsfile *fptr { nullptr };
+    /// Content of the file, when it cannot be read in place
+    QByteArray fileData;
+    /// Memory read by CFITSIO, when not reading from a file
+    void *fileAddress { nullptr };
+    size_t fileSize { 0 };
 
     /// FITS image data type (TBYTE, TUSHORT, TINT, TFLOAT, TLONG, TDOUBLE)
     int data_type { 0 };
@@ -118,6 +134,8 @@ class FITSData
     uint8_t *bayerBuffer { nullptr };
     /// Bayer parameters
     BayerParams debayerParams;
+    /// Whether debayer() produces an image of half the size, for previews
+    bool debayerHalfSize { false };
 
     /// Stats struct to hold statisical data about the FITS data
     struct
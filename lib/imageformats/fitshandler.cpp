@@ -44,7 +44,7 @@ bool FitsHandler::canRead() const
 
     FITSData fitsLoader;
 
-    if (fitsLoader.loadFITS(*device())) {
+    if (fitsLoader.loadFITSHeader(*device())) {
         setFormat("fits");
         return true;
     }
@@ -57,13 +57,13 @@ bool FitsHandler::read(QImage *image)
           return false;
     }
 
-    *image = FITSData::FITSToImage(*device());
+    *image = FITSData::FITSToImage(*device(), mScaledSize);
     return true;
 }
 
 bool FitsHandler::supportsOption(ImageOption option) const
 {
-    return option == Size;
+    return option == Size || option == ScaledSize;
 }
 
 QVariant FitsHandler::option(ImageOption option) const
@@ -71,12 +71,21 @@ QVariant FitsHandler::option(ImageOption option) const
     if (option == Size && device()) {
         FITSData fitsLoader;
 
-        if (fitsLoader.loadFITS(*device())) {
+        if (fitsLoader.loadFITSHeader(*device())) {
             return QSize((int)fitsLoader.getWidth(), (int)fitsLoader.getHeight());
         }
+    } else if (option == ScaledSize) {
+        return mScaledSize;
     }
     return QVariant();
 }
 
+void FitsHandler::setOption(ImageOption option, const QVariant &value)
+{
+    if (option == ScaledSize) {
+        mScaledSize = value.toSize();
+    }
+}
+
 } // namespace
 
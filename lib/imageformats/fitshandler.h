@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #pragma once
 
 #include <QImageIOHandler>
+#include <QSize>
 
 namespace Gwenview
 {
@@ -36,6 +37,10 @@ public:
 
     bool supportsOption(ImageOption option) const Q_DECL_OVERRIDE;
     QVariant option(ImageOption option) const Q_DECL_OVERRIDE;
+    void setOption(ImageOption option, const QVariant &value) Q_DECL_OVERRIDE;
+
+private:
+    QSize mScaledSize;
 };
 
 } // namespace
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Qt
 #include <QImage>
+#include <QMatrix>
 #include <QRegion>
 #include <QDebug>
 
@@ -28,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include <lib/document/document.h>
+#include <lib/imageutils.h>
 #include <lib/paintutils.h>
 
 #undef ENABLE_LOG
@@ -47,18 +49,58 @@ static const int SMOOTH_MARGIN = 3;
 
 struct ImageScalerPrivate
 {
+    ImageScaler* q;
     Qt::TransformationMode mTransformationMode;
     Document::Ptr mDocument;
     qreal mZoom;
     QRegion mRegion;
+
+    // The orientation of the document is not applied to its pixels: rects
+    // are scaled from the unoriented image, then transformed
+    Orientation mOrientation;
+    QSize mUnorientedSize;
+    // Maps the zoomed unoriented image to the zoomed displayed image
+    QMatrix mOrientationMatrix;
+
+    void updateOrientation()
+    {
+        mOrientation = mDocument->imageOrientation();
+        if (mOrientation == NOT_AVAILABLE) {
+            mOrientation = NORMAL;
+        }
+        mUnorientedSize = ImageUtils::transformedSize(mDocument->size(), mOrientation);
+        const QMatrix matrix = ImageUtils::transformMatrix(mOrientation);
+        const QRectF rect = matrix.mapRect(QRectF(QPointF(0, 0), QSizeF(mUnorientedSize) * mZoom));
+        mOrientationMatrix = matrix * QMatrix(1, 0, 0, 1, -rect.left(), -rect.top());
+    }
+
+    QRect unorientedRect(const QRect& rect) const
+    {
+        if (mOrientation == NORMAL) {
+            return rect;
+        }
+        return mOrientationMatrix.inverted().mapRect(QRectF(rect)).toAlignedRect();
+    }
+
+    void emitScaledRect(int left, int top, const QImage& image)
+    {
+        if (mOrientation == NORMAL) {
+            emit q->scaledRect(left, top, image);
+            return;
+        }
+        const QRectF rect = mOrientationMatrix.mapRect(QRectF(left, top, image.width(), image.height()));
+        emit q->scaledRect(qRound(rect.left()), qRound(rect.top()), ImageUtils::transformed(image, mOrientation));
+    }
 };
 
 ImageScaler::ImageScaler(QObject* parent)
 : QObject(parent)
 , d(new ImageScalerPrivate)
 {
+    d->q = this;
     d->mTransformationMode = Qt::FastTransformation;
     d->mZoom = 0;
+    d->mOrientation = NORMAL;
 }
 
 ImageScaler::~ImageScaler()
@@ -110,13 +152,14 @@ void ImageScaler::doScale()
             LOG("Asked for a down sampled image");
             return;
         }
-    } else if (d->mDocument->image().isNull()) {
+    } else if (d->mDocument->unorientedImage().isNull()) {
         LOG("Asked for the full image");
         d->mDocument->startLoadingFullImage();
         return;
     }
 
     LOG("Starting");
+    d->updateOrientation();
     Q_FOREACH(const QRect & rect, d->mRegion.rects()) {
         LOG(rect);
         scaleRect(rect);
@@ -124,12 +167,13 @@ void ImageScaler::doScale()
     LOG("Done");
 }
 
-void ImageScaler::scaleRect(const QRect& rect)
+void ImageScaler::scaleRect(const QRect& viewRect)
 {
+    const QRect rect = d->unorientedRect(viewRect);
     const qreal REAL_DELTA = 0.001;
     if (qAbs(d->mZoom - 1.0) < REAL_DELTA) {
-        QImage tmp = d->mDocument->image().copy(rect);
-        scaledRect(rect.left(), rect.top(), tmp);
+        QImage tmp = d->mDocument->unorientedImage().copy(rect);
+        d->emitScaledRect(rect.left(), rect.top(), tmp);
         return;
     }
 
@@ -138,10 +182,10 @@ void ImageScaler::scaleRect(const QRect& rect)
     if (d->mZoom < Document::maxDownSampledZoom()) {
         image = d->mDocument->downSampledImageForZoom(d->mZoom);
         Q_ASSERT(!image.isNull());
-        qreal zoom1 = qreal(image.width()) / d->mDocument->width();
+        qreal zoom1 = qreal(image.width()) / d->mUnorientedSize.width();
         zoom = d->mZoom / zoom1;
     } else {
-        image = d->mDocument->image();
+        image = d->mDocument->unorientedImage();
         zoom = d->mZoom;
     }
     // If rect contains "half" pixels, make sure sourceRect includes them
@@ -206,7 +250,7 @@ void ImageScaler::scaleRect(const QRect& rect)
               );
     }
 
-    emit scaledRect(destRect.left() + destLeftMargin, destRect.top() + destTopMargin, tmp);
+    d->emitScaledRect(destRect.left() + destLeftMargin, destRect.top() + destTopMargin, tmp);
 }
 
 } // namespace
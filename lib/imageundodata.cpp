@@ -0,0 +1,461 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "imageundodata.h"
+
+// Local
+#include <lib/gvdebug.h>
+#include <lib/parallelutils.h>
+
+// Qt
+#include <QDebug>
+#include <QMutex>
+#include <QQueue>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+#include <QVector>
+
+// STL
+#include <algorithm>
+#include <string.h>
+
+namespace Gwenview
+{
+
+static const int TILE_SIZE = 128;
+
+/**
+ * Default amount of memory, in bytes, past which the oldest undo data is
+ * moved to a temporary file
+ */
+static const qint64 DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+struct UndoTile
+{
+    QRect rect;
+    /** Empty if the tile can be found in the modified image */
+    QByteArray data;
+    bool stored;
+    bool compressed;
+    qint64 fileOffset;
+    int fileLength;
+};
+
+/**
+ * A range of the temporary file
+ */
+struct FileRange
+{
+    qint64 offset;
+    qint64 length;
+};
+
+struct ImageUndoDataPrivate
+{
+    QSize mSize;
+    QImage::Format mFormat;
+    int mDepth;
+    QVector<QRgb> mColorTable;
+    QPoint mOffset;
+    int mColumns;
+    QVector<UndoTile> mTiles;
+    int mMemoryUsage;
+    bool mRegistered;
+    bool mSpilled;
+    // Where the tiles have been written when mSpilled is true
+    FileRange mFileRange;
+
+    int lineBytes(int width) const
+    {
+        return (width * mDepth + 7) / 8;
+    }
+
+    int xBytes(int x) const
+    {
+        return x * mDepth / 8;
+    }
+};
+
+/**
+ * Keeps track of the memory used by all ImageUndoData instances and moves
+ * the oldest ones to a temporary file when needed. Tile data of all
+ * instances is only accessed with mMutex locked.
+ */
+struct ImageUndoStorage
+{
+    QMutex mMutex;
+    QQueue<ImageUndoDataPrivate*> mInMemory;
+    qint64 mMemoryUsage;
+    qint64 mMemoryBudget;
+    // A temporary file, unless mFilePath is set
+    QScopedPointer<QFile> mFile;
+    QString mFilePath;
+    int mSpilledCount;
+    // Ranges of mFile which are not used anymore, sorted by offset. They are
+    // reused by spill(), so that the file does not grow forever.
+    QVector<FileRange> mFreeRanges;
+
+    ImageUndoStorage()
+    : mMemoryUsage(0)
+    , mMemoryBudget(DEFAULT_MEMORY_BUDGET)
+    , mSpilledCount(0)
+    {}
+
+    void add(ImageUndoDataPrivate* data)
+    {
+        QMutexLocker locker(&mMutex);
+        mInMemory.enqueue(data);
+        mMemoryUsage += data->mMemoryUsage;
+        while (mMemoryUsage > mMemoryBudget && mInMemory.count() > 1) {
+            if (!spill(mInMemory.head())) {
+                break;
+            }
+        }
+    }
+
+    void remove(ImageUndoDataPrivate* data)
+    {
+        QMutexLocker locker(&mMutex);
+        if (data->mSpilled) {
+            releaseRange(data->mFileRange);
+            --mSpilledCount;
+        } else if (mInMemory.removeOne(data)) {
+            mMemoryUsage -= data->mMemoryUsage;
+        }
+    }
+
+    void setFilePath(const QString& path)
+    {
+        QMutexLocker locker(&mMutex);
+        GV_RETURN_IF_FAIL(mSpilledCount == 0);
+        mFile.reset();
+        mFreeRanges.clear();
+        mFilePath = path;
+    }
+
+    // Must be called with mMutex locked
+    bool openFile()
+    {
+        if (mFile && mFile->isOpen()) {
+            return true;
+        }
+        if (mFilePath.isEmpty()) {
+            QTemporaryFile* file = new QTemporaryFile;
+            mFile.reset(file);
+            return file->open();
+        }
+        mFile.reset(new QFile(mFilePath));
+        return mFile->open(QIODevice::ReadWrite | QIODevice::Truncate);
+    }
+
+    // Must be called with mMutex locked
+    void releaseRange(const FileRange& range)
+    {
+        if (range.length == 0) {
+            return;
+        }
+        auto it = std::lower_bound(mFreeRanges.begin(), mFreeRanges.end(), range.offset,
+            [](const FileRange& freeRange, qint64 offset) {
+                return freeRange.offset < offset;
+            });
+        it = mFreeRanges.insert(it, range);
+        // Merge with the next and previous ranges
+        if (it + 1 != mFreeRanges.end() && it->offset + it->length == (it + 1)->offset) {
+            it->length += (it + 1)->length;
+            mFreeRanges.erase(it + 1);
+        }
+        if (it != mFreeRanges.begin() && (it - 1)->offset + (it - 1)->length == it->offset) {
+            (it - 1)->length += it->length;
+            it = mFreeRanges.erase(it) - 1;
+        }
+        // Give back space at the end of the file
+        if (it->offset + it->length == mFile->size()) {
+            mFile->resize(it->offset);
+            mFreeRanges.erase(it);
+        }
+    }
+
+    // Must be called with mMutex locked. Returns the offset of a free range
+    // of length bytes, taken from the free ranges or from the end of the
+    // file.
+    qint64 allocateRange(qint64 length)
+    {
+        for (auto it = mFreeRanges.begin(); it != mFreeRanges.end(); ++it) {
+            if (it->length >= length) {
+                const qint64 offset = it->offset;
+                it->offset += length;
+                it->length -= length;
+                if (it->length == 0) {
+                    mFreeRanges.erase(it);
+                }
+                return offset;
+            }
+        }
+        return mFile->size();
+    }
+
+    // Must be called with mMutex locked
+    bool spill(ImageUndoDataPrivate* data)
+    {
+        if (!openFile()) {
+            qWarning() << "Could not create temporary file for undo data";
+            return false;
+        }
+        qint64 length = 0;
+        for (const UndoTile& tile : data->mTiles) {
+            length += tile.data.size();
+        }
+        const qint64 fileSize = mFile->size();
+        const FileRange range = { allocateRange(length), length };
+        bool ok = mFile->seek(range.offset);
+        for (int i = 0; ok && i < data->mTiles.count(); ++i) {
+            const UndoTile& tile = data->mTiles.at(i);
+            ok = !tile.stored || mFile->write(tile.data) == tile.data.size();
+        }
+        if (ok) {
+            ok = mFile->flush();
+        }
+        if (!ok) {
+            qWarning() << "Could not write undo data to" << mFile->fileName();
+            if (range.offset < fileSize) {
+                // Taken from the free ranges, inside the file
+                releaseRange(range);
+            } else {
+                // Taken from the end of the file, drop what has been written
+                mFile->resize(fileSize);
+            }
+            return false;
+        }
+
+        qint64 offset = range.offset;
+        for (UndoTile& tile : data->mTiles) {
+            if (tile.stored) {
+                tile.fileOffset = offset;
+                tile.fileLength = tile.data.size();
+                offset += tile.fileLength;
+            }
+            tile.data = QByteArray();
+        }
+        mInMemory.removeOne(data);
+        mMemoryUsage -= data->mMemoryUsage;
+        data->mMemoryUsage = 0;
+        data->mSpilled = true;
+        data->mFileRange = range;
+        ++mSpilledCount;
+        return true;
+    }
+
+    // Must be called with mMutex locked
+    QByteArray tileData(const UndoTile& tile)
+    {
+        if (!tile.data.isEmpty() || tile.fileLength == 0) {
+            return tile.data;
+        }
+        mFile->seek(tile.fileOffset);
+        return mFile->read(tile.fileLength);
+    }
+};
+
+Q_GLOBAL_STATIC(ImageUndoStorage, undoStorage)
+
+ImageUndoData::ImageUndoData()
+: d(new ImageUndoDataPrivate)
+{
+    d->mFormat = QImage::Format_Invalid;
+    d->mDepth = 0;
+    d->mColumns = 0;
+    d->mMemoryUsage = 0;
+    d->mRegistered = false;
+    d->mSpilled = false;
+    d->mFileRange = { 0, 0 };
+}
+
+ImageUndoData::~ImageUndoData()
+{
+    if (d->mRegistered) {
+        undoStorage->remove(d);
+    }
+    delete d;
+}
+
+void ImageUndoData::store(const QImage& before, const QImage& after, const QPoint& offset)
+{
+    // Operations store their undo data again each time they are redone:
+    // forget about the previous data
+    if (d->mRegistered) {
+        undoStorage->remove(d);
+        d->mRegistered = false;
+    }
+    d->mTiles.clear();
+    d->mMemoryUsage = 0;
+    d->mSpilled = false;
+    d->mFileRange = { 0, 0 };
+
+    d->mSize = before.size();
+    d->mFormat = before.format();
+    d->mDepth = before.depth();
+    d->mColorTable = before.colorTable();
+    d->mOffset = offset;
+
+    // Tiles span the whole width for formats with less than 8 bits per
+    // pixel, to avoid dealing with bits
+    const int depth = d->mDepth;
+    const int tileWidth = depth < 8 ? before.width() : TILE_SIZE;
+    const int columns = (before.width() + tileWidth - 1) / tileWidth;
+    const int rows = (before.height() + TILE_SIZE - 1) / TILE_SIZE;
+    d->mColumns = columns;
+    d->mTiles.resize(columns * rows);
+    const bool canCompare = !after.isNull() && after.format() == before.format();
+    const QRect afterRect = after.rect();
+
+    ParallelUtils::forEachRowStripe(rows, 1, [&](int beginRow, int endRow) {
+        for (int row = beginRow; row < endRow; ++row) {
+            for (int col = 0; col < columns; ++col) {
+                UndoTile& tile = d->mTiles[row * columns + col];
+                tile.rect = QRect(col * tileWidth, row * TILE_SIZE, tileWidth, TILE_SIZE) & before.rect();
+                tile.compressed = false;
+                tile.fileOffset = 0;
+                tile.fileLength = 0;
+
+                const int x = d->xBytes(tile.rect.x());
+                const int length = d->lineBytes(tile.rect.width());
+                const QRect rectInAfter = tile.rect.translated(-offset);
+                bool unchanged = canCompare && afterRect.contains(rectInAfter)
+                    && (depth >= 8 || rectInAfter.x() == 0);
+                if (unchanged) {
+                    const int afterX = d->xBytes(rectInAfter.x());
+                    for (int y = 0; y < tile.rect.height(); ++y) {
+                        const uchar* beforeLine = before.constScanLine(tile.rect.y() + y) + x;
+                        const uchar* afterLine = after.constScanLine(rectInAfter.y() + y) + afterX;
+                        if (memcmp(beforeLine, afterLine, length) != 0) {
+                            unchanged = false;
+                            break;
+                        }
+                    }
+                }
+                tile.stored = !unchanged;
+                if (unchanged) {
+                    continue;
+                }
+
+                QByteArray raw(length * tile.rect.height(), Qt::Uninitialized);
+                for (int y = 0; y < tile.rect.height(); ++y) {
+                    memcpy(raw.data() + y * length, before.constScanLine(tile.rect.y() + y) + x, length);
+                }
+                // Keep the raw data if it does not compress well (photos
+                // with a lot of noise)
+                const QByteArray compressed = qCompress(raw, 1);
+                if (compressed.size() < raw.size() * 9 / 10) {
+                    tile.data = compressed;
+                    tile.compressed = true;
+                } else {
+                    tile.data = raw;
+                }
+            }
+        }
+    });
+
+    for (const UndoTile& tile : d->mTiles) {
+        d->mMemoryUsage += tile.data.size();
+    }
+    d->mRegistered = true;
+    undoStorage->add(d);
+}
+
+QImage ImageUndoData::restore(const QImage& after) const
+{
+    if (d->mTiles.isEmpty()) {
+        return QImage();
+    }
+    QVector<QByteArray> tileData(d->mTiles.count());
+    {
+        QMutexLocker locker(&undoStorage->mMutex);
+        for (int i = 0; i < d->mTiles.count(); ++i) {
+            if (d->mTiles[i].stored) {
+                tileData[i] = undoStorage->tileData(d->mTiles[i]);
+            }
+        }
+    }
+
+    QImage image(d->mSize, d->mFormat);
+    image.setColorTable(d->mColorTable);
+    // Get the pointer once: scanLine() may detach the image, which is not
+    // safe from several threads
+    uchar* bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    const int columns = d->mColumns;
+    const int rows = d->mTiles.count() / columns;
+    ParallelUtils::forEachRowStripe(rows, 1, [&](int beginRow, int endRow) {
+        for (int i = beginRow * columns; i < endRow * columns; ++i) {
+            const UndoTile& tile = d->mTiles[i];
+            const int x = d->xBytes(tile.rect.x());
+            const int length = d->lineBytes(tile.rect.width());
+            if (tile.stored) {
+                const QByteArray raw = tile.compressed ? qUncompress(tileData[i]) : tileData[i];
+                if (raw.size() != length * tile.rect.height()) {
+                    qWarning() << "Invalid undo data for tile" << tile.rect;
+                    continue;
+                }
+                for (int y = 0; y < tile.rect.height(); ++y) {
+                    memcpy(bits + (tile.rect.y() + y) * bytesPerLine + x, raw.constData() + y * length, length);
+                }
+            } else {
+                const QRect rectInAfter = tile.rect.translated(-d->mOffset);
+                const int afterX = d->xBytes(rectInAfter.x());
+                for (int y = 0; y < tile.rect.height(); ++y) {
+                    memcpy(bits + (tile.rect.y() + y) * bytesPerLine + x, after.constScanLine(rectInAfter.y() + y) + afterX, length);
+                }
+            }
+        }
+    });
+    return image;
+}
+
+int ImageUndoData::memoryUsage() const
+{
+    QMutexLocker locker(&undoStorage->mMutex);
+    return d->mMemoryUsage;
+}
+
+bool ImageUndoData::isSpilled() const
+{
+    QMutexLocker locker(&undoStorage->mMutex);
+    return d->mSpilled;
+}
+
+void ImageUndoData::setMemoryBudget(qint64 budget)
+{
+    QMutexLocker locker(&undoStorage->mMutex);
+    undoStorage->mMemoryBudget = budget;
+}
+
+qint64 ImageUndoData::memoryBudget()
+{
+    QMutexLocker locker(&undoStorage->mMutex);
+    return undoStorage->mMemoryBudget;
+}
+
+void ImageUndoData::setSpillFilePath(const QString& path)
+{
+    undoStorage->setFilePath(path);
+}
+
+} // namespace
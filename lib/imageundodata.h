@@ -0,0 +1,97 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IMAGEUNDODATA_H
+#define IMAGEUNDODATA_H
+
+// Local
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QImage>
+#include <QPoint>
+#include <QString>
+
+namespace Gwenview
+{
+
+struct ImageUndoDataPrivate;
+/**
+ * Holds what is needed to get back an image after it has been modified,
+ * using less memory than a copy of the image.
+ *
+ * The image is split in tiles. Tiles which can be found unchanged in the
+ * modified image are not stored, the others are compressed. When the data
+ * of all ImageUndoData instances goes over a memory budget, the oldest ones
+ * are moved to a temporary file.
+ *
+ * store() and restore() can be called from any thread.
+ */
+class GWENVIEWLIB_EXPORT ImageUndoData
+{
+public:
+    ImageUndoData();
+    ~ImageUndoData();
+
+    /**
+     * Stores the content of before. after is the modified image, it may be
+     * null. offset is the position of after inside before, for example the
+     * top-left corner of the crop rectangle.
+     */
+    void store(const QImage& before, const QImage& after, const QPoint& offset = QPoint());
+
+    /**
+     * Returns the image passed as before to store(). after must be the image
+     * passed as after to store().
+     */
+    QImage restore(const QImage& after) const;
+
+    /**
+     * Returns the number of bytes held in memory
+     */
+    int memoryUsage() const;
+
+    /**
+     * Returns true if the data has been moved to the temporary file
+     */
+    bool isSpilled() const;
+
+    /**
+     * Amount of memory, in bytes, the data of all instances can use before
+     * the oldest data is moved to the temporary file. Defaults to 256 MB.
+     */
+    static void setMemoryBudget(qint64 budget);
+    static qint64 memoryBudget();
+
+    /**
+     * Moves data out of memory to path instead of a temporary file, an empty
+     * path restores the default. Meant for tests, must not be called while
+     * some data is out of memory.
+     */
+    static void setSpillFilePath(const QString& path);
+
+private:
+    Q_DISABLE_COPY(ImageUndoData)
+    ImageUndoDataPrivate* const d;
+};
+
+} // namespace
+
+#endif /* IMAGEUNDODATA_H */
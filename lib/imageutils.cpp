@@ -20,9 +20,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 */
 #include "imageutils.h"
 
+// Local
+#include <lib/parallelutils.h>
+
 // Qt
+#include <QImage>
 #include <QMatrix>
 
+// STL
+#include <algorithm>
+#include <utility>
+
 namespace Gwenview
 {
 namespace ImageUtils
@@ -70,5 +78,185 @@ QMatrix transformMatrix(Orientation orientation)
     return matrix;
 }
 
+/**
+ * Rotations are done in square blocks of BLOCK_SIZE x BLOCK_SIZE pixels, so
+ * that the source rows read for a block stay in the cache
+ */
+static const int BLOCK_SIZE = 64;
+
+/**
+ * Minimum number of pixels per stripe when flipping
+ */
+static const int MIN_PIXELS_PER_STRIPE = 64 * 1024;
+
+template <int N>
+struct Pixel
+{
+    uchar bytes[N];
+};
+
+static inline bool swapsAxes(Orientation orientation)
+{
+    return orientation == TRANSPOSE || orientation == ROT_90
+        || orientation == TRANSVERSE || orientation == ROT_270;
+}
+
+template <class P>
+static void flipInPlace(QImage* image, bool flipX, bool flipY)
+{
+    const int width = image->width();
+    const int height = image->height();
+    // Get the pointer once, scanLine() could detach from several threads
+    uchar* bits = image->bits();
+    const int bytesPerLine = image->bytesPerLine();
+    const int rowCount = flipY ? (height + 1) / 2 : height;
+    const int minRows = qMax(1, MIN_PIXELS_PER_STRIPE / qMax(1, width));
+    ParallelUtils::forEachRowStripe(rowCount, minRows, [=](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            P* line = reinterpret_cast<P*>(bits + y * bytesPerLine);
+            if (!flipY) {
+                std::reverse(line, line + width);
+                continue;
+            }
+            P* opposite = reinterpret_cast<P*>(bits + (height - 1 - y) * bytesPerLine);
+            if (line == opposite) {
+                // Middle row of an image with an odd height
+                if (flipX) {
+                    std::reverse(line, line + width);
+                }
+            } else if (flipX) {
+                for (int x = 0; x < width; ++x) {
+                    std::swap(line[x], opposite[width - 1 - x]);
+                }
+            } else {
+                std::swap_ranges(line, line + width, opposite);
+            }
+        }
+    });
+}
+
+template <class P>
+static void flip(const QImage& src, QImage* dst, bool flipX, bool flipY)
+{
+    const int width = src.width();
+    const int height = src.height();
+    const uchar* srcBits = src.constBits();
+    const int srcBytesPerLine = src.bytesPerLine();
+    uchar* dstBits = dst->bits();
+    const int dstBytesPerLine = dst->bytesPerLine();
+    const int minRows = qMax(1, MIN_PIXELS_PER_STRIPE / qMax(1, width));
+    ParallelUtils::forEachRowStripe(height, minRows, [=](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int srcY = flipY ? height - 1 - y : y;
+            const P* srcLine = reinterpret_cast<const P*>(srcBits + srcY * srcBytesPerLine);
+            P* dstLine = reinterpret_cast<P*>(dstBits + y * dstBytesPerLine);
+            if (flipX) {
+                std::reverse_copy(srcLine, srcLine + width, dstLine);
+            } else {
+                std::copy(srcLine, srcLine + width, dstLine);
+            }
+        }
+    });
+}
+
+/**
+ * Handles the orientations which swap axes. Destination pixel (x, y) comes
+ * from source pixel (y, x), with the source axes reversed according to
+ * reverseX and reverseY.
+ */
+template <class P>
+static void transpose(const QImage& src, QImage* dst, bool reverseX, bool reverseY)
+{
+    const int srcWidth = src.width();
+    const int srcHeight = src.height();
+    const uchar* srcBits = src.constBits();
+    const int srcBytesPerLine = src.bytesPerLine();
+    const int dstWidth = dst->width();
+    const int dstHeight = dst->height();
+    uchar* dstBits = dst->bits();
+    const int dstBytesPerLine = dst->bytesPerLine();
+
+    const int blockRows = (dstHeight + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    ParallelUtils::forEachRowStripe(blockRows, 1, [=](int begin, int end) {
+        for (int blockY = begin * BLOCK_SIZE; blockY < qMin(end * BLOCK_SIZE, dstHeight); blockY += BLOCK_SIZE) {
+            const int blockBottom = qMin(blockY + BLOCK_SIZE, dstHeight);
+            for (int blockX = 0; blockX < dstWidth; blockX += BLOCK_SIZE) {
+                const int blockRight = qMin(blockX + BLOCK_SIZE, dstWidth);
+                for (int y = blockY; y < blockBottom; ++y) {
+                    const int srcX = reverseX ? srcWidth - 1 - y : y;
+                    P* dstLine = reinterpret_cast<P*>(dstBits + y * dstBytesPerLine);
+                    for (int x = blockX; x < blockRight; ++x) {
+                        const int srcY = reverseY ? srcHeight - 1 - x : x;
+                        dstLine[x] = reinterpret_cast<const P*>(srcBits + srcY * srcBytesPerLine)[srcX];
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <class P>
+static QImage transformedInternal(QImage image, Orientation orientation)
+{
+    if (swapsAxes(orientation)) {
+        QImage result(image.height(), image.width(), image.format());
+        result.setColorTable(image.colorTable());
+        result.setDotsPerMeterX(image.dotsPerMeterY());
+        result.setDotsPerMeterY(image.dotsPerMeterX());
+        const bool reverseX = orientation == TRANSVERSE || orientation == ROT_270;
+        const bool reverseY = orientation == ROT_90 || orientation == TRANSVERSE;
+        transpose<P>(image, &result, reverseX, reverseY);
+        return result;
+    }
+
+    const bool flipX = orientation == HFLIP || orientation == ROT_180;
+    const bool flipY = orientation == VFLIP || orientation == ROT_180;
+    if (image.isDetached()) {
+        flipInPlace<P>(&image, flipX, flipY);
+        return image;
+    }
+    QImage result(image.size(), image.format());
+    result.setColorTable(image.colorTable());
+    result.setDotsPerMeterX(image.dotsPerMeterX());
+    result.setDotsPerMeterY(image.dotsPerMeterY());
+    flip<P>(image, &result, flipX, flipY);
+    return result;
+}
+
+QImage transformed(QImage image, Orientation orientation)
+{
+    if (orientation == NOT_AVAILABLE || orientation == NORMAL || image.isNull()) {
+        return image;
+    }
+    switch (image.depth()) {
+    case 8:
+        return transformedInternal<Pixel<1> >(std::move(image), orientation);
+    case 16:
+        return transformedInternal<Pixel<2> >(std::move(image), orientation);
+    case 24:
+        return transformedInternal<Pixel<3> >(std::move(image), orientation);
+    case 32:
+        return transformedInternal<Pixel<4> >(std::move(image), orientation);
+    case 64:
+        return transformedInternal<Pixel<8> >(std::move(image), orientation);
+    default:
+        // Less than 8 bits per pixel, not worth dedicated code
+        return image.transformed(transformMatrix(orientation));
+    }
+}
+
+QSize transformedSize(const QSize& size, Orientation orientation)
+{
+    switch (orientation) {
+    case TRANSPOSE:
+    case ROT_90:
+    case TRANSVERSE:
+    case ROT_270:
+        return size.transposed();
+    default:
+        return size;
+    }
+}
+
 } // namespace
 } // namespace
@@ -24,7 +24,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <lib/gwenviewlib_export.h>
 #include <lib/orientation.h>
 
+class QImage;
 class QMatrix;
+class QSize;
 
 namespace Gwenview
 {
@@ -33,6 +35,21 @@ namespace ImageUtils
 
 GWENVIEWLIB_EXPORT QMatrix transformMatrix(Orientation);
 
+/**
+ * Returns image transformed according to orientation. The result is the same
+ * as image.transformed(transformMatrix(orientation)), but the work is split
+ * between several threads, rotations go through the image in cache-sized
+ * blocks and flips are done in place if image is not shared.
+ */
+GWENVIEWLIB_EXPORT QImage transformed(QImage image, Orientation orientation);
+
+/**
+ * Returns the size of an image of size @a size once transformed according to
+ * orientation: width and height are swapped for orientations which rotate by
+ * 90 degrees.
+ */
+GWENVIEWLIB_EXPORT QSize transformedSize(const QSize& size, Orientation orientation);
+
 } // namespace
 } // namespace
 
@@ -36,7 +36,10 @@ extern "C" {
 #include <QImage>
 #include <QImageWriter>
 #include <QMatrix>
+#include <QRect>
 #include <QDebug>
+#include <QFuture>
+#include <QtConcurrentRun>
 
 // KDE
 #include <KLocalizedString>
@@ -116,10 +119,20 @@ struct JpegContent::Private
     QImage mImage;
     QByteArray mRawData;
     QSize mSize;
+    // Size of the JPEG data, mSize is transposed when the Exif orientation
+    // swaps the axes
+    QSize mRawSize;
+    // Size of a MCU, in pixels of the untransformed image
+    QSize mMcuSize;
     QString mComment;
     bool mPendingTransformation;
     QMatrix mTransformMatrix;
+    // Crop to apply after mTransformMatrix, null if none
+    QRect mPendingCrop;
     Exiv2::ExifData mExifData;
+    // Thumbnail set with setThumbnail(), encoded by save() while the main
+    // image is being encoded
+    QImage mPendingThumbnail;
     QString mErrorString;
 
     Private()
@@ -169,7 +182,9 @@ struct JpegContent::Private
             jpeg_destroy_decompress(&srcinfo);
             return false;
         }
-        mSize = QSize(srcinfo.image_width, srcinfo.image_height);
+        mRawSize = QSize(srcinfo.image_width, srcinfo.image_height);
+        mSize = mRawSize;
+        mMcuSize = QSize(srcinfo.max_h_samp_factor * DCTSIZE, srcinfo.max_v_samp_factor * DCTSIZE);
 
         jpeg_destroy_decompress(&srcinfo);
         return true;
@@ -230,8 +245,10 @@ bool JpegContent::loadFromData(const QByteArray& data, Exiv2::Image* exiv2Image)
 {
     d->mPendingTransformation = false;
     d->mTransformMatrix.reset();
+    d->mPendingCrop = QRect();
 
     d->mRawData = data;
+    d->mPendingThumbnail = QImage();
     if (d->mRawData.size() == 0) {
         qCritical() << "No data\n";
         return false;
@@ -400,20 +417,44 @@ static const OrientationInfoList& orientationInfoList()
     return list;
 }
 
+static QMatrix matrixForOrientation(Orientation orientation)
+{
+    OrientationInfoList::ConstIterator it(orientationInfoList().begin()), end(orientationInfoList().end());
+    for (; it != end; ++it) {
+        if ((*it).orientation == orientation) {
+            return (*it).matrix;
+        }
+    }
+    qWarning() << "Could not find matrix for orientation\n";
+    return QMatrix();
+}
+
+static bool matrixSwapsAxes(const QMatrix& matrix)
+{
+    return qAbs(matrix.m11()) < 0.5;
+}
+
+/**
+ * Returns crop, a rect inside an image of size size, once matrix has been
+ * applied to the image
+ */
+static QRect transformedRect(const QRect& crop, const QSize& size, const QMatrix& matrix)
+{
+    const QRectF full = matrix.mapRect(QRectF(QPointF(0, 0), QSizeF(size)));
+    const QRectF mapped = matrix.mapRect(QRectF(crop));
+    return mapped.translated(-full.topLeft()).toRect();
+}
+
 void JpegContent::transform(Orientation orientation)
 {
     if (orientation != NOT_AVAILABLE && orientation != NORMAL) {
         d->mPendingTransformation = true;
-        OrientationInfoList::ConstIterator it(orientationInfoList().begin()), end(orientationInfoList().end());
-        for (; it != end; ++it) {
-            if ((*it).orientation == orientation) {
-                d->mTransformMatrix = (*it).matrix * d->mTransformMatrix;
-                break;
-            }
-        }
-        if (it == end) {
-            qWarning() << "Could not find matrix for orientation\n";
+        const QMatrix matrix = matrixForOrientation(orientation);
+        if (!d->mPendingCrop.isNull()) {
+            const QSize size = matrixSwapsAxes(d->mTransformMatrix) ? d->mRawSize.transposed() : d->mRawSize;
+            d->mPendingCrop = transformedRect(d->mPendingCrop, size, matrix);
         }
+        d->mTransformMatrix = matrix * d->mTransformMatrix;
     }
 }
 
@@ -448,6 +489,75 @@ static JXFORM_CODE findJxform(const QMatrix& matrix)
     return JXFORM_NONE;
 }
 
+bool JpegContent::canTransformLosslessly(Orientation orientation) const
+{
+    if (d->mPendingCrop.isNull() || orientation == NOT_AVAILABLE || orientation == NORMAL) {
+        return true;
+    }
+#if JPEG_LIB_VERSION >= 80
+    const QMatrix matrix = matrixForOrientation(orientation);
+    const QMatrix newMatrix = matrix * d->mTransformMatrix;
+    if (!jtransform_perfect_transform(d->mRawSize.width(), d->mRawSize.height(),
+                                      d->mMcuSize.width(), d->mMcuSize.height(),
+                                      findJxform(newMatrix))) {
+        return false;
+    }
+    const QSize size = matrixSwapsAxes(d->mTransformMatrix) ? d->mRawSize.transposed() : d->mRawSize;
+    const QRect crop = transformedRect(d->mPendingCrop, size, matrix);
+    const QSize mcuSize = matrixSwapsAxes(newMatrix) ? d->mMcuSize.transposed() : d->mMcuSize;
+    return crop.x() % mcuSize.width() == 0 && crop.y() % mcuSize.height() == 0;
+#else
+    return false;
+#endif
+}
+
+bool JpegContent::canCropLosslessly(const QRect& rect) const
+{
+#if JPEG_LIB_VERSION >= 80
+    if (d->mRawData.isEmpty() || d->mMcuSize.isEmpty()) {
+        // Image has been modified with setImage()
+        return false;
+    }
+    const Orientation exifOrientation = orientation();
+    if (GwenviewConfig::applyExifOrientation() && exifOrientation != NOT_AVAILABLE && exifOrientation != NORMAL) {
+        // rect is expressed in the coordinates of the displayed image, not
+        // in those of the JPEG data. Saving resets the orientation, so the
+        // pixels have to be transformed anyway.
+        return false;
+    }
+    const bool swapsAxes = matrixSwapsAxes(d->mTransformMatrix);
+    const QRect current = d->mPendingCrop.isNull()
+        ? QRect(QPoint(0, 0), swapsAxes ? d->mRawSize.transposed() : d->mRawSize)
+        : d->mPendingCrop;
+    if (rect.isEmpty() || !QRect(QPoint(0, 0), current.size()).contains(rect)) {
+        return false;
+    }
+    if (d->mPendingTransformation
+        && !jtransform_perfect_transform(d->mRawSize.width(), d->mRawSize.height(),
+                                         d->mMcuSize.width(), d->mMcuSize.height(),
+                                         findJxform(d->mTransformMatrix))) {
+        // The edges of the image would not be transformed
+        return false;
+    }
+    const QRect crop = rect.translated(current.topLeft());
+    const QSize mcuSize = swapsAxes ? d->mMcuSize.transposed() : d->mMcuSize;
+    return crop.x() % mcuSize.width() == 0 && crop.y() % mcuSize.height() == 0;
+#else
+    Q_UNUSED(rect);
+    // transupp.h from libjpeg 6.2 cannot crop
+    return false;
+#endif
+}
+
+void JpegContent::crop(const QRect& rect)
+{
+    Q_ASSERT(canCropLosslessly(rect));
+    const QPoint offset = d->mPendingCrop.isNull() ? QPoint(0, 0) : d->mPendingCrop.topLeft();
+    d->mPendingCrop = rect.translated(offset);
+    d->mExifData["Exif.Photo.PixelXDimension"] = rect.width();
+    d->mExifData["Exif.Photo.PixelYDimension"] = rect.height();
+}
+
 void JpegContent::applyPendingTransformation()
 {
     if (d->mRawData.size() == 0) {
@@ -494,7 +604,21 @@ void JpegContent::applyPendingTransformation()
     // Init transformation
     jpeg_transform_info transformoption;
     memset(&transformoption, 0, sizeof(jpeg_transform_info));
-    transformoption.transform = findJxform(d->mTransformMatrix);
+    transformoption.transform = d->mPendingTransformation ? findJxform(d->mTransformMatrix) : JXFORM_NONE;
+#if JPEG_LIB_VERSION >= 80
+    if (!d->mPendingCrop.isNull()) {
+        // Cropping is done after the transformation, in the same pass
+        transformoption.crop = true;
+        transformoption.crop_xoffset = d->mPendingCrop.x();
+        transformoption.crop_xoffset_set = JCROP_POS;
+        transformoption.crop_yoffset = d->mPendingCrop.y();
+        transformoption.crop_yoffset_set = JCROP_POS;
+        transformoption.crop_width = d->mPendingCrop.width();
+        transformoption.crop_width_set = JCROP_POS;
+        transformoption.crop_height = d->mPendingCrop.height();
+        transformoption.crop_height_set = JCROP_POS;
+    }
+#endif
     jtransform_request_workspace(&srcinfo, &transformoption);
 
     /* Read source file as DCT coefficients */
@@ -538,6 +662,9 @@ void JpegContent::applyPendingTransformation()
 
 QImage JpegContent::thumbnail() const
 {
+    if (!d->mPendingThumbnail.isNull()) {
+        return d->mPendingThumbnail;
+    }
     QImage image;
     if (!d->mExifData.empty()) {
 #if(EXIV2_TEST_VERSION(0,17,91))
@@ -551,27 +678,25 @@ QImage JpegContent::thumbnail() const
     return image;
 }
 
-void JpegContent::setThumbnail(const QImage& thumbnail)
+static QByteArray encodeThumbnail(const QImage& thumbnail)
 {
-    if (d->mExifData.empty()) {
-        return;
-    }
-
     QByteArray array;
     QBuffer buffer(&array);
     buffer.open(QIODevice::WriteOnly);
     QImageWriter writer(&buffer, "JPEG");
     if (!writer.write(thumbnail)) {
         qCritical() << "Could not write thumbnail\n";
-        return;
+        return QByteArray();
     }
+    return array;
+}
 
-#if (EXIV2_TEST_VERSION(0,17,91))
-    Exiv2::ExifThumb thumb(d->mExifData);
-    thumb.setJpegThumbnail((unsigned char*)array.data(), array.size());
-#else
-    d->mExifData.setJpegThumbnail((unsigned char*)array.data(), array.size());
-#endif
+void JpegContent::setThumbnail(const QImage& thumbnail)
+{
+    if (d->mExifData.empty()) {
+        return;
+    }
+    d->mPendingThumbnail = thumbnail;
 }
 
 bool JpegContent::save(const QString& path)
@@ -587,8 +712,17 @@ bool JpegContent::save(const QString& path)
 
 bool JpegContent::save(QIODevice* device)
 {
+    // The thumbnail is independent from the main image: encode both at the
+    // same time
+    QFuture<QByteArray> thumbnailFuture;
+    const bool hasPendingThumbnail = !d->mPendingThumbnail.isNull();
+    if (hasPendingThumbnail) {
+        thumbnailFuture = QtConcurrent::run(encodeThumbnail, d->mPendingThumbnail);
+    }
+
     if (!d->mImage.isNull()) {
         if (!d->updateRawDataFromImage()) {
+            thumbnailFuture.waitForFinished();
             return false;
         }
     }
@@ -598,9 +732,23 @@ bool JpegContent::save(QIODevice* device)
         return false;
     }
 
-    if (d->mPendingTransformation) {
+    if (d->mPendingTransformation || !d->mPendingCrop.isNull()) {
         applyPendingTransformation();
         d->mPendingTransformation = false;
+        d->mPendingCrop = QRect();
+    }
+
+    if (hasPendingThumbnail) {
+        const QByteArray array = thumbnailFuture.result();
+        if (!array.isEmpty()) {
+#if (EXIV2_TEST_VERSION(0,17,91))
+            Exiv2::ExifThumb thumb(d->mExifData);
+            thumb.setJpegThumbnail((unsigned char*)array.data(), array.size());
+#else
+            d->mExifData.setJpegThumbnail((unsigned char*)array.data(), array.size());
+#endif
+        }
+        d->mPendingThumbnail = QImage();
     }
 
     Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open((unsigned char*)d->mRawData.data(), d->mRawData.size());
@@ -633,12 +781,14 @@ void JpegContent::setImage(const QImage& image)
     d->mRawData.clear();
     d->mImage = image;
     d->mSize = image.size();
+    d->mRawSize = image.size();
     d->mExifData["Exif.Photo.PixelXDimension"] = image.width();
     d->mExifData["Exif.Photo.PixelYDimension"] = image.height();
     resetOrientation();
 
     d->mPendingTransformation = false;
     d->mTransformMatrix = QMatrix();
+    d->mPendingCrop = QRect();
 }
 
 } // namespace
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <lib/gwenviewlib_export.h>
 #include <QByteArray>
 class QImage;
+class QRect;
 class QSize;
 class QString;
 class QIODevice;
@@ -57,6 +58,27 @@ public:
 
     void transform(Orientation);
 
+    /**
+     * Returns true if applying orientation with transform() keeps a pending
+     * crop lossless
+     */
+    bool canTransformLosslessly(Orientation) const;
+
+    /**
+     * Returns true if rect, expressed in the coordinates of the image with
+     * pending transformations and crop applied, can be cropped without
+     * decoding the image. This is the case if its top-left corner falls on
+     * a MCU boundary and the image has no Exif orientation to apply.
+     */
+    bool canCropLosslessly(const QRect& rect) const;
+
+    /**
+     * Crops the image to rect, which must pass canCropLosslessly(). Like
+     * transform(), the crop is only applied to the JPEG data on save, in the
+     * same pass as the pending transformation.
+     */
+    void crop(const QRect& rect);
+
     QImage thumbnail() const;
     void setThumbnail(const QImage&);
 
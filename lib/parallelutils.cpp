@@ -0,0 +1,71 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "parallelutils.h"
+
+// Qt
+#include <QFuture>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentRun>
+
+namespace Gwenview
+{
+
+namespace ParallelUtils
+{
+
+void forEachRowStripe(int rowCount, int minRowsPerStripe, const std::function<void(int begin, int end)>& function)
+{
+    if (rowCount <= 0) {
+        return;
+    }
+    // Use a few more stripes than cores, so that a core which is busy with
+    // something else does not delay the whole operation too much
+    const int maxStripeCount = qMax(1, QThread::idealThreadCount() * 2);
+    const int stripeCount = qBound(1, rowCount / qMax(1, minRowsPerStripe), maxStripeCount);
+    if (stripeCount == 1) {
+        function(0, rowCount);
+        return;
+    }
+
+    QVector<QFuture<void>> futures;
+    futures.reserve(stripeCount - 1);
+    // Stripe 0 is processed in the calling thread, once the others have
+    // been queued
+    for (int stripe = 1; stripe < stripeCount; ++stripe) {
+        const int begin = rowCount * stripe / stripeCount;
+        const int end = rowCount * (stripe + 1) / stripeCount;
+        futures << QtConcurrent::run([&function, begin, end]() {
+            function(begin, end);
+        });
+    }
+    function(0, rowCount / stripeCount);
+    // waitForFinished() runs tasks which have not been started yet in the
+    // calling thread, so this cannot dead lock if the pool is full
+    for (QFuture<void>& future : futures) {
+        future.waitForFinished();
+    }
+}
+
+} // namespace
+
+} // namespace
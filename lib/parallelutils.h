@@ -0,0 +1,49 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef PARALLELUTILS_H
+#define PARALLELUTILS_H
+
+#include <lib/gwenviewlib_export.h>
+
+// STL
+#include <functional>
+
+namespace Gwenview
+{
+
+namespace ParallelUtils
+{
+
+/**
+ * Splits the [0, rowCount) range in stripes of at least minRowsPerStripe
+ * rows and calls function(begin, end) for each stripe, using the global
+ * thread pool. The calling thread processes a stripe too. Returns when all
+ * stripes have been processed.
+ *
+ * function must not touch rows outside of [begin, end).
+ */
+GWENVIEWLIB_EXPORT void forEachRowStripe(int rowCount, int minRowsPerStripe, const std::function<void(int begin, int end)>& function);
+
+} // namespace
+
+} // namespace
+
+#endif /* PARALLELUTILS_H */
@@ -26,19 +26,29 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Qt
 #include <QCheckBox>
+#include <QCoreApplication>
+#include <QFutureWatcher>
 #include <QPainter>
 #include <QPrinter>
 #include <QPrintDialog>
+#include <QProgressDialog>
+#include <QtConcurrentRun>
 
 // KDE
 #include <KLocalizedString>
 
 // Local
 #include "printoptionspage.h"
+#include <lib/resampler.h>
 
 namespace Gwenview
 {
 
+/**
+ * Maximum number of bytes of a band of resampled pixels
+ */
+static const int MAX_BAND_SIZE = 16 * 1024 * 1024;
+
 struct PrintHelperPrivate
 {
     QWidget* mParent;
@@ -141,11 +151,66 @@ void PrintHelper::print(Document::Ptr doc)
     QRect rect = painter.viewport();
     QSize size = d->adjustSize(optionsPage, doc, printer.resolution(), rect.size());
     QPoint pos = d->adjustPosition(optionsPage, size, rect.size());
-    painter.setViewport(pos.x(), pos.y(), size.width(), size.height());
 
-    QImage image = doc->image();
-    painter.setWindow(image.rect());
-    painter.drawImage(0, 0, image);
+    QProgressDialog progressDialog(d->mParent);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setLabelText(i18nc("@info:progress", "Printing..."));
+    progressDialog.setRange(0, 100);
+    // Events are processed while printing: work on our own copy of the
+    // image, which stays valid even if the document changes meanwhile
+    const QImage image = doc->image();
+    const bool done = drawImage(&painter, image, QRect(rect.topLeft() + pos, size), [&progressDialog](int percent) {
+        progressDialog.setValue(percent);
+        return !progressDialog.wasCanceled();
+    });
+    if (!done) {
+        printer.abort();
+    }
+}
+
+bool PrintHelper::drawImage(QPainter* painter, const QImage& image, const QRect& rect, const ProgressFunction& progress)
+{
+    if (image.isNull() || rect.isEmpty()) {
+        return true;
+    }
+    // Resampling to more pixels than the image has would only make the
+    // output bigger: let the printer enlarge the image in that case
+    QSize pixelSize = rect.size();
+    if (pixelSize.width() >= image.width() && pixelSize.height() >= image.height()) {
+        pixelSize = image.size();
+    }
+    const int height = pixelSize.height();
+    const int bandRows = qBound(1, MAX_BAND_SIZE / (pixelSize.width() * 4), height);
+    auto startBand = [&image, &pixelSize, bandRows](int firstRow) {
+        return QtConcurrent::run([image, pixelSize, firstRow, bandRows]() {
+            return Resampler::scaledBand(image, pixelSize, Resampler::Lanczos3, firstRow, bandRows);
+        });
+    };
+
+    // Resample the next band while the current one is painted, and keep
+    // processing events while waiting for it
+    QFutureWatcher<QImage> watcher;
+    watcher.setFuture(startBand(0));
+    for (int firstRow = 0; firstRow < height; firstRow += bandRows) {
+        while (!watcher.isFinished()) {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+        const QImage band = watcher.result();
+        const int lastRow = firstRow + band.height();
+        if (lastRow < height) {
+            watcher.setFuture(startBand(lastRow));
+        }
+
+        const int top = rect.top() + int(qint64(firstRow) * rect.height() / height);
+        const int bottom = rect.top() + int(qint64(lastRow) * rect.height() / height);
+        painter->drawImage(QRect(rect.left(), top, rect.width(), bottom - top), band);
+
+        if (progress && !progress(int(qint64(lastRow) * 100 / height))) {
+            watcher.waitForFinished();
+            return false;
+        }
+    }
+    return true;
 }
 
 } // namespace
@@ -23,6 +23,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 #include <lib/gwenviewlib_export.h>
 
+// STD
+#include <functional>
+
 // Qt
 
 // KDE
@@ -30,6 +33,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 // Local
 #include <lib/document/document.h>
 
+class QPainter;
+class QRect;
 class QWidget;
 
 namespace Gwenview
@@ -42,8 +47,25 @@ public:
     PrintHelper(QWidget* parent);
     ~PrintHelper();
 
+    /**
+     * Called with the percentage of the image which has been drawn. Must
+     * return false to stop drawing.
+     */
+    typedef std::function<bool(int percent)> ProgressFunction;
+
     void print(Document::Ptr);
 
+    /**
+     * Draws image in rect, using painter device pixels. The image is
+     * resampled to the size of rect in horizontal bands, on worker threads,
+     * and each band is drawn as soon as it is ready, so that the painter
+     * never receives more pixels than it can print. Events are processed
+     * while waiting for the bands.
+     *
+     * Returns false if progress requested to stop.
+     */
+    static bool drawImage(QPainter* painter, const QImage& image, const QRect& rect, const ProgressFunction& progress = ProgressFunction());
+
 private:
     PrintHelperPrivate* const d;
 };
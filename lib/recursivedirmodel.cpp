@@ -23,19 +23,37 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include <lib/gvdebug.h>
+#include <lib/recursivedirscanner.h>
+#include <lib/urlutils.h>
 
 // KDE
 #include <KDirLister>
 #include <KDirModel>
+#include <KDirWatch>
 
 // Qt
 #include <QDebug>
+#include <QSet>
 
 namespace Gwenview
 {
 
 struct RecursiveDirModelPrivate {
     KDirLister* mDirLister;
+    RecursiveDirScanner* mScanner;
+    KDirWatch* mDirWatch;
+    QUrl mUrl;
+    bool mUseScanner;
+    // Dirs listed by mScanner, and thus watched by mDirWatch
+    QSet<QString> mScannedDirs;
+
+    void unwatchDirs()
+    {
+        Q_FOREACH(const QString& path, mScannedDirs) {
+            mDirWatch->removeDir(path);
+        }
+        mScannedDirs.clear();
+    }
 
     int rowForUrl(const QUrl &url) const
     {
@@ -84,12 +102,21 @@ RecursiveDirModel::RecursiveDirModel(QObject* parent)
 : QAbstractListModel(parent)
 , d(new RecursiveDirModelPrivate)
 {
+    d->mUseScanner = false;
     d->mDirLister = new KDirLister(this);
     connect(d->mDirLister, &KDirLister::itemsAdded, this, &RecursiveDirModel::slotItemsAdded);
     connect(d->mDirLister, &KDirLister::itemsDeleted, this, &RecursiveDirModel::slotItemsDeleted);
     connect(d->mDirLister, static_cast<void (KDirLister::*)()>(&KDirLister::completed), this, &RecursiveDirModel::completed);
     connect(d->mDirLister, static_cast<void (KDirLister::*)()>(&KDirLister::clear), this, &RecursiveDirModel::slotCleared);
     connect(d->mDirLister, static_cast<void (KDirLister::*)(const QUrl &)>(&KDirLister::clear), this, &RecursiveDirModel::slotDirCleared);
+
+    d->mScanner = new RecursiveDirScanner(this);
+    connect(d->mScanner, &RecursiveDirScanner::batchReady, this, &RecursiveDirModel::slotBatchReady);
+    connect(d->mScanner, &RecursiveDirScanner::completed, this, &RecursiveDirModel::completed);
+
+    d->mDirWatch = new KDirWatch(this);
+    connect(d->mDirWatch, &KDirWatch::dirty, this, &RecursiveDirModel::slotDirty);
+    connect(d->mDirWatch, &KDirWatch::deleted, this, &RecursiveDirModel::slotDeleted);
 }
 
 RecursiveDirModel::~RecursiveDirModel()
@@ -99,7 +126,12 @@ RecursiveDirModel::~RecursiveDirModel()
 
 QUrl RecursiveDirModel::url() const
 {
-    return d->mDirLister->url();
+    return d->mUrl;
+}
+
+void RecursiveDirModel::setKindFilter(MimeTypeUtils::Kinds kinds)
+{
+    d->mScanner->setKindFilter(kinds);
 }
 
 void RecursiveDirModel::setUrl(const QUrl &url)
@@ -107,7 +139,16 @@ void RecursiveDirModel::setUrl(const QUrl &url)
     beginResetModel();
     d->clear();
     endResetModel();
-    d->mDirLister->openUrl(url);
+    d->mUrl = url;
+    d->mScanner->stop();
+    d->unwatchDirs();
+    d->mUseScanner = UrlUtils::urlIsFastLocalFile(url);
+    if (d->mUseScanner) {
+        d->mDirLister->stop();
+        d->mScanner->start(url.adjusted(QUrl::StripTrailingSlash).toLocalFile());
+    } else {
+        d->mDirLister->openUrl(url);
+    }
 }
 
 int RecursiveDirModel::rowCount(const QModelIndex& parent) const
@@ -145,6 +186,9 @@ QVariant RecursiveDirModel::data(const QModelIndex& index, int role) const
 
 void RecursiveDirModel::slotItemsAdded(const QUrl&, const KFileItemList& newList)
 {
+    if (d->mUseScanner) {
+        return;
+    }
     QList<QUrl> dirUrls;
     KFileItemList fileList;
     Q_FOREACH(const KFileItem& item, newList) {
@@ -158,7 +202,7 @@ void RecursiveDirModel::slotItemsAdded(const QUrl&, const KFileItemList& newList
     }
 
     if (!fileList.isEmpty()) {
-        beginInsertRows(QModelIndex(), d->list().count(), d->list().count() + fileList.count());
+        beginInsertRows(QModelIndex(), d->list().count(), d->list().count() + fileList.count() - 1);
         Q_FOREACH(const KFileItem& item, fileList) {
             d->addItem(item);
         }
@@ -170,6 +214,81 @@ void RecursiveDirModel::slotItemsAdded(const QUrl&, const KFileItemList& newList
     }
 }
 
+void RecursiveDirModel::slotBatchReady(const RecursiveDirScannerBatch& batch)
+{
+    if (!d->mScannedDirs.contains(batch.dirPath)) {
+        d->mScannedDirs << batch.dirPath;
+        d->mDirWatch->addDir(batch.dirPath);
+    }
+
+    KFileItemList fileList;
+    if (batch.isRescan) {
+        // The batch contains the whole content of the dir: remove rows for
+        // files which are gone
+        QSet<QUrl> urls;
+        Q_FOREACH(const KFileItem& item, batch.files) {
+            urls << item.url();
+        }
+        for (int row = d->list().count() - 1; row >= 0; --row) {
+            const QUrl url = d->list().at(row).url();
+            if (urls.contains(url)) {
+                continue;
+            }
+            if (url.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile() == batch.dirPath) {
+                beginRemoveRows(QModelIndex(), row, row);
+                d->removeAt(row);
+                endRemoveRows();
+            }
+        }
+        // Same for sub dirs
+        const QSet<QString> subDirPaths = batch.subDirPaths.toSet();
+        const QString prefix = batch.dirPath + QLatin1Char('/');
+        Q_FOREACH(const QString& path, d->mScannedDirs) {
+            if (path.startsWith(prefix) && path.indexOf(QLatin1Char('/'), prefix.length()) == -1 && !subDirPaths.contains(path)) {
+                slotDeleted(path);
+            }
+        }
+        // And list new sub dirs
+        Q_FOREACH(const QString& path, batch.subDirPaths) {
+            if (!d->mScannedDirs.contains(path)) {
+                d->mScanner->scan(path);
+            }
+        }
+    }
+
+    Q_FOREACH(const KFileItem& item, batch.files) {
+        if (d->rowForUrl(item.url()) == -1) {
+            fileList << item;
+        }
+    }
+    if (!fileList.isEmpty()) {
+        beginInsertRows(QModelIndex(), d->list().count(), d->list().count() + fileList.count() - 1);
+        Q_FOREACH(const KFileItem& item, fileList) {
+            d->addItem(item);
+        }
+        endInsertRows();
+    }
+}
+
+void RecursiveDirModel::slotDirty(const QString& path)
+{
+    if (d->mScannedDirs.contains(path)) {
+        d->mScanner->rescan(path);
+    }
+}
+
+void RecursiveDirModel::slotDeleted(const QString& path)
+{
+    const QString prefix = path + QLatin1Char('/');
+    Q_FOREACH(const QString& dirPath, d->mScannedDirs) {
+        if (dirPath == path || dirPath.startsWith(prefix)) {
+            d->mDirWatch->removeDir(dirPath);
+            d->mScannedDirs.remove(dirPath);
+        }
+    }
+    slotDirCleared(QUrl::fromLocalFile(path));
+}
+
 void RecursiveDirModel::slotItemsDeleted(const KFileItemList& list)
 {
     Q_FOREACH(const KFileItem& item, list) {
@@ -23,6 +23,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include <lib/gwenviewlib_export.h>
+#include <lib/mimetypeutils.h>
+#include <lib/recursivedirscanner.h>
 
 // KDE
 #include <KFileItem>
@@ -38,6 +40,9 @@ namespace Gwenview
 struct RecursiveDirModelPrivate;
 /**
  * Recursively list content of a dir
+ *
+ * Fast local dirs are listed with RecursiveDirScanner and monitored with
+ * KDirWatch, other dirs are listed with KDirLister.
  */
 class GWENVIEWLIB_EXPORT RecursiveDirModel : public QAbstractListModel
 {
@@ -49,6 +54,13 @@ public:
     QUrl url() const;
     void setUrl(const QUrl&);
 
+    /**
+     * Hint about the kind of files the model is going to be used for. When
+     * listing fast local dirs, files whose extension does not match one of
+     * these kinds are skipped. Must be called before setUrl().
+     */
+    void setKindFilter(MimeTypeUtils::Kinds);
+
     int rowCount(const QModelIndex&) const Q_DECL_OVERRIDE;
     QVariant data(const QModelIndex&, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
 
@@ -60,6 +72,9 @@ private Q_SLOTS:
     void slotItemsDeleted(const KFileItemList&);
     void slotDirCleared(const QUrl&);
     void slotCleared();
+    void slotBatchReady(const Gwenview::RecursiveDirScannerBatch&);
+    void slotDirty(const QString& path);
+    void slotDeleted(const QString& path);
 private:
     RecursiveDirModelPrivate* const d;
 };
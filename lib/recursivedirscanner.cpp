@@ -0,0 +1,321 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "recursivedirscanner.h"
+
+// Local
+#include <lib/gvdebug.h>
+
+// Qt
+#include <QAtomicInt>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QMimeDatabase>
+#include <QRunnable>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QUrl>
+
+// System
+#include <sys/stat.h>
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Gwenview
+{
+
+/**
+ * Number of files after which a partial batch is sent, so that huge
+ * directories show up progressively.
+ */
+static const int MAX_BATCH_SIZE = 2000;
+
+/**
+ * State shared by all tasks of a scan. A new context is created each time
+ * start() is called, so that tasks of a cancelled scan cannot affect the new
+ * one.
+ */
+struct ScanContext {
+    int mGeneration;
+    QAtomicInt mCancelled;
+    QAtomicInt mPendingTasks;
+    bool mFilterEnabled;
+    QSet<QString> mAcceptedMimeTypes;
+
+    bool isCancelled() const
+    {
+        return mCancelled.load() != 0;
+    }
+};
+
+typedef QSharedPointer<ScanContext> ScanContextPtr;
+
+struct RecursiveDirScannerPrivate {
+    RecursiveDirScanner* q;
+    QThreadPool mPool;
+    MimeTypeUtils::Kinds mKindFilter;
+    ScanContextPtr mContext;
+    int mGeneration;
+
+    void startTask(const QString& dirPath, bool recursive);
+};
+
+class RecursiveDirScannerTask : public QRunnable
+{
+public:
+    RecursiveDirScannerTask(RecursiveDirScanner* scanner, const ScanContextPtr& context, const QString& dirPath, bool recursive)
+    : mScanner(scanner)
+    , mContext(context)
+    , mDirPath(dirPath)
+    , mRecursive(recursive)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        if (!mContext->isCancelled()) {
+            list();
+        }
+        if (mContext->mPendingTasks.fetchAndAddOrdered(-1) == 1 && !mContext->isCancelled()) {
+            QMetaObject::invokeMethod(mScanner, "slotScanFinished", Qt::QueuedConnection,
+                                      Q_ARG(int, mContext->mGeneration));
+        }
+    }
+
+private:
+    RecursiveDirScanner* mScanner;
+    ScanContextPtr mContext;
+    QString mDirPath;
+    bool mRecursive;
+    QMimeDatabase mMimeDb;
+
+    void list()
+    {
+        RecursiveDirScannerBatch batch = newBatch();
+#ifdef Q_OS_UNIX
+        const QByteArray encodedDirPath = QFile::encodeName(mDirPath);
+        int fd = ::openat(AT_FDCWD, encodedDirPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd == -1) {
+            qWarning() << "Could not open" << mDirPath;
+            send(batch);
+            return;
+        }
+        // fdopendir() takes ownership of fd, closedir() closes it
+        DIR* dir = ::fdopendir(fd);
+        if (!dir) {
+            ::close(fd);
+            send(batch);
+            return;
+        }
+        while (dirent* entry = ::readdir(dir)) {
+            if (entry->d_name[0] == '.') {
+                // Skip ".", ".." and hidden files, like KDirLister does
+                continue;
+            }
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN || type == DT_LNK) {
+                // Some file systems do not fill d_type. Symbolic links are
+                // resolved so that linked files are listed, but linked dirs
+                // are not followed to avoid loops.
+                struct stat st;
+                int flags = type == DT_LNK ? 0 : AT_SYMLINK_NOFOLLOW;
+                if (::fstatat(::dirfd(dir), entry->d_name, &st, flags) != 0) {
+                    continue;
+                }
+                if (S_ISREG(st.st_mode)) {
+                    type = DT_REG;
+                } else if (S_ISDIR(st.st_mode) && entry->d_type != DT_LNK) {
+                    type = DT_DIR;
+                } else {
+                    continue;
+                }
+            }
+            const QString name = QFile::decodeName(entry->d_name);
+            if (type == DT_DIR) {
+                batch.subDirPaths << mDirPath + QLatin1Char('/') + name;
+            } else if (type == DT_REG) {
+                addFile(&batch, name);
+            }
+            if (mContext->isCancelled()) {
+                break;
+            }
+        }
+        ::closedir(dir);
+#else
+        const QFileInfoList list = QDir(mDirPath).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+        Q_FOREACH(const QFileInfo& info, list) {
+            if (info.isDir()) {
+                if (!info.isSymLink()) {
+                    batch.subDirPaths << info.absoluteFilePath();
+                }
+            } else {
+                addFile(&batch, info.fileName());
+            }
+        }
+#endif
+        batch.isLast = true;
+        if (mRecursive && !mContext->isCancelled()) {
+            Q_FOREACH(const QString& subDirPath, batch.subDirPaths) {
+                mContext->mPendingTasks.ref();
+                QThreadPool* pool = &mScanner->d->mPool;
+                pool->start(new RecursiveDirScannerTask(mScanner, mContext, subDirPath, true));
+            }
+        }
+        send(batch);
+    }
+
+    RecursiveDirScannerBatch newBatch() const
+    {
+        RecursiveDirScannerBatch batch;
+        batch.generation = mContext->mGeneration;
+        batch.dirPath = mDirPath;
+        batch.isLast = false;
+        batch.isRescan = !mRecursive;
+        return batch;
+    }
+
+    void addFile(RecursiveDirScannerBatch* batch, const QString& name)
+    {
+        QString mimeType;
+        if (mContext->mFilterEnabled) {
+            // Only look at the extension: reading the content of each file
+            // would defeat the purpose of this class
+            mimeType = mMimeDb.mimeTypeForFile(name, QMimeDatabase::MatchExtension).name();
+            if (!mContext->mAcceptedMimeTypes.contains(mimeType)) {
+                return;
+            }
+        }
+        const QUrl url = QUrl::fromLocalFile(mDirPath + QLatin1Char('/') + name);
+        batch->files << KFileItem(url, mimeType, S_IFREG);
+        if (mRecursive && batch->files.count() >= MAX_BATCH_SIZE) {
+            send(*batch);
+            batch->files.clear();
+        }
+    }
+
+    void send(const RecursiveDirScannerBatch& batch)
+    {
+        if (mContext->isCancelled()) {
+            return;
+        }
+        QMetaObject::invokeMethod(mScanner, "slotBatchReady", Qt::QueuedConnection,
+                                  Q_ARG(Gwenview::RecursiveDirScannerBatch, batch));
+    }
+};
+
+void RecursiveDirScannerPrivate::startTask(const QString& dirPath, bool recursive)
+{
+    GV_RETURN_IF_FAIL(mContext);
+    mContext->mPendingTasks.ref();
+    mPool.start(new RecursiveDirScannerTask(q, mContext, dirPath, recursive));
+}
+
+RecursiveDirScanner::RecursiveDirScanner(QObject* parent)
+: QObject(parent)
+, d(new RecursiveDirScannerPrivate)
+{
+    qRegisterMetaType<RecursiveDirScannerBatch>("Gwenview::RecursiveDirScannerBatch");
+    d->q = this;
+    d->mGeneration = 0;
+    // Listing is mostly waiting for the disk: use a few more threads than
+    // there are cores so that the IO queue stays busy
+    d->mPool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() * 2));
+}
+
+RecursiveDirScanner::~RecursiveDirScanner()
+{
+    stop();
+    d->mPool.waitForDone();
+    delete d;
+}
+
+void RecursiveDirScanner::setKindFilter(MimeTypeUtils::Kinds kinds)
+{
+    d->mKindFilter = kinds;
+}
+
+int RecursiveDirScanner::generation() const
+{
+    return d->mGeneration;
+}
+
+void RecursiveDirScanner::start(const QString& rootPath)
+{
+    stop();
+    ++d->mGeneration;
+    d->mContext = ScanContextPtr(new ScanContext);
+    d->mContext->mGeneration = d->mGeneration;
+    d->mContext->mFilterEnabled = d->mKindFilter != MimeTypeUtils::Kinds();
+    if (d->mContext->mFilterEnabled) {
+        // Resolve the list of accepted mime types here, in the GUI thread:
+        // MimeTypeUtils is not thread-safe
+        QMimeDatabase db;
+        Q_FOREACH(const QMimeType& mimeType, db.allMimeTypes()) {
+            if (MimeTypeUtils::mimeTypeKind(mimeType.name()) & d->mKindFilter) {
+                d->mContext->mAcceptedMimeTypes << mimeType.name();
+            }
+        }
+    }
+    d->startTask(rootPath, true);
+}
+
+void RecursiveDirScanner::rescan(const QString& dirPath)
+{
+    d->startTask(dirPath, false);
+}
+
+void RecursiveDirScanner::scan(const QString& dirPath)
+{
+    d->startTask(dirPath, true);
+}
+
+void RecursiveDirScanner::stop()
+{
+    if (!d->mContext) {
+        return;
+    }
+    d->mContext->mCancelled.store(1);
+    d->mPool.clear();
+    d->mContext.clear();
+}
+
+void RecursiveDirScanner::slotBatchReady(const RecursiveDirScannerBatch& batch)
+{
+    if (batch.generation != d->mGeneration) {
+        return;
+    }
+    emit batchReady(batch);
+}
+
+void RecursiveDirScanner::slotScanFinished(int generation)
+{
+    if (generation != d->mGeneration) {
+        return;
+    }
+    emit completed();
+}
+
+} // namespace
@@ -0,0 +1,122 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef RECURSIVEDIRSCANNER_H
+#define RECURSIVEDIRSCANNER_H
+
+// Local
+#include <lib/gwenviewlib_export.h>
+#include <lib/mimetypeutils.h>
+
+// KDE
+#include <KFileItem>
+
+// Qt
+#include <QMetaType>
+#include <QObject>
+#include <QStringList>
+
+namespace Gwenview
+{
+
+/**
+ * A batch of entries found while listing a directory. Large directories are
+ * delivered in several batches, the last one having isLast set to true.
+ * Batches produced by RecursiveDirScanner::rescan() are never split and have
+ * isRescan set to true: they contain the whole content of the directory.
+ */
+struct RecursiveDirScannerBatch {
+    int generation;
+    QString dirPath;
+    KFileItemList files;
+    QStringList subDirPaths;
+    bool isLast;
+    bool isRescan;
+};
+
+struct RecursiveDirScannerPrivate;
+/**
+ * Lists a local directory tree using a pool of worker threads.
+ *
+ * Each directory is read with a single low-level directory read, files are
+ * filtered on their extension before any KFileItem is created, and results
+ * are streamed back to the thread the scanner lives in as batches.
+ *
+ * Only use this for fast local files, see UrlUtils::urlIsFastLocalFile().
+ */
+class GWENVIEWLIB_EXPORT RecursiveDirScanner : public QObject
+{
+    Q_OBJECT
+public:
+    RecursiveDirScanner(QObject* parent = 0);
+    ~RecursiveDirScanner();
+
+    /**
+     * Only report files whose extension matches one of these kinds. An empty
+     * filter reports all files.
+     */
+    void setKindFilter(MimeTypeUtils::Kinds);
+
+    /**
+     * Cancels any running scan and starts listing rootPath recursively
+     */
+    void start(const QString& rootPath);
+
+    /**
+     * Lists dirPath again, without recursing into its sub directories. Used
+     * to refresh a directory after a change notification.
+     */
+    void rescan(const QString& dirPath);
+
+    /**
+     * Lists dirPath recursively as part of the current scan
+     */
+    void scan(const QString& dirPath);
+
+    /**
+     * Cancels the current scan. Batches which have not been delivered yet
+     * are dropped.
+     */
+    void stop();
+
+    int generation() const;
+
+Q_SIGNALS:
+    void batchReady(const Gwenview::RecursiveDirScannerBatch&);
+
+    /**
+     * Emitted when there are no more directories to list
+     */
+    void completed();
+
+private Q_SLOTS:
+    void slotBatchReady(const Gwenview::RecursiveDirScannerBatch&);
+    void slotScanFinished(int generation);
+
+private:
+    friend class RecursiveDirScannerTask;
+    RecursiveDirScannerPrivate* const d;
+};
+
+} // namespace
+
+Q_DECLARE_METATYPE(Gwenview::RecursiveDirScannerBatch)
+
+#endif /* RECURSIVEDIRSCANNER_H */
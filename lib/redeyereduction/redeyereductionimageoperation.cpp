@@ -22,11 +22,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "redeyereductionimageoperation.h"
 
 // Stdc
+#include <limits.h>
 #include <math.h>
 
 // Qt
 #include <QImage>
 #include <QPainter>
+#include <QVector>
 #include <QDebug>
 
 // KDE
@@ -37,7 +39,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "document/document.h"
 #include "document/documentjob.h"
 #include "document/abstractdocumenteditor.h"
+#include "gvdebug.h"
+#include "imageundodata.h"
 #include "paintutils.h"
+#include "parallelutils.h"
 
 namespace Gwenview
 {
@@ -67,7 +72,7 @@ private:
 struct RedEyeReductionImageOperationPrivate
 {
     QRectF mRectF;
-    QImage mOriginalImage;
+    ImageUndoData mUndoData;
 };
 
 RedEyeReductionImageOperation::RedEyeReductionImageOperation(const QRectF& rectF)
@@ -86,7 +91,7 @@ void RedEyeReductionImageOperation::redo()
 {
     QImage img = document()->image();
     QRect rect = PaintUtils::containingRect(d->mRectF);
-    d->mOriginalImage = img.copy(rect);
+    d->mUndoData.store(img.copy(rect), QImage());
     redoAsDocumentJob(new RedEyeReductionJob(d->mRectF));
 }
 
@@ -101,35 +106,78 @@ void RedEyeReductionImageOperation::undo()
         QPainter painter(&img);
         painter.setCompositionMode(QPainter::CompositionMode_Source);
         QRect rect = PaintUtils::containingRect(d->mRectF);
-        painter.drawImage(rect.topLeft(), d->mOriginalImage);
+        painter.drawImage(rect.topLeft(), d->mUndoData.restore(QImage()));
     }
     document()->editor()->setImage(img);
 }
 
+int RedEyeReductionImageOperation::memoryUsage() const
+{
+    return d->mUndoData.memoryUsage();
+}
+
+/**
+ * Number of entries of the radial falloff table. The table is indexed by the
+ * squared distance to the center of the eye, so that no square root is
+ * needed per pixel.
+ */
+static const int FALLOFF_TABLE_SIZE = 1024;
+
 /**
+ * Minimum number of rows processed by a thread
+ */
+static const int MIN_ROWS_PER_STRIPE = 16;
+
+/**
+ * Returns how much the red of rgb must be replaced with its green.
+ *
  * This code is inspired from code found in a Paint.net plugin:
  * http://paintdotnet.forumer.com/viewtopic.php?f=27&t=26193&p=205954&hilit=red+eye#p205954
+ *
+ * It computes hue and saturation the way QColor::getHsv() does, but without
+ * branches on the pixel value, so that the compiler can vectorize the loop
+ * calling it.
+ *
+ * The QColor based version multiplied the result with the alpha of the
+ * pixel, but it built its QColor from a QRgb, which ignores alpha, so the
+ * factor was always 1. Translucent pixels are still corrected like opaque
+ * ones, and now keep their alpha instead of being made opaque.
  */
-inline qreal computeRedEyeAlpha(const QColor& src)
+inline double computeRedEyeAlpha(QRgb rgb)
 {
-    int hue, sat, value;
-    src.getHsv(&hue, &sat, &value);
-
-    qreal axs = 1.0;
-    if (hue > 259) {
-        static const Ramp ramp(30, 35, 0., 1.);
-        axs = ramp(sat);
-    } else {
-        const Ramp ramp(hue * 2 + 29, hue * 2 + 40, 0., 1.);
-        axs = ramp(sat);
-    }
-
-    return qBound(qreal(0.), src.alphaF() * axs, qreal(1.));
+    // Work on the same values as QColor, so that rounding is the same
+    const double r = qRed(rgb) * 0x101 / double(USHRT_MAX);
+    const double g = qGreen(rgb) * 0x101 / double(USHRT_MAX);
+    const double b = qBlue(rgb) * 0x101 / double(USHRT_MAX);
+    const double max = qMax(r, qMax(g, b));
+    const double min = qMin(r, qMin(g, b));
+    const double delta = max - min;
+    // Achromatic pixels get a saturation of 0, which gives a null alpha
+    const double safeDelta = delta > 0 ? delta : 1;
+    const double safeMax = max > 0 ? max : 1;
+
+    const int sat = int((delta / safeMax) * USHRT_MAX + 0.5) >> 8;
+    double hue = r == max ? (g - b) / safeDelta
+        : g == max ? 2. + (b - r) / safeDelta
+        : 4. + (r - g) / safeDelta;
+    hue *= 60.;
+    hue = hue < 0. ? hue + 360. : hue;
+    const int intHue = int(hue * 100 + 0.5) / 100;
+
+    // Same as Ramp(30, 35, 0, 1) if intHue > 259, as
+    // Ramp(intHue * 2 + 29, intHue * 2 + 40, 0, 1) otherwise
+    const double low = intHue > 259 ? 30. : intHue * 2. + 29.;
+    const double width = intHue > 259 ? 5. : 11.;
+    return qBound(0., (sat - low) / width, 1.);
 }
 
 void RedEyeReductionImageOperation::apply(QImage* img, const QRectF& rectF)
 {
-    const QRect rect = PaintUtils::containingRect(rectF);
+    GV_RETURN_IF_FAIL(img->depth() == 32);
+    const QRect rect = PaintUtils::containingRect(rectF) & img->rect();
+    if (rect.isEmpty()) {
+        return;
+    }
     const qreal radius = rectF.width() / 2;
     const qreal centerX = rectF.x() + radius;
     const qreal centerY = rectF.y() + radius;
@@ -137,30 +185,55 @@ void RedEyeReductionImageOperation::apply(QImage* img, const QRectF& rectF)
         qMin(qreal(radius * 0.7), qreal(radius - 1)), radius,
         qreal(1.), qreal(0.));
 
-    uchar* line = img->scanLine(rect.top()) + rect.left() * 4;
-    for (int y = rect.top(); y < rect.bottom(); ++y, line += img->bytesPerLine()) {
-        QRgb* ptr = (QRgb*)line;
+    // falloffTable[i] is the falloff at squared distance (i + 0.5) / scale.
+    // The last entry is for pixels outside of the eye.
+    const double scale = FALLOFF_TABLE_SIZE / qMax(radius * radius, qreal(1.));
+    QVector<double> falloffTable(FALLOFF_TABLE_SIZE + 1);
+    for (int i = 0; i < FALLOFF_TABLE_SIZE; ++i) {
+        falloffTable[i] = radiusRamp(sqrt((i + 0.5) / scale));
+    }
+    falloffTable[FALLOFF_TABLE_SIZE] = 0;
 
-        for (int x = rect.left(); x < rect.right(); ++x, ++ptr) {
-            const qreal currentRadius = sqrt(pow(y - centerY, 2) + pow(x - centerX, 2));
-            qreal alpha = radiusRamp(currentRadius);
-            if (qFuzzyCompare(alpha, 0)) {
-                continue;
-            }
+    // As before, the last column and the last row of rect are left untouched
+    const int width = rect.width() - 1;
+    const int height = rect.height() - 1;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    QVector<double> dx2(width);
+    for (int x = 0; x < width; ++x) {
+        const double dx = rect.left() + x - centerX;
+        dx2[x] = dx * dx;
+    }
 
-            const QColor src(*ptr);
-            alpha *= computeRedEyeAlpha(src);
-            int r = src.red();
-            int g = src.green();
-            int b = src.blue();
-            QColor dst;
-            // Replace red with green, and blend according to alpha
-            dst.setRed(int((1 - alpha) * r + alpha * g));
-            dst.setGreen(g);
-            dst.setBlue(b);
-            *ptr = dst.rgba();
+    // Detach now, not from the worker threads
+    uchar* bits = img->bits();
+    const int bytesPerLine = img->bytesPerLine();
+    ParallelUtils::forEachRowStripe(height, MIN_ROWS_PER_STRIPE, [&](int begin, int end) {
+        QVector<double> alphas(width);
+        for (int row = begin; row < end; ++row) {
+            const int y = rect.top() + row;
+            QRgb* line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine) + rect.left();
+            const double dy = y - centerY;
+            const double dy2 = dy * dy;
+
+            for (int x = 0; x < width; ++x) {
+                const int index = qMin(int((dx2[x] + dy2) * scale), FALLOFF_TABLE_SIZE);
+                alphas[x] = falloffTable[index];
+            }
+            for (int x = 0; x < width; ++x) {
+                alphas[x] *= computeRedEyeAlpha(line[x]);
+            }
+            for (int x = 0; x < width; ++x) {
+                const QRgb src = line[x];
+                const double alpha = alphas[x];
+                const int r = qRed(src);
+                const int g = qGreen(src);
+                // Replace red with green, and blend according to alpha
+                line[x] = qRgba(int((1 - alpha) * r + alpha * g), g, qBlue(src), qAlpha(src));
+            }
         }
-    }
+    });
 }
 
 } // namespace
@@ -44,6 +44,7 @@ public:
 
     virtual void redo() Q_DECL_OVERRIDE;
     virtual void undo() Q_DECL_OVERRIDE;
+    virtual int memoryUsage() const Q_DECL_OVERRIDE;
 
     static void apply(QImage* img, const QRectF& rectF);
 
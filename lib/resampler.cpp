@@ -0,0 +1,296 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "resampler.h"
+
+// Local
+#include <lib/parallelutils.h>
+
+// Qt
+#include <QAtomicInt>
+#include <QImage>
+#include <QMutex>
+#include <QtMath>
+#include <QVector>
+
+// STL
+#include <cmath>
+
+namespace Gwenview
+{
+
+namespace Resampler
+{
+
+/**
+ * Maximum number of bytes of the intermediate buffer of a strip
+ */
+static const int MAX_STRIP_BUFFER_SIZE = 8 * 1024 * 1024;
+
+/**
+ * Maximum number of destination rows in a strip
+ */
+static const int MAX_STRIP_ROWS = 64;
+
+static double sinc(double x)
+{
+    if (x == 0) {
+        return 1;
+    }
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double lanczos3(double x)
+{
+    x = fabs(x);
+    return x < 3 ? sinc(x) * sinc(x / 3) : 0;
+}
+
+static double mitchell(double x)
+{
+    // Mitchell-Netravali, with the recommended B = C = 1/3
+    const double B = 1. / 3;
+    const double C = 1. / 3;
+    x = fabs(x);
+    if (x < 1) {
+        return ((12 - 9 * B - 6 * C) * x * x * x
+                + (-18 + 12 * B + 6 * C) * x * x
+                + (6 - 2 * B)) / 6;
+    } else if (x < 2) {
+        return ((-B - 6 * C) * x * x * x
+                + (6 * B + 30 * C) * x * x
+                + (-12 * B - 48 * C) * x
+                + (8 * B + 24 * C)) / 6;
+    }
+    return 0;
+}
+
+/**
+ * For each destination pixel along an axis, the source pixels it is made of
+ */
+struct Contributions
+{
+    int windowSize;
+    QVector<int> first;
+    QVector<int> count;
+    // windowSize weights per destination pixel
+    QVector<float> weights;
+
+    const float* weightsFor(int index) const
+    {
+        return weights.constData() + index * windowSize;
+    }
+};
+
+static Contributions computeContributions(int srcLength, int dstLength, Filter filter)
+{
+    double (*kernel)(double) = filter == Lanczos3 ? lanczos3 : mitchell;
+    const double kernelSupport = filter == Lanczos3 ? 3. : 2.;
+    const double scale = double(dstLength) / srcLength;
+    // When reducing, stretch the kernel so that all source pixels are used
+    const double kernelScale = qMax(1., 1. / scale);
+    const double support = kernelSupport * kernelScale;
+
+    Contributions contributions;
+    contributions.windowSize = qMin(int(ceil(support * 2)) + 2, srcLength);
+    contributions.first.resize(dstLength);
+    contributions.count.resize(dstLength);
+    contributions.weights.fill(0.f, dstLength * contributions.windowSize);
+
+    for (int i = 0; i < dstLength; ++i) {
+        const double center = (i + 0.5) / scale;
+        const int first = qMax(0, int(floor(center - support)));
+        const int last = qMin(srcLength, int(ceil(center + support)));
+        const int count = qMin(last - first, contributions.windowSize);
+        float* weights = contributions.weights.data() + i * contributions.windowSize;
+        double sum = 0;
+        for (int j = 0; j < count; ++j) {
+            const double weight = kernel((first + j + 0.5 - center) / kernelScale);
+            weights[j] = weight;
+            sum += weight;
+        }
+        if (sum != 0) {
+            for (int j = 0; j < count; ++j) {
+                weights[j] /= sum;
+            }
+        }
+        contributions.first[i] = first;
+        contributions.count[i] = count;
+    }
+    return contributions;
+}
+
+static inline uint toChannel(float value, uint max)
+{
+    return qBound(0, int(value + 0.5f), int(max));
+}
+
+/**
+ * Scales image to size, but only computes destination rows dstBegin to
+ * dstEnd (excluded)
+ */
+static QImage scaleRows(const QImage& image, const QSize& size, Filter filter, int dstBegin, int dstEnd, const ProgressFunction& progress)
+{
+    const bool hasAlpha = image.hasAlphaChannel();
+    const QImage::Format format = hasAlpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    if (size == image.size()) {
+        if (dstBegin == 0 && dstEnd == size.height()) {
+            return image.convertToFormat(format);
+        }
+        return image.copy(0, dstBegin, image.width(), dstEnd - dstBegin).convertToFormat(format);
+    }
+
+    const int srcWidth = image.width();
+    const int srcHeight = image.height();
+    const int dstWidth = size.width();
+    const int dstHeight = size.height();
+    const Contributions horizontal = computeContributions(srcWidth, dstWidth, filter);
+    const Contributions vertical = computeContributions(srcHeight, dstHeight, filter);
+
+    // Intermediate values are stored as 4 floats per pixel
+    const int bufferRowSize = dstWidth * 4;
+    const double srcRowsPerDstRow = qMax(1., double(srcHeight) / dstHeight) + 1;
+    const int stripRows = qBound(1, int(MAX_STRIP_BUFFER_SIZE / (bufferRowSize * sizeof(float) * srcRowsPerDstRow)), MAX_STRIP_ROWS);
+
+    const int resultHeight = dstEnd - dstBegin;
+    QImage result(dstWidth, resultHeight, format);
+    // Detach now, not from the worker threads
+    uchar* dstBits = result.bits();
+    const int dstBytesPerLine = result.bytesPerLine();
+
+    QAtomicInt doneRows;
+    QMutex progressMutex;
+    int lastPercent = -1;
+
+    auto processStrip = [&](int stripBegin, int stripEnd) {
+        const int srcBegin = vertical.first[stripBegin];
+        const int srcEnd = vertical.first[stripEnd - 1] + vertical.count[stripEnd - 1];
+
+        // Only convert the rows this strip needs
+        QImage converted;
+        const uchar* srcBits;
+        int srcBytesPerLine;
+        if (image.format() == format) {
+            srcBits = image.constScanLine(srcBegin);
+            srcBytesPerLine = image.bytesPerLine();
+        } else {
+            converted = image.copy(0, srcBegin, srcWidth, srcEnd - srcBegin).convertToFormat(format);
+            srcBits = converted.constBits();
+            srcBytesPerLine = converted.bytesPerLine();
+        }
+
+        // Horizontal pass
+        QVector<float> buffer((srcEnd - srcBegin) * bufferRowSize);
+        for (int row = 0; row < srcEnd - srcBegin; ++row) {
+            const QRgb* src = reinterpret_cast<const QRgb*>(srcBits + row * srcBytesPerLine);
+            float* dst = buffer.data() + row * bufferRowSize;
+            for (int x = 0; x < dstWidth; ++x, dst += 4) {
+                const QRgb* pixels = src + horizontal.first[x];
+                const float* weights = horizontal.weightsFor(x);
+                const int count = horizontal.count[x];
+                float r = 0, g = 0, b = 0, a = 0;
+                for (int j = 0; j < count; ++j) {
+                    const float weight = weights[j];
+                    r += weight * qRed(pixels[j]);
+                    g += weight * qGreen(pixels[j]);
+                    b += weight * qBlue(pixels[j]);
+                    a += weight * qAlpha(pixels[j]);
+                }
+                dst[0] = r;
+                dst[1] = g;
+                dst[2] = b;
+                dst[3] = a;
+            }
+        }
+
+        // Vertical pass
+        QVector<float> accumulator(bufferRowSize);
+        for (int y = stripBegin; y < stripEnd; ++y) {
+            accumulator.fill(0.f);
+            float* acc = accumulator.data();
+            const float* weights = vertical.weightsFor(y);
+            const int first = vertical.first[y] - srcBegin;
+            const int count = vertical.count[y];
+            for (int j = 0; j < count; ++j) {
+                const float weight = weights[j];
+                const float* src = buffer.constData() + (first + j) * bufferRowSize;
+                for (int i = 0; i < bufferRowSize; ++i) {
+                    acc[i] += weight * src[i];
+                }
+            }
+
+            QRgb* dst = reinterpret_cast<QRgb*>(dstBits + (y - dstBegin) * dstBytesPerLine);
+            for (int x = 0; x < dstWidth; ++x, acc += 4) {
+                if (hasAlpha) {
+                    // Lanczos lobes can overshoot, keep the result a valid
+                    // premultiplied color
+                    const uint a = toChannel(acc[3], 255);
+                    dst[x] = qRgba(toChannel(acc[0], a), toChannel(acc[1], a), toChannel(acc[2], a), a);
+                } else {
+                    dst[x] = qRgb(toChannel(acc[0], 255), toChannel(acc[1], 255), toChannel(acc[2], 255));
+                }
+            }
+        }
+
+        if (progress) {
+            const int rows = doneRows.fetchAndAddOrdered(stripEnd - stripBegin) + stripEnd - stripBegin;
+            const int percent = int(qint64(rows) * 100 / resultHeight);
+            QMutexLocker locker(&progressMutex);
+            if (percent > lastPercent) {
+                lastPercent = percent;
+                progress(percent);
+            }
+        }
+    };
+
+    ParallelUtils::forEachRowStripe(resultHeight, stripRows, [&](int begin, int end) {
+        for (int y = dstBegin + begin; y < dstBegin + end; y += stripRows) {
+            processStrip(y, qMin(y + stripRows, dstBegin + end));
+        }
+    });
+    return result;
+}
+
+QImage scaled(const QImage& image, const QSize& size, Filter filter, const ProgressFunction& progress)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return QImage();
+    }
+    return scaleRows(image, size, filter, 0, size.height(), progress);
+}
+
+QImage scaledBand(const QImage& image, const QSize& size, Filter filter, int firstRow, int rowCount)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return QImage();
+    }
+    const int dstBegin = qBound(0, firstRow, size.height());
+    const int dstEnd = qBound(dstBegin, firstRow + rowCount, size.height());
+    if (dstBegin == dstEnd) {
+        return QImage();
+    }
+    return scaleRows(image, size, filter, dstBegin, dstEnd, ProgressFunction());
+}
+
+} // namespace
+
+} // namespace
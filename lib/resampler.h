@@ -0,0 +1,74 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// STL
+#include <functional>
+
+class QImage;
+class QSize;
+
+namespace Gwenview
+{
+
+namespace Resampler
+{
+
+enum Filter {
+    Lanczos3, ///< Sharp, best to reduce photos
+    Mitchell  ///< Smoother, with less ringing, best to enlarge
+};
+
+/**
+ * Called with the percentage of the work done
+ */
+typedef std::function<void(int percent)> ProgressFunction;
+
+/**
+ * Returns image scaled to size with filter. The result is in
+ * Format_ARGB32_Premultiplied if image has an alpha channel, in
+ * Format_RGB32 otherwise.
+ *
+ * The filter is applied horizontally then vertically, on strips of
+ * destination rows processed by the global thread pool. A strip only
+ * converts and filters the source rows it needs, so the memory used in
+ * addition to image and the result stays small whatever their size.
+ *
+ * progress is called each time the percentage of the work done changes.
+ * It is called from worker threads, but never concurrently.
+ */
+GWENVIEWLIB_EXPORT QImage scaled(const QImage& image, const QSize& size, Filter filter, const ProgressFunction& progress = ProgressFunction());
+
+/**
+ * Returns rowCount rows of image scaled to size with filter, starting at
+ * firstRow. The rows are the same as the ones of scaled(), so an image can
+ * be scaled band by band without ever holding the whole result.
+ */
+GWENVIEWLIB_EXPORT QImage scaledBand(const QImage& image, const QSize& size, Filter filter, int firstRow, int rowCount);
+
+} // namespace
+
+} // namespace
+
+#endif /* RESAMPLER_H */
@@ -84,6 +84,12 @@ void ResizeImageDialog::setOriginalSize(const QSize& size)
     d->mHeightSpinBox->setValue(size.height());
 }
 
+Resampler::Filter ResizeImageDialog::filter() const
+{
+    // Combo box items are in the same order as Resampler::Filter values
+    return Resampler::Filter(d->mFilterComboBox->currentIndex());
+}
+
 QSize ResizeImageDialog::size() const
 {
     return QSize(
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // KDE
 
 // Local
+#include <lib/resampler.h>
 
 namespace Gwenview
 {
@@ -43,6 +44,7 @@ public:
 
     void setOriginalSize(const QSize&);
     QSize size() const;
+    Resampler::Filter filter() const;
 
 private Q_SLOTS:
     void slotWidthChanged(int);
@@ -32,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "document/abstractdocumenteditor.h"
 #include "document/document.h"
 #include "document/documentjob.h"
+#include "imageundodata.h"
 
 namespace Gwenview
 {
@@ -39,14 +40,17 @@ namespace Gwenview
 struct ResizeImageOperationPrivate
 {
     QSize mSize;
-    QImage mOriginalImage;
+    Resampler::Filter mFilter;
+    ImageUndoData mUndoData;
 };
 
 class ResizeJob : public ThreadedDocumentJob
 {
 public:
-    ResizeJob(const QSize& size)
+    ResizeJob(const QSize& size, Resampler::Filter filter, ImageUndoData* undoData)
         : mSize(size)
+        , mFilter(filter)
+        , mUndoData(undoData)
     {}
 
     void threadedStart() Q_DECL_OVERRIDE
@@ -54,20 +58,27 @@ public:
         if (!checkDocumentEditor()) {
             return;
         }
-        QImage image = document()->image();
-        image = image.scaled(mSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        document()->editor()->setImage(image);
+        const QImage src = document()->image();
+        const QImage dst = Resampler::scaled(src, mSize, mFilter, [this](int percent) {
+            setPercent(percent);
+        });
+        // No pixel survives a resize, all of src is kept, compressed
+        mUndoData->store(src, QImage());
+        document()->editor()->setImage(dst);
         setError(NoError);
     }
 
 private:
     QSize mSize;
+    Resampler::Filter mFilter;
+    ImageUndoData* mUndoData;
 };
 
-ResizeImageOperation::ResizeImageOperation(const QSize& size)
+ResizeImageOperation::ResizeImageOperation(const QSize& size, Resampler::Filter filter)
 : d(new ResizeImageOperationPrivate)
 {
     d->mSize = size;
+    d->mFilter = filter;
     setText(i18nc("(qtundo-format)", "Resize"));
 }
 
@@ -78,8 +89,7 @@ ResizeImageOperation::~ResizeImageOperation()
 
 void ResizeImageOperation::redo()
 {
-    d->mOriginalImage = document()->image();
-    redoAsDocumentJob(new ResizeJob(d->mSize));
+    redoAsDocumentJob(new ResizeJob(d->mSize, d->mFilter, &d->mUndoData));
 }
 
 void ResizeImageOperation::undo()
@@ -88,7 +98,12 @@ void ResizeImageOperation::undo()
         qWarning() << "!document->editor()";
         return;
     }
-    document()->editor()->setImage(d->mOriginalImage);
+    document()->editor()->setImage(d->mUndoData.restore(QImage()));
+}
+
+int ResizeImageOperation::memoryUsage() const
+{
+    return d->mUndoData.memoryUsage();
 }
 
 } // namespace
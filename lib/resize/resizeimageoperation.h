@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Local
 #include <lib/abstractimageoperation.h>
+#include <lib/resampler.h>
 
 namespace Gwenview
 {
@@ -37,11 +38,12 @@ struct ResizeImageOperationPrivate;
 class GWENVIEWLIB_EXPORT ResizeImageOperation : public AbstractImageOperation
 {
 public:
-    ResizeImageOperation(const QSize& size);
+    ResizeImageOperation(const QSize& size, Resampler::Filter filter = Resampler::Lanczos3);
     ~ResizeImageOperation();
 
     virtual void redo() Q_DECL_OVERRIDE;
     virtual void undo() Q_DECL_OVERRIDE;
+    virtual int memoryUsage() const Q_DECL_OVERRIDE;
 
 private:
     ResizeImageOperationPrivate* const d;
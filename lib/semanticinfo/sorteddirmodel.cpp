@@ -21,6 +21,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <config-gwenview.h>
 
 // Qt
+#include <QCollator>
+#include <QHash>
 #include <QTimer>
 #include <QDebug>
 #include <QUrl>
@@ -31,7 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include <lib/archiveutils.h>
-#include <lib/timeutils.h>
+#include <lib/fileitemsortkey.h>
 #ifdef GWENVIEW_SEMANTICINFO_BACKEND_NONE
 #include <KDirModel>
 #else
@@ -42,6 +44,21 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 namespace Gwenview
 {
 
+/**
+ * New top-level rows are held back and released to the proxy at most every
+ * RELEASE_ROWS_INTERVAL milliseconds, or as soon as MAX_PENDING_ROWS are
+ * waiting, so that listing a large folder does not cause a sort and a round
+ * of view updates for every small batch sent by KDirLister.
+ */
+static const int RELEASE_ROWS_INTERVAL = 200;
+static const int MAX_PENDING_ROWS = 5000;
+
+/**
+ * How many rows are filtered before giving control back to the event loop
+ * when applying a filter change.
+ */
+static const int FILTER_CHUNK_SIZE = 2000;
+
 AbstractSortedDirModelFilter::AbstractSortedDirModelFilter(SortedDirModel* model)
 : QObject(model)
 , mModel(model)
@@ -68,7 +85,62 @@ struct SortedDirModelPrivate
     QStringList mBlackListedExtensions;
     QList<AbstractSortedDirModelFilter*> mFilters;
     QTimer mDelayedApplyFiltersTimer;
+    SortedDirModel::FilterChange mPendingFilterChange;
     MimeTypeUtils::Kinds mKindFilter;
+
+    // Filtering of top-level rows is done in chunks, starting from
+    // mFilterRow. mFilterRow is -1 when no filtering is in progress.
+    QTimer mFilterChunkTimer;
+    SortedDirModel::FilterChange mFilterChange;
+    int mFilterRow;
+    // True if rows have been inserted below top-level rows, when the model
+    // is used as a tree. Chunks only cover top-level rows.
+    bool mHasChildRows;
+
+    // Top-level source rows after this one have been inserted in the source
+    // model but are not visible yet
+    int mReleasedRowCount;
+    QTimer mReleaseRowsTimer;
+
+    // Sort keys, indexed by the internal pointer of source indexes, which
+    // KDirModel guarantees to be unique for each item
+    mutable QHash<const void*, FileItemSortKey*> mSortKeys;
+    QCollator mCollator;
+
+    // Whether the filters accept a row, indexed like mSortKeys. This makes
+    // invalidateFilter() cheap enough to be called to refilter only a few
+    // rows: the others are not filtered again.
+    mutable QHash<const void*, bool> mAcceptedRows;
+
+    const FileItemSortKey* sortKey(const QModelIndex& sourceIndex) const
+    {
+        FileItemSortKey*& key = mSortKeys[sourceIndex.internalPointer()];
+        if (!key) {
+            key = new FileItemSortKey(mSourceModel->itemForIndex(sourceIndex), mCollator);
+        }
+        return key;
+    }
+
+    void removeCachedRows(const QModelIndex& parent, int first, int last)
+    {
+        for (int row = first; row <= last; ++row) {
+            const QModelIndex index = mSourceModel->index(row, 0, parent);
+            if (mSourceModel->hasChildren(index) && mSourceModel->rowCount(index) > 0) {
+                // Do not bother looking for the data of children
+                clearSortKeys();
+                mAcceptedRows.clear();
+                return;
+            }
+            delete mSortKeys.take(index.internalPointer());
+            mAcceptedRows.remove(index.internalPointer());
+        }
+    }
+
+    void clearSortKeys()
+    {
+        qDeleteAll(mSortKeys);
+        mSortKeys.clear();
+    }
 };
 
 SortedDirModel::SortedDirModel(QObject* parent)
@@ -80,14 +152,41 @@ SortedDirModel::SortedDirModel(QObject* parent)
 #else
     d->mSourceModel = new SemanticInfoDirModel(this);
 #endif
+    d->mCollator.setNumericMode(true);
+    d->mCollator.setCaseSensitivity(sortCaseSensitivity());
+    // Sort keys must be invalidated before QSortFilterProxyModel sorts
+    // changed rows again: connect before calling setSourceModel()
+    connect(d->mSourceModel, &QAbstractItemModel::dataChanged, this, &SortedDirModel::slotSourceDataChanged);
+    connect(d->mSourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &SortedDirModel::slotSourceRowsAboutToBeRemoved);
+    connect(d->mSourceModel, &QAbstractItemModel::modelAboutToBeReset, this, &SortedDirModel::clearCaches);
+    connect(d->mSourceModel, &QAbstractItemModel::layoutAboutToBeChanged, this, &SortedDirModel::clearCaches);
     setSourceModel(d->mSourceModel);
     d->mDelayedApplyFiltersTimer.setInterval(0);
     d->mDelayedApplyFiltersTimer.setSingleShot(true);
     connect(&d->mDelayedApplyFiltersTimer, &QTimer::timeout, this, &SortedDirModel::doApplyFilters);
+    d->mPendingFilterChange = FilterChanged;
+    d->mFilterChange = FilterChanged;
+    d->mFilterRow = -1;
+    d->mHasChildRows = false;
+    d->mFilterChunkTimer.setInterval(0);
+    d->mFilterChunkTimer.setSingleShot(true);
+    connect(&d->mFilterChunkTimer, &QTimer::timeout, this, &SortedDirModel::filterNextChunk);
+
+    d->mReleasedRowCount = 0;
+    d->mReleaseRowsTimer.setInterval(RELEASE_ROWS_INTERVAL);
+    d->mReleaseRowsTimer.setSingleShot(true);
+    connect(&d->mReleaseRowsTimer, &QTimer::timeout, this, &SortedDirModel::releasePendingRows);
+    // These must be connected after setSourceModel() so that they are called
+    // after the QSortFilterProxyModel slots
+    connect(d->mSourceModel, &QAbstractItemModel::rowsAboutToBeInserted, this, &SortedDirModel::slotSourceRowsAboutToBeInserted);
+    connect(d->mSourceModel, &QAbstractItemModel::rowsRemoved, this, &SortedDirModel::slotSourceRowsRemoved);
+    connect(d->mSourceModel, &QAbstractItemModel::modelReset, this, &SortedDirModel::slotSourceModelReset);
+    connectDirLister();
 }
 
 SortedDirModel::~SortedDirModel()
 {
+    d->clearSortKeys();
     delete d;
 }
 
@@ -101,8 +200,18 @@ void SortedDirModel::setKindFilter(MimeTypeUtils::Kinds kindFilter)
     if (d->mKindFilter == kindFilter) {
         return;
     }
+    // An empty kind filter accepts all kinds: check it first, since it is a
+    // subset of any other filter
+    FilterChange change = FilterChanged;
+    if (kindFilter == MimeTypeUtils::Kinds()) {
+        change = FilterWidened;
+    } else if (d->mKindFilter == MimeTypeUtils::Kinds() || (kindFilter & d->mKindFilter) == kindFilter) {
+        change = FilterNarrowed;
+    } else if ((kindFilter & d->mKindFilter) == d->mKindFilter) {
+        change = FilterWidened;
+    }
     d->mKindFilter = kindFilter;
-    applyFilters();
+    applyFilters(change);
 }
 
 void SortedDirModel::adjustKindFilter(MimeTypeUtils::Kinds kinds, bool set)
@@ -119,13 +228,13 @@ void SortedDirModel::adjustKindFilter(MimeTypeUtils::Kinds kinds, bool set)
 void SortedDirModel::addFilter(AbstractSortedDirModelFilter* filter)
 {
     d->mFilters << filter;
-    applyFilters();
+    applyFilters(FilterNarrowed);
 }
 
 void SortedDirModel::removeFilter(AbstractSortedDirModelFilter* filter)
 {
     d->mFilters.removeAll(filter);
-    applyFilters();
+    applyFilters(FilterWidened);
 }
 
 KDirLister* SortedDirModel::dirLister() const
@@ -144,6 +253,7 @@ void SortedDirModel::reload()
 void SortedDirModel::setBlackListedExtensions(const QStringList& list)
 {
     d->mBlackListedExtensions = list;
+    d->mAcceptedRows.clear();
 }
 
 KFileItem SortedDirModel::itemForIndex(const QModelIndex& index) const
@@ -190,6 +300,24 @@ QModelIndex SortedDirModel::indexForUrl(const QUrl &url) const
 }
 
 bool SortedDirModel::filterAcceptsRow(int row, const QModelIndex& parent) const
+{
+    if (!parent.isValid() && row >= d->mReleasedRowCount) {
+        return false;
+    }
+    const QModelIndex index = d->mSourceModel->index(row, 0, parent);
+    QHash<const void*, bool>::ConstIterator it = d->mAcceptedRows.constFind(index.internalPointer());
+    if (it != d->mAcceptedRows.constEnd()) {
+        return it.value();
+    }
+    bool final = true;
+    const bool accepted = computeFilterAcceptsRow(row, parent, &final);
+    if (final) {
+        d->mAcceptedRows.insert(index.internalPointer(), accepted);
+    }
+    return accepted;
+}
+
+bool SortedDirModel::computeFilterAcceptsRow(int row, const QModelIndex& parent, bool* final) const
 {
     QModelIndex index = d->mSourceModel->index(row, 0, parent);
     KFileItem fileItem = d->mSourceModel->itemForIndex(index);
@@ -215,6 +343,7 @@ bool SortedDirModel::filterAcceptsRow(int row, const QModelIndex& parent) const
                 // there.
                 if (filter->needsSemanticInfo()) {
                     d->mSourceModel->retrieveSemanticInfoForIndex(index);
+                    *final = false;
                     return false;
                 }
             }
@@ -246,36 +375,137 @@ SemanticInfo SortedDirModel::semanticInfoForSourceIndex(const QModelIndex& sourc
 }
 #endif
 
-void SortedDirModel::applyFilters()
+void SortedDirModel::applyFilters(SortedDirModel::FilterChange change)
 {
+    if (d->mDelayedApplyFiltersTimer.isActive() && d->mPendingFilterChange != change) {
+        change = FilterChanged;
+    }
+    d->mPendingFilterChange = change;
     d->mDelayedApplyFiltersTimer.start();
 }
 
 void SortedDirModel::doApplyFilters()
 {
-    QSortFilterProxyModel::invalidateFilter();
+    FilterChange change = d->mPendingFilterChange;
+    if (d->mFilterRow != -1 && d->mFilterChange != change) {
+        // Rows before mFilterRow have not been checked for the change which
+        // is being applied
+        change = FilterChanged;
+    }
+    if (d->mHasChildRows) {
+        // Let QSortFilterProxyModel filter the rows of all levels at once
+        d->mFilterChunkTimer.stop();
+        d->mFilterRow = -1;
+        d->mAcceptedRows.clear();
+        invalidateFilter();
+        return;
+    }
+    d->mFilterChange = change;
+    d->mFilterRow = 0;
+    filterNextChunk();
+}
+
+void SortedDirModel::filterNextChunk()
+{
+    if (d->mFilterRow == -1) {
+        return;
+    }
+    const int count = d->mSourceModel->rowCount();
+    const int end = qMin(count, d->mFilterRow + FILTER_CHUNK_SIZE);
+    bool changed = false;
+    for (int row = d->mFilterRow; row < end; ++row) {
+        // If the filter has been narrowed, rows which are not visible
+        // cannot become visible. If it has been widened, visible rows
+        // cannot become hidden.
+        const QModelIndex sourceIndex = d->mSourceModel->index(row, 0);
+        const bool visible = mapFromSource(sourceIndex).isValid();
+        if ((visible && d->mFilterChange != FilterWidened) || (!visible && d->mFilterChange != FilterNarrowed)) {
+            d->mAcceptedRows.remove(sourceIndex.internalPointer());
+            if (filterAcceptsRow(row, QModelIndex()) != visible) {
+                changed = true;
+            }
+        }
+    }
+    if (changed) {
+        // Rows which have not been filtered again keep their previous state,
+        // so this only adds or removes the rows which changed in this chunk
+        invalidateFilter();
+    }
+    if (end < count) {
+        d->mFilterRow = end;
+        d->mFilterChunkTimer.start();
+    } else {
+        d->mFilterRow = -1;
+    }
 }
 
 bool SortedDirModel::lessThan(const QModelIndex& left, const QModelIndex& right) const
 {
-    const KFileItem leftItem = itemForSourceIndex(left);
-    const KFileItem rightItem = itemForSourceIndex(right);
-
-    const bool leftIsDirOrArchive = ArchiveUtils::fileItemIsDirOrArchive(leftItem);
-    const bool rightIsDirOrArchive = ArchiveUtils::fileItemIsDirOrArchive(rightItem);
+    if (d->mCollator.caseSensitivity() != sortCaseSensitivity()) {
+        d->clearSortKeys();
+        d->mCollator.setCaseSensitivity(sortCaseSensitivity());
+    }
+    const FileItemSortKey* leftKey = d->sortKey(left);
+    const FileItemSortKey* rightKey = d->sortKey(right);
 
-    if (leftIsDirOrArchive != rightIsDirOrArchive) {
-        return leftIsDirOrArchive;
+    if (leftKey->isDirOrArchive() != rightKey->isDirOrArchive()) {
+        return leftKey->isDirOrArchive();
+    }
+    // Like KDirSortFilterProxyModel, keep hidden items on top whatever the
+    // sort order: the comparisons below return before it gets a chance to
+    // check it
+    if (leftKey->isHidden() != rightKey->isHidden()) {
+        return leftKey->isHidden() == (sortOrder() == Qt::AscendingOrder);
     }
 
-    if (sortColumn() != KDirModel::ModifiedTime) {
-        return KDirSortFilterProxyModel::lessThan(left, right);
+    switch (sortColumn()) {
+    case KDirModel::Name: {
+        const int result = leftKey->compareName(*rightKey);
+        if (result != 0) {
+            return result < 0;
+        }
+        // Same collation key, let KDirSortFilterProxyModel break the tie
+        break;
     }
+    case KDirModel::Size:
+        if (leftKey->isDirOrArchive()) {
+            // KDirSortFilterProxyModel sorts dirs by their child count
+            break;
+        }
+        if (leftKey->size() != rightKey->size()) {
+            return leftKey->size() < rightKey->size();
+        }
+        if (const int result = leftKey->compareName(*rightKey)) {
+            return result < 0;
+        }
+        break;
+    case KDirModel::ModifiedTime:
+        return leftKey->dateTime() < rightKey->dateTime();
+    default:
+        break;
+    }
+    return KDirSortFilterProxyModel::lessThan(left, right);
+}
+
+void SortedDirModel::slotSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight)
+{
+    d->removeCachedRows(topLeft.parent(), topLeft.row(), bottomRight.row());
+}
 
-    const QDateTime leftDate = TimeUtils::dateTimeForFileItem(leftItem);
-    const QDateTime rightDate = TimeUtils::dateTimeForFileItem(rightItem);
+void SortedDirModel::slotSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last)
+{
+    d->removeCachedRows(parent, first, last);
+}
+
+void SortedDirModel::clearCaches()
+{
+    d->clearSortKeys();
+    d->mAcceptedRows.clear();
+}
 
-    return leftDate < rightDate;
+QString SortedDirModel::foldedNameForSourceIndex(const QModelIndex& sourceIndex) const
+{
+    return d->sortKey(sourceIndex)->foldedName();
 }
 
 bool SortedDirModel::hasDocuments() const
@@ -297,6 +527,76 @@ bool SortedDirModel::hasDocuments() const
 void SortedDirModel::setDirLister(KDirLister* dirLister)
 {
     d->mSourceModel->setDirLister(dirLister);
+    connectDirLister();
+}
+
+void SortedDirModel::connectDirLister()
+{
+    // Do not keep rows pending once listing is done: views expect to find
+    // all items when the dir lister emits completed()
+    connect(dirLister(), static_cast<void (KDirLister::*)()>(&KDirLister::completed),
+            this, &SortedDirModel::releasePendingRows, Qt::UniqueConnection);
+}
+
+void SortedDirModel::slotSourceRowsAboutToBeInserted(const QModelIndex& parent, int first, int last)
+{
+    if (parent.isValid()) {
+        d->mHasChildRows = true;
+        return;
+    }
+    if (first < d->mFilterRow) {
+        // Inserted rows are filtered by QSortFilterProxyModel itself
+        d->mFilterRow += last - first + 1;
+    }
+    if (first < d->mReleasedRowCount) {
+        // Not an append, do not hold these rows
+        d->mReleasedRowCount += last - first + 1;
+        return;
+    }
+    const int pendingCount = d->mSourceModel->rowCount() + last - first + 1 - d->mReleasedRowCount;
+    if (pendingCount >= MAX_PENDING_ROWS) {
+        // Rows are not inserted yet: release them once the source model is
+        // done
+        QMetaObject::invokeMethod(this, "releasePendingRows", Qt::QueuedConnection);
+    } else if (!d->mReleaseRowsTimer.isActive()) {
+        d->mReleaseRowsTimer.start();
+    }
+}
+
+void SortedDirModel::slotSourceRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+    if (first < d->mFilterRow) {
+        d->mFilterRow -= qMin(last, d->mFilterRow - 1) - first + 1;
+    }
+    if (first >= d->mReleasedRowCount) {
+        return;
+    }
+    d->mReleasedRowCount -= qMin(last, d->mReleasedRowCount - 1) - first + 1;
+}
+
+void SortedDirModel::slotSourceModelReset()
+{
+    d->mFilterChunkTimer.stop();
+    d->mFilterRow = -1;
+    d->mHasChildRows = false;
+    d->mReleaseRowsTimer.stop();
+    d->mReleasedRowCount = 0;
+}
+
+void SortedDirModel::releasePendingRows()
+{
+    d->mReleaseRowsTimer.stop();
+    const int count = d->mSourceModel->rowCount();
+    if (count <= d->mReleasedRowCount) {
+        return;
+    }
+    d->mReleasedRowCount = count;
+    // The rows which were already there are not filtered again, see
+    // mAcceptedRows
+    invalidateFilter();
 }
 
 } //namespace
@@ -76,6 +76,16 @@ class GWENVIEWLIB_EXPORT SortedDirModel : public KDirSortFilterProxyModel
 {
     Q_OBJECT
 public:
+    /**
+     * Describes how a filter change affects the set of accepted items, so
+     * that only the rows which can be affected are filtered again.
+     */
+    enum FilterChange {
+        FilterChanged,  /**< Any row can be accepted or rejected */
+        FilterNarrowed, /**< Accepted rows can be rejected, rejected rows stay rejected */
+        FilterWidened   /**< Rejected rows can be accepted, accepted rows stay accepted */
+    };
+
     SortedDirModel(QObject* parent = 0);
     ~SortedDirModel();
     KDirLister* dirLister() const;
@@ -113,8 +123,18 @@ public:
 
     bool hasDocuments() const;
 
+    /**
+     * Returns the name of the item, case folded. Computed once per item, use
+     * it for case insensitive name matching.
+     */
+    QString foldedNameForSourceIndex(const QModelIndex& sourceIndex) const;
+
 public Q_SLOTS:
-    void applyFilters();
+    /**
+     * Filters rows again. Filtering is done in chunks from the event loop,
+     * a few milliseconds after the last call.
+     */
+    void applyFilters(Gwenview::SortedDirModel::FilterChange change = FilterChanged);
 
 protected:
     bool filterAcceptsRow(int row, const QModelIndex& parent) const Q_DECL_OVERRIDE;
@@ -122,8 +142,23 @@ protected:
 
 private Q_SLOTS:
     void doApplyFilters();
+    void filterNextChunk();
+    void releasePendingRows();
+    void slotSourceRowsAboutToBeInserted(const QModelIndex& parent, int first, int last);
+    void slotSourceRowsRemoved(const QModelIndex& parent, int first, int last);
+    void slotSourceModelReset();
+    void slotSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+    void slotSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+    void clearCaches();
 
 private:
+    void connectDirLister();
+    /**
+     * Does the actual filtering for filterAcceptsRow(), which caches the
+     * result. final is set to false if the result must not be cached.
+     */
+    bool computeFilterAcceptsRow(int row, const QModelIndex& parent, bool* final) const;
+
     friend struct SortedDirModelPrivate;
     SortedDirModelPrivate * const d;
 };
@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include <lib/gvdebug.h>
+#include <lib/slideshowscheduler.h>
 #include <gwenviewconfig.h>
 
 namespace Gwenview
@@ -52,7 +53,9 @@ namespace Gwenview
 enum State {
     Stopped,
     Started,
-    WaitForEndOfUrl
+    WaitForEndOfUrl,
+    // The display time of the next url has come, but it is not decoded yet
+    WaitForNextSlide
 };
 
 /**
@@ -79,12 +82,15 @@ private:
 struct SlideShowPrivate
 {
     QTimer* mTimer;
+    SlideShowScheduler* mScheduler;
     State mState;
     QVector<QUrl> mUrls;
     QVector<QUrl> mShuffledUrls;
     QVector<QUrl>::ConstIterator mStartIt;
     QUrl mCurrentUrl;
     QUrl mLastShuffledUrl;
+    QUrl mPendingUrl;
+    int mMissedDeadlineCount;
 
     QAction* mLoopAction;
     QAction* mRandomAction;
@@ -102,7 +108,17 @@ struct SlideShowPrivate
     {
         QVector<QUrl>::ConstIterator it = qFind(mUrls.constBegin(), mUrls.constEnd(), mCurrentUrl);
         GV_RETURN_VALUE_IF_FAIL2(it != mUrls.constEnd(), QUrl(), "Current url not found in list.");
+        it = nextOrderedIterator(it);
 
+        if (it != mUrls.constEnd()) {
+            return *it;
+        } else {
+            return QUrl();
+        }
+    }
+
+    QVector<QUrl>::ConstIterator nextOrderedIterator(QVector<QUrl>::ConstIterator it) const
+    {
         ++it;
         if (GwenviewConfig::loop()) {
             // Looping, if we reach the end, start again
@@ -116,12 +132,7 @@ struct SlideShowPrivate
                 it = mUrls.constEnd();
             }
         }
-
-        if (it != mUrls.constEnd()) {
-            return *it;
-        } else {
-            return QUrl();
-        }
+        return it;
     }
 
     void initShuffledUrls()
@@ -153,13 +164,50 @@ struct SlideShowPrivate
         return url;
     }
 
+    /**
+     * Returns the urls which are going to be shown after the current one,
+     * without consuming them
+     */
+    QList<QUrl> upcomingUrls(int count) const
+    {
+        QList<QUrl> urls;
+        if (GwenviewConfig::random()) {
+            // Urls are taken from the end of the shuffled list. Urls of the
+            // next shuffle cannot be known yet.
+            for (int pos = mShuffledUrls.count() - 1; pos >= 0 && urls.count() < count; --pos) {
+                urls << mShuffledUrls.at(pos);
+            }
+            return urls;
+        }
+        QVector<QUrl>::ConstIterator it = qFind(mUrls.constBegin(), mUrls.constEnd(), mCurrentUrl);
+        while (it != mUrls.constEnd() && urls.count() < count) {
+            it = nextOrderedIterator(it);
+            if (it == mUrls.constEnd() || *it == mCurrentUrl) {
+                break;
+            }
+            urls << *it;
+        }
+        return urls;
+    }
+
+    void updateSchedule()
+    {
+        if (mState == Stopped) {
+            return;
+        }
+        mScheduler->setUpcomingUrls(upcomingUrls(SlideShowScheduler::MAX_AHEAD_COUNT));
+    }
+
     void updateTimerInterval()
     {
-        mTimer->setInterval(int(GwenviewConfig::interval() * 1000));
+        const int interval = int(GwenviewConfig::interval() * 1000);
+        mTimer->setInterval(interval);
+        mScheduler->setInterval(interval);
     }
 
     void doStart()
     {
+        mPendingUrl.clear();
         if (MimeTypeUtils::urlKind(mCurrentUrl) == MimeTypeUtils::KIND_VIDEO) {
             LOG("mState = WaitForEndOfUrl");
             // Just in case
@@ -179,9 +227,14 @@ SlideShow::SlideShow(QObject* parent)
 {
     d->mState = Stopped;
 
+    d->mMissedDeadlineCount = 0;
+
     d->mTimer = new QTimer(this);
     connect(d->mTimer, &QTimer::timeout, this, &SlideShow::goToNextUrl);
 
+    d->mScheduler = new SlideShowScheduler(this);
+    connect(d->mScheduler, &SlideShowScheduler::slideReady, this, &SlideShow::slotSlideReady);
+
     d->mLoopAction = new QAction(this);
     d->mLoopAction->setText(i18nc("@item:inmenu toggle loop in slideshow", "Loop"));
     d->mLoopAction->setCheckable(true);
@@ -228,9 +281,11 @@ void SlideShow::start(const QList<QUrl>& urls)
         d->initShuffledUrls();
     }
 
+    d->mMissedDeadlineCount = 0;
     d->updateTimerInterval();
     d->mTimer->setSingleShot(false);
     d->doStart();
+    d->updateSchedule();
     stateChanged(true);
 }
 
@@ -245,6 +300,8 @@ void SlideShow::stop()
     LOG("Stopping timer");
     d->mTimer->stop();
     d->mState = Stopped;
+    d->mPendingUrl.clear();
+    d->mScheduler->clear();
     stateChanged(false);
 }
 
@@ -259,12 +316,42 @@ void SlideShow::resumeAndGoToNextUrl()
 void SlideShow::goToNextUrl()
 {
     LOG("");
+    if (d->mState == WaitForNextSlide) {
+        // The slide is still not decoded after waiting for a whole interval,
+        // show it anyway rather than stalling the slideshow
+        LOG("giving up waiting for" << d->mPendingUrl);
+        d->mState = Started;
+        goToUrl(d->mPendingUrl);
+        return;
+    }
     QUrl url = d->findNextUrl();
     LOG("url:" << url);
     if (!url.isValid()) {
         stop();
         return;
     }
+    if (!d->mScheduler->isReady(url)) {
+        ++d->mMissedDeadlineCount;
+        LOG("missed deadline for" << url << "total:" << d->mMissedDeadlineCount
+            << "average decode time:" << d->mScheduler->averageDecodeTime());
+        d->mPendingUrl = url;
+        d->mState = WaitForNextSlide;
+        if (!d->mTimer->isActive()) {
+            // Coming from a video
+            d->mTimer->start();
+        }
+        return;
+    }
+    goToUrl(url);
+}
+
+void SlideShow::slotSlideReady(const QUrl& url)
+{
+    if (d->mState != WaitForNextSlide || url != d->mPendingUrl) {
+        return;
+    }
+    LOG(url);
+    d->mState = Started;
     goToUrl(url);
 }
 
@@ -272,6 +359,9 @@ void SlideShow::setCurrentUrl(const QUrl &url)
 {
     LOG(url);
     if (d->mCurrentUrl == url) {
+        // In random order, the url has been taken from the shuffled list
+        // nonetheless: the upcoming urls changed
+        d->updateSchedule();
         return;
     }
     d->mCurrentUrl = url;
@@ -279,6 +369,7 @@ void SlideShow::setCurrentUrl(const QUrl &url)
     // url
     if (d->mState != Stopped) {
         d->doStart();
+        d->updateSchedule();
     }
 }
 
@@ -287,10 +378,21 @@ bool SlideShow::isRunning() const
     return d->mState != Stopped;
 }
 
+void SlideShow::setSlideSize(const QSize& size)
+{
+    d->mScheduler->setSlideSize(size);
+}
+
+int SlideShow::missedDeadlineCount() const
+{
+    return d->mMissedDeadlineCount;
+}
+
 void SlideShow::updateConfig()
 {
     GwenviewConfig::setLoop(d->mLoopAction->isChecked());
     GwenviewConfig::setRandom(d->mRandomAction->isChecked());
+    d->updateSchedule();
 }
 
 void SlideShow::slotRandomActionToggled(bool on)
@@ -298,6 +400,7 @@ void SlideShow::slotRandomActionToggled(bool on)
     if (on && d->mState != Stopped) {
         d->initShuffledUrls();
     }
+    d->updateSchedule();
 }
 
 } // namespace
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Qt
 #include <QObject>
+#include <QSize>
 
 // KDE
 #include <QUrl>
@@ -51,6 +52,18 @@ public:
     /** @return true if the slideshow is running */
     bool isRunning() const;
 
+    /**
+     * Size slides are displayed at, used to decode upcoming slides at the
+     * right resolution. Defaults to the size of the primary screen.
+     */
+    void setSlideSize(const QSize&);
+
+    /**
+     * Number of slides which were not decoded when their display time came,
+     * since the slideshow was started
+     */
+    int missedDeadlineCount() const;
+
 public Q_SLOTS:
     void setInterval(int);
     void setCurrentUrl(const QUrl &url);
@@ -71,6 +84,7 @@ private Q_SLOTS:
     void goToNextUrl();
     void updateConfig();
     void slotRandomActionToggled(bool on);
+    void slotSlideReady(const QUrl&);
 
 private:
     SlideShowPrivate* const d;
@@ -0,0 +1,281 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "slideshowscheduler.h"
+
+// Local
+#include <lib/document/document.h>
+#include <lib/document/documentfactory.h>
+#include <lib/mimetypeutils.h>
+
+// Qt
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QScreen>
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+/**
+ * Number of slides decoded ahead until decoding times have been measured
+ */
+static const int DEFAULT_AHEAD_COUNT = 2;
+
+/**
+ * Weight of the last measure in the average decoding time
+ */
+static const qreal DECODE_TIME_WEIGHT = 0.3;
+
+struct Slide
+{
+    QUrl url;
+    // Null for slides which do not need decoding, like videos
+    Document::Ptr document;
+    QElapsedTimer timer;
+    bool loadRequested;
+    bool ready;
+};
+
+struct SlideShowSchedulerPrivate
+{
+    SlideShowScheduler* q;
+    QSize mSlideSize;
+    int mInterval;
+    qreal mAverageDecodeTime;
+    // Upcoming slides, in display order
+    QList<Slide> mSlides;
+
+    qreal zoomForDocument(const Document::Ptr& doc) const
+    {
+        return qMin(
+                   mSlideSize.width() / qreal(doc->width()),
+                   mSlideSize.height() / qreal(doc->height())
+               );
+    }
+
+    /**
+     * Returns true if doc can be displayed at mSlideSize. Documents which
+     * failed to load are considered ready: there is nothing to wait for.
+     */
+    bool documentIsReady(const Document::Ptr& doc) const
+    {
+        const Document::LoadingState state = doc->loadingState();
+        if (state == Document::LoadingFailed || state == Document::Loaded) {
+            return true;
+        }
+        if (!doc->size().isValid()) {
+            return false;
+        }
+        const qreal zoom = zoomForDocument(doc);
+        if (zoom >= Document::maxDownSampledZoom()) {
+            return false;
+        }
+        return !doc->downSampledImageForZoom(zoom).isNull();
+    }
+
+    /**
+     * Starts decoding the slide once its size is known, like Preloader does
+     */
+    void requestLoad(Slide* slide)
+    {
+        const Document::Ptr& doc = slide->document;
+        if (slide->loadRequested || !doc->size().isValid()) {
+            return;
+        }
+        slide->loadRequested = true;
+        const qreal zoom = zoomForDocument(doc);
+        if (zoom < Document::maxDownSampledZoom()) {
+            LOG("loading down sampled" << slide->url << "zoom=" << zoom);
+            doc->prepareDownSampledImageForZoom(zoom);
+        } else {
+            LOG("loading full image" << slide->url);
+            doc->startLoadingFullImage();
+        }
+    }
+
+    void recordDecodeTime(qint64 time)
+    {
+        if (mAverageDecodeTime < 0) {
+            mAverageDecodeTime = time;
+        } else {
+            mAverageDecodeTime = mAverageDecodeTime * (1 - DECODE_TIME_WEIGHT) + time * DECODE_TIME_WEIGHT;
+        }
+        LOG("decode time:" << time << "average:" << mAverageDecodeTime);
+    }
+
+    Slide createSlide(const QUrl& url)
+    {
+        Slide slide;
+        slide.url = url;
+        slide.loadRequested = false;
+        slide.ready = false;
+        if (MimeTypeUtils::urlKind(url) == MimeTypeUtils::KIND_VIDEO) {
+            // Videos are streamed, not decoded ahead
+            slide.ready = true;
+            return slide;
+        }
+        slide.document = DocumentFactory::instance()->load(url);
+        Document* doc = slide.document.data();
+        QObject::connect(doc, &Document::metaInfoUpdated, q, &SlideShowScheduler::updateSlides);
+        QObject::connect(doc, &Document::downSampledImageReady, q, &SlideShowScheduler::updateSlides);
+        QObject::connect(doc, &Document::loaded, q, &SlideShowScheduler::updateSlides);
+        QObject::connect(doc, &Document::loadingFailed, q, &SlideShowScheduler::updateSlides);
+        // Slides which are already decoded do not say anything about decoding
+        // times
+        slide.ready = documentIsReady(slide.document);
+        slide.timer.start();
+        return slide;
+    }
+
+    void releaseSlide(const Slide& slide)
+    {
+        if (slide.document) {
+            // The document is not upcoming anymore, its loading must not
+            // trigger updates. Dropping the slide releases our reference to
+            // it, so that DocumentFactory can garbage collect it.
+            QObject::disconnect(slide.document.data(), 0, q, 0);
+        }
+    }
+};
+
+SlideShowScheduler::SlideShowScheduler(QObject* parent)
+: QObject(parent)
+, d(new SlideShowSchedulerPrivate)
+{
+    d->q = this;
+    d->mInterval = 0;
+    d->mAverageDecodeTime = -1;
+    QScreen* screen = QGuiApplication::primaryScreen();
+    d->mSlideSize = screen ? screen->size() : QSize(1920, 1080);
+}
+
+SlideShowScheduler::~SlideShowScheduler()
+{
+    clear();
+    delete d;
+}
+
+void SlideShowScheduler::setSlideSize(const QSize& size)
+{
+    d->mSlideSize = size;
+}
+
+void SlideShowScheduler::setInterval(int interval)
+{
+    d->mInterval = interval;
+}
+
+int SlideShowScheduler::aheadCount() const
+{
+    if (d->mAverageDecodeTime < 0 || d->mInterval <= 0) {
+        return DEFAULT_AHEAD_COUNT;
+    }
+    // Decoding a slide must start early enough to be done when the slide
+    // before it ends: one slide ahead per interval the decoding takes, plus
+    // the next one
+    const int count = int(std::ceil(d->mAverageDecodeTime / d->mInterval)) + 1;
+    return qBound(1, count, int(MAX_AHEAD_COUNT));
+}
+
+int SlideShowScheduler::averageDecodeTime() const
+{
+    return int(d->mAverageDecodeTime);
+}
+
+void SlideShowScheduler::setUpcomingUrls(const QList<QUrl>& urls)
+{
+    const QList<QUrl> wantedUrls = urls.mid(0, aheadCount());
+    QList<Slide> slides;
+    Q_FOREACH(const QUrl& url, wantedUrls) {
+        auto it = std::find_if(d->mSlides.begin(), d->mSlides.end(), [&url](const Slide& slide) {
+            return slide.url == url;
+        });
+        if (it != d->mSlides.end()) {
+            slides << *it;
+            d->mSlides.erase(it);
+        } else {
+            slides << d->createSlide(url);
+        }
+    }
+    Q_FOREACH(const Slide& slide, d->mSlides) {
+        d->releaseSlide(slide);
+    }
+    d->mSlides = slides;
+    updateSlides();
+}
+
+void SlideShowScheduler::clear()
+{
+    Q_FOREACH(const Slide& slide, d->mSlides) {
+        d->releaseSlide(slide);
+    }
+    d->mSlides.clear();
+}
+
+bool SlideShowScheduler::isReady(const QUrl& url) const
+{
+    Q_FOREACH(const Slide& slide, d->mSlides) {
+        if (slide.url == url) {
+            return slide.ready;
+        }
+    }
+    if (MimeTypeUtils::urlKind(url) == MimeTypeUtils::KIND_VIDEO) {
+        return true;
+    }
+    Document::Ptr doc = DocumentFactory::instance()->getCachedDocument(url);
+    return doc && d->documentIsReady(doc);
+}
+
+void SlideShowScheduler::updateSlides()
+{
+    QList<QUrl> readyUrls;
+    for (int i = 0; i < d->mSlides.count(); ++i) {
+        Slide& slide = d->mSlides[i];
+        if (slide.ready) {
+            continue;
+        }
+        d->requestLoad(&slide);
+        if (d->documentIsReady(slide.document)) {
+            slide.ready = true;
+            d->recordDecodeTime(slide.timer.elapsed());
+            readyUrls << slide.url;
+        }
+    }
+    Q_FOREACH(const QUrl& url, readyUrls) {
+        emit slideReady(url);
+    }
+}
+
+} // namespace
@@ -0,0 +1,114 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef SLIDESHOWSCHEDULER_H
+#define SLIDESHOWSCHEDULER_H
+
+// Local
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QUrl>
+
+namespace Gwenview
+{
+
+struct SlideShowSchedulerPrivate;
+/**
+ * Decodes the upcoming slides of a slideshow ahead of time.
+ *
+ * The scheduler keeps a small ring of documents for the next urls of the
+ * slideshow and loads them at the resolution needed to fit the slide size,
+ * so that each slide is ready when its display time comes. The number of
+ * slides decoded ahead depends on the measured decoding time and on the
+ * slideshow interval: slow images are started several intervals before
+ * their deadline.
+ */
+class GWENVIEWLIB_EXPORT SlideShowScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Maximum number of slides decoded ahead
+     */
+    static const int MAX_AHEAD_COUNT = 4;
+
+    SlideShowScheduler(QObject* parent = 0);
+    ~SlideShowScheduler();
+
+    /**
+     * Size slides are displayed at. Defaults to the size of the primary
+     * screen.
+     */
+    void setSlideSize(const QSize&);
+
+    /**
+     * Time, in milliseconds, each slide is displayed
+     */
+    void setInterval(int);
+
+    /**
+     * Sets the urls which are going to be displayed, in order. The first
+     * aheadCount() ones are loaded, the documents of the other urls are
+     * released.
+     */
+    void setUpcomingUrls(const QList<QUrl>& urls);
+
+    /**
+     * Releases all documents
+     */
+    void clear();
+
+    /**
+     * Returns true if url can be displayed at the slide size without waiting
+     * for it to be decoded
+     */
+    bool isReady(const QUrl& url) const;
+
+    /**
+     * Number of slides currently decoded ahead
+     */
+    int aheadCount() const;
+
+    /**
+     * Average time, in milliseconds, between the request to load a slide and
+     * the slide being ready. Returns -1 until a slide has been decoded.
+     */
+    int averageDecodeTime() const;
+
+Q_SIGNALS:
+    /**
+     * Emitted when the slide for url becomes ready
+     */
+    void slideReady(const QUrl& url);
+
+private Q_SLOTS:
+    void updateSlides();
+
+private:
+    SlideShowSchedulerPrivate* const d;
+};
+
+} // namespace
+
+#endif /* SLIDESHOWSCHEDULER_H */
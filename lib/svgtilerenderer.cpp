@@ -0,0 +1,253 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "svgtilerenderer.h"
+
+// Local
+#include <lib/gvdebug.h>
+
+// Qt
+#include <QCache>
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QPainter>
+#include <QRunnable>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSvgRenderer>
+#include <QThread>
+#include <QThreadPool>
+
+namespace Gwenview
+{
+
+/**
+ * Maximum amount of memory used by cached tiles, in KB
+ */
+static const int MAX_CACHE_COST = 128 * 1024;
+
+struct SvgTileKey
+{
+    qreal zoom;
+    int col;
+    int row;
+
+    bool operator==(const SvgTileKey& other) const
+    {
+        return zoom == other.zoom && col == other.col && row == other.row;
+    }
+};
+
+inline uint qHash(const SvgTileKey& key, uint seed = 0)
+{
+    return qHash(key.zoom, seed) ^ qHash(key.col, seed) ^ (qHash(key.row, seed) << 16);
+}
+
+/**
+ * State shared with the rendering tasks. A new context is created each time
+ * setData() is called.
+ */
+struct SvgRenderContext
+{
+    int mGeneration;
+    QByteArray mData;
+    QSizeF mDefaultSize;
+
+    QMutex mMutex;
+    qreal mCurrentZoom;
+    // Parsing a document is expensive, so renderers are reused by the tasks
+    QList<QSvgRenderer*> mFreeRenderers;
+
+    ~SvgRenderContext()
+    {
+        qDeleteAll(mFreeRenderers);
+    }
+
+    bool isWanted(qreal zoom)
+    {
+        QMutexLocker locker(&mMutex);
+        return zoom == mCurrentZoom;
+    }
+
+    QSvgRenderer* takeRenderer()
+    {
+        {
+            QMutexLocker locker(&mMutex);
+            if (!mFreeRenderers.isEmpty()) {
+                return mFreeRenderers.takeLast();
+            }
+        }
+        QSvgRenderer* renderer = new QSvgRenderer(mData);
+        // The renderer is going to be used by other threads
+        renderer->moveToThread(0);
+        return renderer;
+    }
+
+    void releaseRenderer(QSvgRenderer* renderer)
+    {
+        QMutexLocker locker(&mMutex);
+        mFreeRenderers << renderer;
+    }
+};
+
+typedef QSharedPointer<SvgRenderContext> SvgRenderContextPtr;
+
+class SvgTileTask : public QRunnable
+{
+public:
+    SvgTileTask(SvgTileRenderer* tileRenderer, const SvgRenderContextPtr& context, qreal zoom, int col, int row)
+    : mTileRenderer(tileRenderer)
+    , mContext(context)
+    , mZoom(zoom)
+    , mCol(col)
+    , mRow(row)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        if (!mContext->isWanted(mZoom)) {
+            return;
+        }
+        const QSizeF zoomedSize = mContext->mDefaultSize * mZoom;
+        const QRect zoomedRect(QPoint(0, 0), zoomedSize.toSize() + QSize(1, 1));
+        const int tileSize = SvgTileRenderer::TILE_SIZE;
+        const QRect rect = QRect(mCol * tileSize, mRow * tileSize, tileSize, tileSize) & zoomedRect;
+
+        QSvgRenderer* renderer = mContext->takeRenderer();
+        QImage image = SvgTileRenderer::renderImage(renderer, zoomedSize, rect);
+        mContext->releaseRenderer(renderer);
+
+        QMetaObject::invokeMethod(mTileRenderer, "slotTileRendered", Qt::QueuedConnection,
+                                  Q_ARG(int, mContext->mGeneration),
+                                  Q_ARG(qreal, mZoom),
+                                  Q_ARG(int, mCol),
+                                  Q_ARG(int, mRow),
+                                  Q_ARG(QImage, image));
+    }
+
+private:
+    SvgTileRenderer* mTileRenderer;
+    SvgRenderContextPtr mContext;
+    qreal mZoom;
+    int mCol;
+    int mRow;
+};
+
+struct SvgTileRendererPrivate
+{
+    QThreadPool mPool;
+    SvgRenderContextPtr mContext;
+    int mGeneration;
+    QCache<SvgTileKey, QPixmap> mTiles;
+    QSet<SvgTileKey> mPendingTiles;
+};
+
+SvgTileRenderer::SvgTileRenderer(QObject* parent)
+: QObject(parent)
+, d(new SvgTileRendererPrivate)
+{
+    d->mGeneration = 0;
+    d->mTiles.setMaxCost(MAX_CACHE_COST);
+    d->mPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+SvgTileRenderer::~SvgTileRenderer()
+{
+    d->mPool.clear();
+    d->mPool.waitForDone();
+    delete d;
+}
+
+void SvgTileRenderer::setData(const QByteArray& data, const QSize& defaultSize)
+{
+    d->mPool.clear();
+    d->mTiles.clear();
+    d->mPendingTiles.clear();
+    ++d->mGeneration;
+    d->mContext = SvgRenderContextPtr(new SvgRenderContext);
+    d->mContext->mGeneration = d->mGeneration;
+    d->mContext->mData = data;
+    d->mContext->mDefaultSize = defaultSize;
+    d->mContext->mCurrentZoom = 0;
+}
+
+void SvgTileRenderer::setCurrentZoom(qreal zoom)
+{
+    GV_RETURN_IF_FAIL(d->mContext);
+    {
+        QMutexLocker locker(&d->mContext->mMutex);
+        if (d->mContext->mCurrentZoom == zoom) {
+            return;
+        }
+        d->mContext->mCurrentZoom = zoom;
+    }
+    // Tasks for the other zooms will do nothing, forget about them
+    d->mPool.clear();
+    d->mPendingTiles.clear();
+}
+
+QPixmap SvgTileRenderer::cachedTile(qreal zoom, int col, int row) const
+{
+    const QPixmap* pix = d->mTiles.object({zoom, col, row});
+    return pix ? *pix : QPixmap();
+}
+
+QPixmap SvgTileRenderer::tile(qreal zoom, int col, int row)
+{
+    GV_RETURN_VALUE_IF_FAIL(d->mContext, QPixmap());
+    const SvgTileKey key = {zoom, col, row};
+    const QPixmap* pix = d->mTiles.object(key);
+    if (pix) {
+        return *pix;
+    }
+    if (!d->mPendingTiles.contains(key)) {
+        d->mPendingTiles << key;
+        d->mPool.start(new SvgTileTask(this, d->mContext, zoom, col, row));
+    }
+    return QPixmap();
+}
+
+void SvgTileRenderer::slotTileRendered(int generation, qreal zoom, int col, int row, const QImage& image)
+{
+    if (generation != d->mGeneration) {
+        return;
+    }
+    const SvgTileKey key = {zoom, col, row};
+    d->mPendingTiles.remove(key);
+    // QPixmap can only be created in the GUI thread
+    QPixmap* pix = new QPixmap(QPixmap::fromImage(image));
+    d->mTiles.insert(key, pix, qMax(1, image.byteCount() / 1024));
+    emit tileReady(zoom, col, row);
+}
+
+QImage SvgTileRenderer::renderImage(QSvgRenderer* renderer, const QSizeF& zoomedSize, const QRect& rect)
+{
+    QImage image(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    // Render the whole document at zoomedSize, shifted so that rect ends up
+    // in the image. Parts outside of the image are clipped.
+    renderer->render(&painter, QRectF(-rect.topLeft(), zoomedSize));
+    return image;
+}
+
+} // namespace
@@ -0,0 +1,96 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef SVGTILERENDERER_H
+#define SVGTILERENDERER_H
+
+// Local
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+
+class QSvgRenderer;
+
+namespace Gwenview
+{
+
+struct SvgTileRendererPrivate;
+/**
+ * Renders an SVG document as a grid of TILE_SIZE x TILE_SIZE tiles, for a
+ * given zoom. Tiles are rendered on worker threads and cached, so that
+ * painting a view only needs to draw pixmaps.
+ */
+class GWENVIEWLIB_EXPORT SvgTileRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    static const int TILE_SIZE = 256;
+
+    SvgTileRenderer(QObject* parent = 0);
+    ~SvgTileRenderer();
+
+    /**
+     * Sets the SVG document to render. Drops cached tiles and pending
+     * requests.
+     */
+    void setData(const QByteArray& data, const QSize& defaultSize);
+
+    /**
+     * Returns the tile at col, row for zoom. If it has not been rendered
+     * yet, returns a null pixmap, queues the tile for rendering and emits
+     * tileReady() once it is available.
+     */
+    QPixmap tile(qreal zoom, int col, int row);
+
+    /**
+     * Returns the tile at col, row for zoom if it is in the cache, without
+     * requesting it.
+     */
+    QPixmap cachedTile(qreal zoom, int col, int row) const;
+
+    /**
+     * Tells the renderer which zoom is currently shown: queued requests for
+     * other zooms are dropped.
+     */
+    void setCurrentZoom(qreal zoom);
+
+    /**
+     * Renders the rect part of the document scaled to zoomedSize. Can be
+     * called from any thread, as long as renderer is not used by another
+     * thread at the same time.
+     */
+    static QImage renderImage(QSvgRenderer* renderer, const QSizeF& zoomedSize, const QRect& rect);
+
+Q_SIGNALS:
+    void tileReady(qreal zoom, int col, int row);
+
+private Q_SLOTS:
+    void slotTileRendered(int generation, qreal zoom, int col, int row, const QImage& image);
+
+private:
+    SvgTileRendererPrivate* const d;
+};
+
+} // namespace
+
+#endif /* SVGTILERENDERER_H */
@@ -26,6 +26,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "jpegcontent.h"
 #include "gwenviewconfig.h"
 #include "exiv2imageloader.h"
+#include "cms/cmsprofile.h"
+#include "cms/cmstransform.h"
+#include "svgtilerenderer.h"
 
 // KDE
 #include <QDebug>
@@ -35,8 +38,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Qt
 #include <QImageReader>
-#include <QMatrix>
+#include <QSvgRenderer>
 #include <QBuffer>
+#include <QFile>
 
 namespace Gwenview
 {
@@ -52,6 +56,37 @@ namespace Gwenview
 
 const int MIN_PREV_SIZE = 1000;
 
+/**
+ * Thumbnails are stored in sRGB, as required by the thumbnail specification.
+ * If data contains a color profile, convert image to sRGB.
+ */
+static void convertToSRgb(QImage* image, const QByteArray& data, const QByteArray& format)
+{
+    if (data.isEmpty() || image->isNull()) {
+        return;
+    }
+    Cms::Profile::Ptr profile = Cms::Profile::loadFromImageData(data, format);
+    if (!profile) {
+        // Like RasterImageView, assume images without profile are sRGB
+        return;
+    }
+    QImage::Format imageFormat = image->format();
+    if (imageFormat != QImage::Format_RGB32 && imageFormat != QImage::Format_ARGB32
+        && imageFormat != QImage::Format_Grayscale8) {
+        imageFormat = image->hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+    }
+    // Transforms are cached, so generating thumbnails for a folder full of
+    // images sharing the same profile only creates one transform
+    Cms::Transform::Ptr transform = Cms::Transform::sRgbTransform(profile, imageFormat);
+    if (!transform) {
+        return;
+    }
+    if (image->format() != imageFormat) {
+        *image = image->convertToFormat(imageFormat);
+    }
+    transform->apply(image->bits(), image->width(), image->height(), image->bytesPerLine());
+}
+
 //------------------------------------------------------------------------
 //
 // ThumbnailContext
@@ -66,6 +101,9 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
     QSize originalSize;
 
     QByteArray formatHint = pixPath.section('.', -1).toLocal8Bit().toLower();
+    if (formatHint == "svg" || formatHint == "svgz") {
+        return loadSvg(pixPath, pixelSize);
+    }
     QImageReader reader(pixPath);
 
     JpegContent content;
@@ -112,8 +150,22 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
             reader.setFileName(pixPath);
         }
 
-        if (reader.format() == "jpeg" && GwenviewConfig::applyExifOrientation()) {
-            content.load(pixPath);
+        const QByteArray readerFormat = reader.format();
+        if (readerFormat == "jpeg" || readerFormat == "png") {
+            // Read the file only once: its content is needed to extract the
+            // color profile, and by JpegContent
+            QFile file(pixPath);
+            if (file.open(QIODevice::ReadOnly)) {
+                data = file.readAll();
+                buffer.setBuffer(&data);
+                buffer.open(QIODevice::ReadOnly);
+                reader.setDevice(&buffer);
+                reader.setFormat(readerFormat);
+            }
+        }
+
+        if (readerFormat == "jpeg" && !data.isEmpty() && GwenviewConfig::applyExifOrientation()) {
+            content.loadFromData(data);
         }
     }
 
@@ -127,9 +179,9 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
 
         if (qMax(thumbnail.width(), thumbnail.height()) >= pixelSize) {
             mImage = thumbnail;
+            convertToSRgb(&mImage, content.rawData(), "jpeg");
             if (orientation != NORMAL && orientation != NOT_AVAILABLE) {
-                QMatrix matrix = ImageUtils::transformMatrix(orientation);
-                mImage = mImage.transformed(matrix);
+                mImage = ImageUtils::transformed(std::move(mImage), orientation);
             }
             mOriginalWidth = content.size().width();
             mOriginalHeight = content.size().height();
@@ -168,10 +220,12 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
         mImage = originalImage.scaled(pixelSize, pixelSize, Qt::KeepAspectRatio);
     }
 
+    // Raw previews are JPEG images, loaded in content
+    convertToSRgb(&mImage, data, content.rawData().isEmpty() ? format : QByteArray("jpeg"));
+
     // Rotate if necessary
     if (orientation != NORMAL && orientation != NOT_AVAILABLE && GwenviewConfig::applyExifOrientation()) {
-        QMatrix matrix = ImageUtils::transformMatrix(orientation);
-        mImage = mImage.transformed(matrix);
+        mImage = ImageUtils::transformed(std::move(mImage), orientation);
 
         switch (orientation) {
         case TRANSPOSE:
@@ -187,6 +241,29 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
     return true;
 }
 
+bool ThumbnailContext::loadSvg(const QString &pixPath, int pixelSize)
+{
+    // Render the document straight at the thumbnail size, using the same
+    // code as the view tiles
+    QSvgRenderer renderer(pixPath);
+    if (!renderer.isValid()) {
+        return false;
+    }
+    const QSize defaultSize = renderer.defaultSize();
+    if (defaultSize.isEmpty()) {
+        return false;
+    }
+    QSizeF scaledSize = defaultSize;
+    if (qMax(defaultSize.width(), defaultSize.height()) > pixelSize) {
+        scaledSize.scale(pixelSize, pixelSize, Qt::KeepAspectRatio);
+    }
+    mImage = SvgTileRenderer::renderImage(&renderer, scaledSize, QRect(QPoint(0, 0), scaledSize.toSize()));
+    mOriginalWidth = defaultSize.width();
+    mOriginalHeight = defaultSize.height();
+    mNeedCaching = true;
+    return true;
+}
+
 //------------------------------------------------------------------------
 //
 // ThumbnailGenerator
@@ -43,6 +43,7 @@ struct ThumbnailContext {
     bool mNeedCaching;
 
     bool load(const QString &pixPath, int pixelSize);
+    bool loadSvg(const QString &pixPath, int pixelSize);
 };
 
 class ThumbnailGenerator : public QThread
@@ -464,7 +464,11 @@ void ThumbnailProvider::checkThumbnail()
     }
 
     // Thumbnail not found or not valid
-    if (MimeTypeUtils::fileItemKind(mCurrentItem) == MimeTypeUtils::KIND_RASTER_IMAGE) {
+    const MimeTypeUtils::Kind kind = MimeTypeUtils::fileItemKind(mCurrentItem);
+    if (kind == MimeTypeUtils::KIND_SVG_IMAGE && mCurrentUrl.isLocalFile()) {
+        // Rendered by the generator thread, like raster images
+        startCreatingThumbnail(mCurrentUrl.toLocalFile());
+    } else if (kind == MimeTypeUtils::KIND_RASTER_IMAGE) {
         if (mCurrentUrl.isLocalFile()) {
             // Original is a local file, create the thumbnail
             startCreatingThumbnail(mCurrentUrl.toLocalFile());
@@ -0,0 +1,136 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QImageReader>
+
+#include "../lib/document/animatedframedecoder.h"
+
+#include "animatedframedecodertest.h"
+#include "testutils.h"
+
+QTEST_MAIN(AnimatedFrameDecoderTest)
+
+using namespace Gwenview;
+
+/**
+ * The frames and delays of an animation, as read by QImageReader
+ */
+struct Animation
+{
+    QList<QImage> images;
+    QList<int> delays;
+    int loopCount;
+    qint64 byteCount;
+};
+
+static Animation readAnimation(const QString& path)
+{
+    Animation animation;
+    animation.byteCount = 0;
+    QImageReader reader(path);
+    animation.loopCount = reader.loopCount();
+    QImage image;
+    while (reader.read(&image)) {
+        animation.images << image;
+        animation.delays << reader.nextImageDelay();
+        animation.byteCount += image.byteCount();
+    }
+    return animation;
+}
+
+static QByteArray readFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+/**
+ * Waits until frame number has been decoded, then takes it
+ */
+static bool waitForFrame(AnimatedFrameDecoder* decoder, int number, AnimatedFrame* frame)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!decoder->takeFrame(number, frame)) {
+        if (timer.elapsed() > 5000) {
+            return false;
+        }
+        QTest::qWait(10);
+    }
+    return true;
+}
+
+void AnimatedFrameDecoderTest::testKeepAllFrames()
+{
+    const QString path = pathForTestFile("4frames.gif");
+    const Animation animation = readAnimation(path);
+    QCOMPARE(animation.images.count(), 4);
+
+    AnimatedFrameDecoder decoder(readFile(path));
+    decoder.start();
+    QTRY_COMPARE(decoder.frameCount(), 4);
+    QCOMPARE(decoder.loopCount(), animation.loopCount);
+    // Only the frames remain, the decoding buffers have been released
+    QCOMPARE(decoder.memoryUsage(), animation.byteCount);
+
+    // Kept frames are still there on the next loop
+    for (int loop = 0; loop < 2; ++loop) {
+        for (int number = 0; number < 4; ++number) {
+            AnimatedFrame frame;
+            QVERIFY(decoder.takeFrame(number, &frame));
+            QCOMPARE(frame.image, animation.images.at(number));
+            QCOMPARE(frame.delay, animation.delays.at(number));
+        }
+        QCOMPARE(decoder.memoryUsage(), animation.byteCount);
+    }
+}
+
+void AnimatedFrameDecoderTest::testStreamFrames()
+{
+    const QString path = pathForTestFile("4frames.gif");
+    const Animation animation = readAnimation(path);
+    QCOMPARE(animation.images.count(), 4);
+    const qint64 frameBytes = animation.images.first().byteCount();
+
+    // Only one frame fits: frames are decoded a few at a time and dropped
+    // once they have been taken
+    AnimatedFrameDecoder decoder(readFile(path));
+    decoder.setMemoryBudget(frameBytes);
+    decoder.start();
+    for (int loop = 0; loop < 2; ++loop) {
+        for (int number = 0; number < 4; ++number) {
+            AnimatedFrame frame;
+            QVERIFY(waitForFrame(&decoder, number, &frame));
+            QCOMPARE(frame.image, animation.images.at(number));
+            QCOMPARE(frame.delay, animation.delays.at(number));
+            // At most two frames ahead, plus the decoding canvas
+            QVERIFY(decoder.memoryUsage() <= 3 * frameBytes);
+        }
+    }
+    QCOMPARE(decoder.frameCount(), 4);
+    QCOMPARE(decoder.loopCount(), animation.loopCount);
+}
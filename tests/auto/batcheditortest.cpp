@@ -0,0 +1,201 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <QFile>
+#include <QImage>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "../lib/batcheditor.h"
+#include "../lib/imageutils.h"
+#include "../lib/jpegcontent.h"
+#include "testutils.h"
+
+#include "batcheditortest.h"
+
+QTEST_MAIN(BatchEditorTest)
+
+using namespace Gwenview;
+
+static QUrl copyTestFile(const QTemporaryDir& dir, const QString& name)
+{
+    const QString path = dir.path() + '/' + name;
+    QFile::copy(pathForTestFile(name), path);
+    QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner);
+    return QUrl::fromLocalFile(path);
+}
+
+static void runEditor(BatchEditor* editor, const QList<QUrl>& urls)
+{
+    QSignalSpy spy(editor, SIGNAL(finished()));
+    editor->start(urls);
+    QVERIFY(editor->isRunning());
+    QVERIFY(spy.wait(30000));
+    QVERIFY(!editor->isRunning());
+}
+
+void BatchEditorTest::testTransform()
+{
+    QTemporaryDir dir;
+    const QUrl url = copyTestFile(dir, "test.png");
+    const QImage original(pathForTestFile("test.png"));
+
+    BatchEditor editor;
+    editor.setTransformation(ROT_90);
+    QSignalSpy failedSpy(&editor, SIGNAL(failed(QUrl,QString)));
+    QSignalSpy progressSpy(&editor, SIGNAL(progressChanged(int,int)));
+    runEditor(&editor, QList<QUrl>() << url);
+
+    QCOMPARE(failedSpy.count(), 0);
+    QCOMPARE(progressSpy.count(), 1);
+    QCOMPARE(editor.processedCount(), 1);
+    QCOMPARE(editor.totalCount(), 1);
+
+    const QImage expected = ImageUtils::transformed(original, ROT_90).convertToFormat(QImage::Format_ARGB32);
+    const QImage result = QImage(url.toLocalFile()).convertToFormat(QImage::Format_ARGB32);
+    QCOMPARE(result, expected);
+}
+
+void BatchEditorTest::testLosslessJpegTransform()
+{
+    QTemporaryDir dir;
+    const QUrl url = copyTestFile(dir, "orient6.jpg");
+    JpegContent original;
+    QVERIFY(original.load(pathForTestFile("orient6.jpg")));
+
+    BatchEditor editor;
+    editor.setTransformation(ROT_90);
+    runEditor(&editor, QList<QUrl>() << url);
+    QCOMPARE(editor.processedCount(), 1);
+
+    // The Exif orientation (ROT_90) has been applied to the pixels, followed
+    // by another ROT_90: the image is upside down, with a normal orientation
+    JpegContent content;
+    QVERIFY(content.load(url.toLocalFile()));
+    QCOMPARE(content.orientation(), NORMAL);
+    QCOMPARE(content.size(), original.size().transposed());
+}
+
+void BatchEditorTest::testScale()
+{
+    QTemporaryDir dir;
+    const QUrl pngUrl = copyTestFile(dir, "test.png");
+    const QUrl jpegUrl = copyTestFile(dir, "orient6.jpg");
+    const QSize pngSize = QImage(pathForTestFile("test.png")).size();
+    JpegContent original;
+    QVERIFY(original.load(pathForTestFile("orient6.jpg")));
+
+    BatchEditor editor;
+    editor.setScaleFactor(0.5);
+    QSignalSpy failedSpy(&editor, SIGNAL(failed(QUrl,QString)));
+    runEditor(&editor, QList<QUrl>() << pngUrl << jpegUrl);
+    QCOMPARE(failedSpy.count(), 0);
+    QCOMPARE(editor.processedCount(), 2);
+
+    QCOMPARE(QImage(pngUrl.toLocalFile()).size(), pngSize / 2);
+
+    JpegContent content;
+    QVERIFY(content.load(jpegUrl.toLocalFile()));
+    QCOMPARE(content.orientation(), NORMAL);
+    QCOMPARE(content.size(), original.size() / 2);
+}
+
+void BatchEditorTest::testInvalidFile()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/notanimage.png";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("This is not an image");
+    file.close();
+    const QUrl url = QUrl::fromLocalFile(path);
+    const QUrl remoteUrl("http://example.com/remote.png");
+
+    BatchEditor editor;
+    editor.setTransformation(HFLIP);
+    QSignalSpy failedSpy(&editor, SIGNAL(failed(QUrl,QString)));
+    runEditor(&editor, QList<QUrl>() << url << remoteUrl);
+
+    QCOMPARE(editor.processedCount(), 2);
+    QCOMPARE(failedSpy.count(), 2);
+    QList<QUrl> failedUrls;
+    failedUrls << failedSpy.at(0).at(0).toUrl() << failedSpy.at(1).at(0).toUrl();
+    QVERIFY(failedUrls.contains(url));
+    QVERIFY(failedUrls.contains(remoteUrl));
+}
+
+/**
+ * A budget smaller than any image must not block: images are then processed
+ * one at a time
+ */
+void BatchEditorTest::testMemoryBudget()
+{
+    QTemporaryDir dir;
+    QList<QUrl> urls;
+    for (int i = 0; i < 4; ++i) {
+        const QString name = QString("test%1.png").arg(i);
+        const QString path = dir.path() + '/' + name;
+        QVERIFY(QFile::copy(pathForTestFile("test.png"), path));
+        QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner);
+        urls << QUrl::fromLocalFile(path);
+    }
+
+    BatchEditor editor;
+    editor.setTransformation(VFLIP);
+    editor.setMemoryBudget(1);
+    QSignalSpy failedSpy(&editor, SIGNAL(failed(QUrl,QString)));
+    runEditor(&editor, urls);
+    QCOMPARE(failedSpy.count(), 0);
+    QCOMPARE(editor.processedCount(), 4);
+    QVERIFY(editor.throughput() > 0);
+}
+
+/**
+ * Destroying a running editor must not wait for its workers, nor let them
+ * report to the destroyed editor
+ */
+void BatchEditorTest::testDestroyWhileRunning()
+{
+    QTemporaryDir dir;
+    QList<QUrl> urls;
+    for (int i = 0; i < 16; ++i) {
+        const QString name = QString("test%1.png").arg(i);
+        const QString path = dir.path() + '/' + name;
+        QVERIFY(QFile::copy(pathForTestFile("test.png"), path));
+        QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner);
+        urls << QUrl::fromLocalFile(path);
+    }
+
+    BatchEditor* editor = new BatchEditor;
+    editor->setTransformation(ROT_90);
+    editor->start(urls);
+    delete editor;
+    // Let the workers finish the files they were writing
+    QTest::qWait(1000);
+
+    // Each file is either untouched or fully transformed
+    const QImage original(pathForTestFile("test.png"));
+    Q_FOREACH(const QUrl& url, urls) {
+        const QImage image(url.toLocalFile());
+        QVERIFY(!image.isNull());
+        QVERIFY(image.size() == original.size() || image.size() == original.size().transposed());
+    }
+}
@@ -19,8 +19,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 // Qt
 #include <QConicalGradient>
+#include <QFile>
 #include <QImage>
 #include <QPainter>
+#include <QUndoStack>
 
 // KDE
 #include <QDebug>
@@ -34,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "../lib/document/abstractdocumenteditor.h"
 #include "../lib/document/documentjob.h"
 #include "../lib/document/documentfactory.h"
+#include "../lib/document/savescheduler.h"
 #include "../lib/imagemetainfomodel.h"
 #include "../lib/imageutils.h"
 #include "../lib/transformimageoperation.h"
@@ -230,7 +233,8 @@ void DocumentTest::testLoadDownSampled()
     QImage downSampledImage = doc->downSampledImageForZoom(0.2);
     QVERIFY2(!downSampledImage.isNull(), "Down sampled image should not be null");
 
-    QSize expectedSize = doc->size() / 2;
+    // Down sampled images are not rotated, see Document::imageOrientation()
+    QSize expectedSize = ImageUtils::transformedSize(doc->size(), doc->imageOrientation()) / 2;
     if (expectedSize.isEmpty()) {
         expectedSize = image.size();
     }
@@ -365,12 +369,17 @@ void DocumentTest::testLoadRotated()
     bool ok = image.load(url.toLocalFile());
     QVERIFY2(ok, "Could not load 'orient6.jpg'");
     QMatrix matrix = ImageUtils::transformMatrix(ROT_90);
-    image = image.transformed(matrix);
 
     Document::Ptr doc = DocumentFactory::instance()->load(url);
     doc->startLoadingFullImage();
     doc->waitUntilLoaded();
+    // The orientation is only applied to the pixels when image() is called
+    QCOMPARE(doc->imageOrientation(), ROT_90);
+    QCOMPARE(image, doc->unorientedImage());
+
+    image = image.transformed(matrix);
     QCOMPARE(image, doc->image());
+    QCOMPARE(doc->imageOrientation(), NORMAL);
 
     // RAW preview on rotated image
     url = urlForTestFile("dsd_1838.nef");
@@ -503,6 +512,30 @@ void DocumentTest::testLosslessRotate()
     QCOMPARE(image1, image2);
 }
 
+/**
+ * The crop rect is expressed in the coordinates of the displayed image: it
+ * must not be applied as is to the JPEG data of an image with an Exif
+ * orientation
+ */
+void DocumentTest::testCropRotated()
+{
+    Document::Ptr doc = DocumentFactory::instance()->load(urlForTestFile("orient6.jpg"));
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+    QVERIFY(doc->editor());
+
+    const QRect rect(16, 32, 64, 96);
+    const QImage expected = doc->image().copy(rect);
+    doc->editor()->crop(rect, expected);
+
+    const QUrl url = urlForTestOutputFile("cropped.jpg");
+    QVERIFY(waitUntilJobIsDone(doc->save(url, "jpeg")));
+
+    QImage result;
+    QVERIFY(result.load(url.toLocalFile()));
+    QVERIFY(fuzzyImageCompare(result, expected, 32));
+}
+
 void DocumentTest::testModifyAndSaveAs()
 {
     QVariantList args;
@@ -564,6 +597,47 @@ void DocumentTest::testModifyAndSaveAs()
     QVERIFY(modifiedUrls.contains(destUrl));
 }
 
+void DocumentTest::testSaveScheduler()
+{
+    const QSize originalSize = QImage(pathForTestFile("test.png")).size();
+    QList<QUrl> urls;
+    QList<Document::Ptr> docs;
+    for (int i = 0; i < 3; ++i) {
+        const QUrl url = urlForTestOutputFile(QString("scheduler%1.png").arg(i));
+        QFile::remove(url.toLocalFile());
+        QVERIFY(QFile::copy(pathForTestFile("test.png"), url.toLocalFile()));
+        QFile::setPermissions(url.toLocalFile(), QFile::ReadOwner | QFile::WriteOwner);
+        Document::Ptr doc = DocumentFactory::instance()->load(url);
+        doc->startLoadingFullImage();
+        doc->waitUntilLoaded();
+        TransformImageOperation* op = new TransformImageOperation(ROT_90);
+        op->applyToDocument(doc);
+        QVERIFY(doc->isModified());
+        urls << url;
+        docs << doc;
+    }
+
+    SaveScheduler scheduler;
+    QSignalSpy finishedSpy(&scheduler, SIGNAL(finished()));
+    QSignalSpy failedSpy(&scheduler, SIGNAL(failed(QUrl,QString)));
+    QSignalSpy progressSpy(&scheduler, SIGNAL(progressChanged()));
+    scheduler.start(urls);
+    QVERIFY(finishedSpy.wait(30000));
+
+    QCOMPARE(failedSpy.count(), 0);
+    QCOMPARE(progressSpy.count(), 3);
+    QCOMPARE(scheduler.savedCount(), 3);
+    QCOMPARE(scheduler.totalCount(), 3);
+    QCOMPARE(scheduler.percent(), 100);
+    Q_FOREACH(const Document::Ptr& doc, docs) {
+        QVERIFY(!doc->isModified());
+        // Undo data is released once saved
+        QCOMPARE(doc->undoStack()->count(), 0);
+        QCOMPARE(QImage(doc->url().toLocalFile()).size(), originalSize.transposed());
+    }
+    QVERIFY(DocumentFactory::instance()->modifiedDocumentList().isEmpty());
+}
+
 void DocumentTest::testMetaInfoJpeg()
 {
     QUrl url = urlForTestFile("orient6.jpg");
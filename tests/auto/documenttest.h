@@ -121,7 +121,9 @@ private Q_SLOTS:
     void testSaveRemote();
     void testLosslessSave();
     void testLosslessRotate();
+    void testCropRotated();
     void testModifyAndSaveAs();
+    void testSaveScheduler();
     void testMetaInfoJpeg();
     void testMetaInfoBmp();
     void testForgetModifiedDocument();
@@ -0,0 +1,105 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QImage>
+
+#include <limits>
+
+#include "../lib/imageformats/fitsformat/fitsdata.h"
+
+#include "fitsdatatest.h"
+
+QTEST_MAIN(FitsDataTest)
+
+static const int FITS_BLOCK_SIZE = 2880;
+
+static QByteArray card(const QString& key, const QString& value)
+{
+    return QString("%1= %2").arg(key, -8).arg(value, 20).leftJustified(80, ' ').toLatin1();
+}
+
+static void pad(QByteArray* data, char filler)
+{
+    int remainder = data->size() % FITS_BLOCK_SIZE;
+    if (remainder) {
+        data->append(QByteArray(FITS_BLOCK_SIZE - remainder, filler));
+    }
+}
+
+/**
+ * Returns a single precision FITS image of size width x height, whose rows
+ * are samples
+ */
+static QByteArray createFloatFits(int width, int height, const QVector<float>& samples)
+{
+    QByteArray data;
+    data += card("SIMPLE", "T");
+    data += card("BITPIX", "-32");
+    data += card("NAXIS", "2");
+    data += card("NAXIS1", QString::number(width));
+    data += card("NAXIS2", QString::number(height));
+    data += QByteArray("END").leftJustified(80, ' ');
+    pad(&data, ' ');
+
+    // FITS data is big endian, like QDataStream
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly | QIODevice::Append);
+    QDataStream stream(&buffer);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    for (float sample : samples) {
+        stream << sample;
+    }
+    buffer.close();
+    pad(&data, 0);
+    return data;
+}
+
+/**
+ * NaN is the usual value of blank samples in floating point images. It must
+ * not affect the statistics, and must be rendered like the maximum value.
+ */
+void FitsDataTest::testBlankSamples()
+{
+    const int width = 4;
+    const int height = 4;
+    QVector<float> samples;
+    for (int i = 0; i < width * height; ++i) {
+        samples << i * 10;
+    }
+    const int nanIndex = 5;
+    samples[nanIndex] = std::numeric_limits<float>::quiet_NaN();
+
+    QByteArray data = createFloatFits(width, height, samples);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    const QImage image = FITSData::FITSToImage(buffer);
+    QVERIFY(!image.isNull());
+    QCOMPARE(image.size(), QSize(width, height));
+
+    QCOMPARE(image.pixel(nanIndex % width, nanIndex / width), qRgb(255, 255, 255));
+    // The other samples are still stretched: the lowest one is below the
+    // mean minus the standard deviation
+    QCOMPARE(image.pixel(0, 0), qRgb(0, 0, 0));
+    QVERIFY(image.pixel(2, 2) != qRgb(0, 0, 0));
+    QVERIFY(image.pixel(2, 2) != qRgb(255, 255, 255));
+}
@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // KDE
 #include <QDebug>
+#include <KConfig>
+#include <KConfigGroup>
 #include <KFilePlacesModel>
 #include <QTemporaryDir>
 #include <qtest.h>
@@ -109,11 +111,153 @@ void HistoryModelTest::testRemoveRows()
     QDateTime d2 = QDateTime::fromString("2009-01-29T23:01:47", Qt::ISODate);
 
     QTemporaryDir dir;
+    {
+        HistoryModel model(0, dir.path(), 2);
+        model.addUrl(u1, d1);
+        model.addUrl(u2, d2);
+        model.removeRows(0, 1);
+        QCOMPARE(model.rowCount(), 1);
+    }
+    QDir qDir(dir.path());
+    QCOMPARE(qDir.entryList(QDir::Files | QDir::NoDotAndDotDot).count(), 1);
+
     HistoryModel model(0, dir.path(), 2);
-    model.addUrl(u1, d1);
-    model.addUrl(u2, d2);
-    model.removeRows(0, 1);
     QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.data(model.index(0, 0), KFilePlacesModel::UrlRole).value<QUrl>(), u1);
+}
+
+static QUrl remoteUrl(int number)
+{
+    // Remote urls are not checked for existence
+    return QUrl(QStringLiteral("sftp://example.com/dir%1").arg(number));
+}
+
+void HistoryModelTest::testFetchMore()
+{
+    const int count = 50;
+    const QDateTime dateTime = QDateTime::fromString("2009-01-29T23:01:47", Qt::ISODate);
+    QTemporaryDir dir;
+    {
+        HistoryModel model(0, dir.path(), count);
+        for (int i = 0; i < count; ++i) {
+            model.addUrl(remoteUrl(i), dateTime.addSecs(i));
+        }
+        QCOMPARE(model.rowCount(), count);
+    }
+
+    HistoryModel model(0, dir.path(), count);
+    QVERIFY(model.rowCount() > 0);
+    QVERIFY(model.rowCount() < count);
+    QVERIFY(model.canFetchMore(QModelIndex()));
+    while (model.canFetchMore(QModelIndex())) {
+        model.fetchMore(QModelIndex());
+    }
+    QCOMPARE(model.rowCount(), count);
+    for (int row = 0; row < count; ++row) {
+        const QUrl url = model.data(model.index(row, 0), KFilePlacesModel::UrlRole).value<QUrl>();
+        QCOMPARE(url, remoteUrl(count - 1 - row));
+    }
+
+    // Visiting an url which has not been fetched yet must not duplicate it
+    HistoryModel model2(0, dir.path(), count);
+    model2.addUrl(remoteUrl(0), dateTime.addSecs(count));
+    QCOMPARE(model2.data(model2.index(0, 0), KFilePlacesModel::UrlRole).value<QUrl>(), remoteUrl(0));
+    while (model2.canFetchMore(QModelIndex())) {
+        model2.fetchMore(QModelIndex());
+    }
+    QCOMPARE(model2.rowCount(), count);
+}
+
+void HistoryModelTest::testCompaction()
+{
+    const QUrl url = QUrl::fromLocalFile("/home");
+    const QDateTime dateTime = QDateTime::fromString("2009-01-29T23:01:47", Qt::ISODate);
+    QTemporaryDir dir;
+    {
+        HistoryModel model(0, dir.path(), 2);
+        for (int i = 0; i < 500; ++i) {
+            model.addUrl(url, dateTime.addSecs(i));
+        }
+    }
     QDir qDir(dir.path());
-    QCOMPARE(qDir.entryList(QDir::Files | QDir::NoDotAndDotDot).count(), 1);
+    const QStringList names = qDir.entryList(QDir::Files | QDir::NoDotAndDotDot);
+    QCOMPARE(names.count(), 1);
+    QFile file(qDir.filePath(names.first()));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll().count('\n'), 1);
+
+    HistoryModel model(0, dir.path(), 2);
+    QCOMPARE(model.rowCount(), 1);
+}
+
+void HistoryModelTest::testSharedStorage()
+{
+    const int maxCount = 20;
+    const QDateTime dateTime = QDateTime::fromString("2009-01-29T23:01:47", Qt::ISODate);
+    const QUrl sharedUrl = remoteUrl(1000);
+    QTemporaryDir dir;
+    QDir qDir(dir.path());
+
+    // Two instances of Gwenview using the same history
+    HistoryModel* model1 = new HistoryModel(0, dir.path(), maxCount);
+    HistoryModel* model2 = new HistoryModel(0, dir.path(), maxCount);
+    model1->addUrl(sharedUrl, dateTime.addSecs(1000));
+    delete model1;
+
+    // Enough records for model2 to compact the file when it is destroyed.
+    // Compaction must keep the record written by model1.
+    const int count = 150;
+    for (int i = 0; i < count; ++i) {
+        model2->addUrl(remoteUrl(i), dateTime.addSecs(i));
+    }
+    delete model2;
+
+    const QStringList names = qDir.entryList(QDir::Files | QDir::NoDotAndDotDot);
+    QCOMPARE(names.count(), 1);
+    QFile file(qDir.filePath(names.first()));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll().count('\n'), maxCount);
+
+    HistoryModel model(0, dir.path(), maxCount);
+    while (model.canFetchMore(QModelIndex())) {
+        model.fetchMore(QModelIndex());
+    }
+    QCOMPARE(model.rowCount(), maxCount);
+    QCOMPARE(model.data(model.index(0, 0), KFilePlacesModel::UrlRole).value<QUrl>(), sharedUrl);
+    for (int row = 1; row < maxCount; ++row) {
+        const QUrl url = model.data(model.index(row, 0), KFilePlacesModel::UrlRole).value<QUrl>();
+        QCOMPARE(url, remoteUrl(count - row));
+    }
+}
+
+void HistoryModelTest::testImportRcFiles()
+{
+    QUrl u1 = QUrl::fromLocalFile("/home");
+    QDateTime d1 = QDateTime::fromString("2008-02-03T12:34:56", Qt::ISODate);
+    QUrl u2 = QUrl::fromLocalFile("/root");
+    QDateTime d2 = QDateTime::fromString("2009-01-29T23:01:47", Qt::ISODate);
+
+    // Create files as older versions did
+    QTemporaryDir dir;
+    QDir qDir(dir.path());
+    const auto writeRcFile = [&qDir](const QString& name, const QUrl& url, const QDateTime& dateTime) {
+        KConfig config(qDir.filePath(name), KConfig::SimpleConfig);
+        KConfigGroup group(&config, "general");
+        group.writeEntry("url", url.toString());
+        group.writeEntry("dateTime", dateTime.toString(Qt::ISODate));
+        config.sync();
+    };
+    writeRcFile("gvhistory1rc", u1, d1);
+    writeRcFile("gvhistory2rc", u2, d2);
+    // Duplicate, older entry
+    writeRcFile("gvhistory3rc", u2, d1);
+
+    {
+        HistoryModel model(0, dir.path());
+        testModel(model, u2, u1);
+    }
+    QCOMPARE(qDir.entryList(QStringList() << "*rc").count(), 0);
+
+    HistoryModel model(0, dir.path());
+    testModel(model, u2, u1);
 }
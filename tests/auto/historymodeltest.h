@@ -31,6 +31,10 @@ private Q_SLOTS:
     void testAddUrl();
     void testGarbageCollect();
     void testRemoveRows();
+    void testFetchMore();
+    void testCompaction();
+    void testSharedStorage();
+    void testImportRcFiles();
 };
 
 #endif /* HISTORYMODELTEST_H */
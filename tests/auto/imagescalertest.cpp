@@ -19,6 +19,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 #include <qtest.h>
 
+#include <QBuffer>
+#include <QFile>
+
 #include "imagescalertest.h"
 
 #include "../lib/imagescaler.h"
@@ -65,6 +68,120 @@ void ImageScalerTest::testScaleFullImage()
     QVERIFY(TestUtils::imageCompare(scaledImage, expectedImage));
 }
 
+/**
+ * Returns JPEG data of a non square image with a different color in each
+ * quadrant, tagged with the Exif orientation
+ */
+static QByteArray createOrientedJpeg(Orientation orientation)
+{
+    QImage image(160, 96, QImage::Format_RGB32);
+    QPainter painter(&image);
+    painter.fillRect(0, 0, 80, 48, Qt::red);
+    painter.fillRect(80, 0, 80, 48, Qt::green);
+    painter.fillRect(0, 48, 80, 48, Qt::blue);
+    painter.fillRect(80, 48, 80, 48, Qt::yellow);
+    painter.end();
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "JPEG", 95);
+
+    // APP1 segment with a big endian TIFF header and a single IFD entry:
+    // Orientation (0x0112), SHORT, one value
+    const char exif[] = {
+        '\xff', '\xe1', 0, 34,
+        'E', 'x', 'i', 'f', 0, 0,
+        'M', 'M', 0, 0x2a, 0, 0, 0, 8,
+        0, 1,
+        0x01, 0x12, 0, 3, 0, 0, 0, 1, 0, char(orientation), 0, 0,
+        0, 0, 0, 0
+    };
+    // Right after the SOI marker
+    data.insert(2, QByteArray(exif, sizeof(exif)));
+    return data;
+}
+
+void ImageScalerTest::initTestCase()
+{
+    QVERIFY(mTempDir.isValid());
+    for (int orientation = NORMAL; orientation <= ROT_270; ++orientation) {
+        QFile file(mTempDir.path() + QString("/orient%1.jpg").arg(orientation));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(createOrientedJpeg(Orientation(orientation)));
+    }
+}
+
+void ImageScalerTest::testScaleRotatedImage_data()
+{
+    QTest::addColumn<int>("orientation");
+    QTest::addColumn<qreal>("zoom");
+
+    const QList<qreal> zooms = QList<qreal>() << 0.3 << 0.5 << 1.0 << 1.7 << 2.0;
+    for (int orientation = NORMAL; orientation <= ROT_270; ++orientation) {
+        Q_FOREACH(qreal zoom, zooms) {
+            const QString name = QString("orientation %1, zoom %2").arg(orientation).arg(zoom);
+            QTest::newRow(qPrintable(name)) << orientation << zoom;
+        }
+    }
+}
+
+/**
+ * The orientation of a rotated image is applied by the scaler, not when the
+ * document is loaded
+ */
+void ImageScalerTest::testScaleRotatedImage()
+{
+    QFETCH(int, orientation);
+    QFETCH(qreal, zoom);
+    // Start from an unoriented document for each row
+    DocumentFactory::instance()->clearCache();
+    QUrl url = QUrl::fromLocalFile(mTempDir.path() + QString("/orient%1.jpg").arg(orientation));
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+
+    while (doc->loadingState() < Document::MetaInfoLoaded) {
+        QTest::qWait(500);
+    }
+    QCOMPARE(doc->imageOrientation(), Orientation(orientation));
+
+    ImageScaler scaler;
+    ImageScalerClient client(&scaler);
+    scaler.setDocument(doc);
+    scaler.setZoom(zoom);
+
+    scaler.setDestinationRegion(QRect(QPoint(0, 0), doc->size() * zoom));
+
+    QSignalSpy spy(&scaler, SIGNAL(scaledRect(int,int,QImage)));
+
+    bool ok = spy.wait(30);
+    QVERIFY2(ok, "ImageScaler did not emit scaledRect() signal in time");
+    QCOMPARE(doc->imageOrientation(), Orientation(orientation));
+
+    QImage scaledImage = client.createFullImage();
+
+    // Calling image() applies the orientation to the document pixels
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+    const QImage expectedImage = doc->image();
+    QCOMPARE(doc->imageOrientation(), NORMAL);
+
+    // Smaller zooms are scaled from a down sampled image, so pixels are not
+    // exactly the same: compare the size and the color of each quadrant
+    const QSize expectedSize = expectedImage.size() * zoom;
+    QVERIFY(qAbs(scaledImage.width() - expectedSize.width()) <= 1);
+    QVERIFY(qAbs(scaledImage.height() - expectedSize.height()) <= 1);
+    for (int row = 0; row < 2; ++row) {
+        for (int col = 0; col < 2; ++col) {
+            const qreal x = (col * 2 + 1) / 4.;
+            const qreal y = (row * 2 + 1) / 4.;
+            const QImage scaledPixel = scaledImage.copy(int(x * scaledImage.width()), int(y * scaledImage.height()), 1, 1);
+            const QImage expectedPixel = expectedImage.copy(int(x * expectedImage.width()), int(y * expectedImage.height()), 1, 1);
+            QVERIFY(TestUtils::fuzzyImageCompare(scaledPixel.convertToFormat(QImage::Format_RGB32),
+                                                 expectedPixel.convertToFormat(QImage::Format_RGB32), 24));
+        }
+    }
+}
+
 #if 0
 /**
  * Scale parts of an image
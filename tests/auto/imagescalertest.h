@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Qt
 #include <QImage>
 #include <QPainter>
+#include <QTemporaryDir>
 
 // KDE
 #include <QDebug>
@@ -87,7 +88,10 @@ class ImageScalerTest : public QObject
     Q_OBJECT
 
 private Q_SLOTS:
+    void initTestCase();
     void testScaleFullImage();
+    void testScaleRotatedImage();
+    void testScaleRotatedImage_data();
 
     // FIXME Disabled for now, does not compile since ImageScaler::setImage() has
     // been replaced with ImageScaler::setDocument()
@@ -99,6 +103,9 @@ private Q_SLOTS:
     void testDontCrashWithoutImage();
     void testScaleDownBigImage();
 #endif
+
+private:
+    QTemporaryDir mTempDir;
 };
 
 #endif // IMAGESCALERTEST_H
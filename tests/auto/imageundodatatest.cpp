@@ -0,0 +1,204 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <QFileInfo>
+#include <QImage>
+#include <QTemporaryDir>
+
+#include "../lib/imageundodata.h"
+
+#include "imageundodatatest.h"
+#include "testutils.h"
+
+QTEST_MAIN(ImageUndoDataTest)
+
+using namespace Gwenview;
+
+void ImageUndoDataTest::testRestore_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<QString>("operation");
+
+    QTest::newRow("rgb32 crop") << int(QImage::Format_RGB32) << QString("crop");
+    QTest::newRow("rgb32 paint") << int(QImage::Format_RGB32) << QString("paint");
+    QTest::newRow("rgb32 replace") << int(QImage::Format_RGB32) << QString("replace");
+    QTest::newRow("rgb888 crop") << int(QImage::Format_RGB888) << QString("crop");
+    QTest::newRow("indexed8 paint") << int(QImage::Format_Indexed8) << QString("paint");
+    QTest::newRow("mono crop") << int(QImage::Format_Mono) << QString("crop");
+}
+
+void ImageUndoDataTest::testRestore()
+{
+    QFETCH(int, format);
+    QFETCH(QString, operation);
+
+    // Not a multiple of the tile size, to test partial tiles
+    const QImage before = TestUtils::createTestImage(QSize(300, 270), QImage::Format(format));
+    QImage after;
+    QPoint offset;
+    if (operation == "crop") {
+        offset = QPoint(130, 40);
+        after = before.copy(QRect(offset, QSize(150, 200)));
+    } else if (operation == "paint") {
+        after = before;
+        after.setPixel(10, 150, after.pixel(20, 20));
+    }
+
+    ImageUndoData data;
+    data.store(before, after, offset);
+    QCOMPARE(data.restore(after), before);
+}
+
+void ImageUndoDataTest::testUnchangedTilesAreNotStored()
+{
+    const QImage before = TestUtils::createTestImage(QSize(1024, 1024), QImage::Format_RGB32);
+    QImage after = before;
+    after.setPixel(500, 500, qRgb(255, 0, 0));
+
+    ImageUndoData data;
+    data.store(before, after);
+    QVERIFY(data.memoryUsage() > 0);
+    QVERIFY(data.memoryUsage() < before.byteCount() / 10);
+    QCOMPARE(data.restore(after), before);
+}
+
+/**
+ * Operations store their undo data each time they are redone: redo, undo,
+ * redo must give the same data as a single redo
+ */
+void ImageUndoDataTest::testStoreAgain()
+{
+    const QImage before = TestUtils::createTestImage(QSize(1024, 1024), QImage::Format_RGB32);
+    QImage after = before;
+    after.setPixel(500, 500, qRgb(255, 0, 0));
+
+    ImageUndoData data;
+    data.store(before, after);
+    const int memoryUsage = data.memoryUsage();
+    QCOMPARE(data.restore(after), before);
+
+    data.store(before, after);
+    QCOMPARE(data.memoryUsage(), memoryUsage);
+    QCOMPARE(data.restore(after), before);
+
+    // Tiles which were stored the first time but are unchanged now must not
+    // be kept
+    ImageUndoData data2;
+    data2.store(before, QImage());
+    QVERIFY(data2.memoryUsage() > memoryUsage);
+    data2.store(before, after);
+    QCOMPARE(data2.memoryUsage(), memoryUsage);
+    QCOMPARE(data2.restore(after), before);
+}
+
+// Some tests change the memory budget and the spill file, restore them
+void ImageUndoDataTest::init()
+{
+    mBudget = ImageUndoData::memoryBudget();
+}
+
+void ImageUndoDataTest::cleanup()
+{
+    ImageUndoData::setMemoryBudget(mBudget);
+    ImageUndoData::setSpillFilePath(QString());
+}
+
+void ImageUndoDataTest::testSpill()
+{
+    // Only the most recent data fits in the budget, the others are moved to
+    // a file of a temporary dir
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/undo";
+    ImageUndoData::setSpillFilePath(path);
+    ImageUndoData::setMemoryBudget(1);
+
+    // Not a multiple of the tile size, to test partial tiles
+    const QImage before = TestUtils::createTestImage(QSize(300, 270), QImage::Format_RGB32);
+    QImage after = before.copy();
+    after.fill(Qt::black);
+
+    ImageUndoData* data1 = new ImageUndoData;
+    data1->store(before, after);
+    QVERIFY(!data1->isSpilled());
+    const int length = data1->memoryUsage();
+    QVERIFY(length > 0);
+
+    ImageUndoData* data2 = new ImageUndoData;
+    data2->store(before, after);
+    QVERIFY(data1->isSpilled());
+    QCOMPARE(data1->memoryUsage(), 0);
+    QVERIFY(!data2->isSpilled());
+
+    ImageUndoData* data3 = new ImageUndoData;
+    data3->store(before, after);
+    QVERIFY(data2->isSpilled());
+    QCOMPARE(QFileInfo(path).size(), qint64(2 * length));
+
+    // Tiles are read back from the file
+    QCOMPARE(data1->restore(after), before);
+    QCOMPARE(data2->restore(after), before);
+
+    // The range of data1 is reused for data3
+    delete data1;
+    QCOMPARE(QFileInfo(path).size(), qint64(2 * length));
+    ImageUndoData* data4 = new ImageUndoData;
+    data4->store(before, after);
+    QVERIFY(data3->isSpilled());
+    QCOMPARE(QFileInfo(path).size(), qint64(2 * length));
+    QCOMPARE(data3->restore(after), before);
+    QCOMPARE(data2->restore(after), before);
+
+    // Ranges at the end of the file are given back
+    delete data2;
+    QCOMPARE(QFileInfo(path).size(), qint64(length));
+    delete data3;
+    QCOMPARE(QFileInfo(path).size(), qint64(0));
+
+    QCOMPARE(data4->restore(after), before);
+    delete data4;
+}
+
+/**
+ * Data which cannot be written to the file must stay in memory
+ */
+void ImageUndoDataTest::testSpillFailure()
+{
+    // Writing to /dev/full always fails
+    if (!QFileInfo("/dev/full").isWritable()) {
+        QSKIP("/dev/full is not available");
+    }
+    ImageUndoData::setSpillFilePath("/dev/full");
+    ImageUndoData::setMemoryBudget(1);
+
+    const QImage before = TestUtils::createTestImage(QSize(300, 270), QImage::Format_RGB32);
+    QImage after = before.copy();
+    after.fill(Qt::black);
+
+    ImageUndoData data1;
+    data1.store(before, after);
+    const int memoryUsage = data1.memoryUsage();
+    ImageUndoData data2;
+    data2.store(before, after);
+    QVERIFY(!data1.isSpilled());
+    QCOMPARE(data1.memoryUsage(), memoryUsage);
+    QCOMPARE(data1.restore(after), before);
+    QCOMPARE(data2.restore(after), before);
+}
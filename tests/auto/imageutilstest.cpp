@@ -0,0 +1,82 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <QImage>
+#include <QMatrix>
+
+#include "../lib/imageutils.h"
+
+#include "imageutilstest.h"
+#include "testutils.h"
+
+QTEST_MAIN(ImageUtilsTest)
+
+using namespace Gwenview;
+
+void ImageUtilsTest::testTransformed_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("orientation");
+
+    const QList<QImage::Format> formats = QList<QImage::Format>()
+        << QImage::Format_Mono
+        << QImage::Format_Indexed8
+        << QImage::Format_Grayscale8
+        << QImage::Format_RGB16
+        << QImage::Format_RGB888
+        << QImage::Format_RGB32
+        << QImage::Format_ARGB32;
+    for (QImage::Format format : formats) {
+        for (int orientation = NORMAL; orientation <= ROT_270; ++orientation) {
+            const QByteArray name = QByteArray("format ") + QByteArray::number(format)
+                + " orientation " + QByteArray::number(orientation);
+            QTest::newRow(name.constData()) << int(format) << orientation;
+        }
+    }
+}
+
+void ImageUtilsTest::testTransformed()
+{
+    QFETCH(int, format);
+    QFETCH(int, orientation);
+
+    // Odd sizes, bigger than a block, to test edges and middle rows
+    const QImage image = TestUtils::createTestImage(QSize(131, 75), QImage::Format(format));
+    const QImage expected = image.transformed(ImageUtils::transformMatrix(Orientation(orientation)));
+
+    // Use a detached copy, to go through the in place code
+    QImage copy = image.copy();
+    const QImage result = ImageUtils::transformed(std::move(copy), Orientation(orientation));
+
+    QCOMPARE(result.size(), expected.size());
+    QCOMPARE(result.convertToFormat(QImage::Format_ARGB32), expected.convertToFormat(QImage::Format_ARGB32));
+}
+
+void ImageUtilsTest::testTransformedSharedImage()
+{
+    const QImage image = TestUtils::createTestImage(QSize(64, 48), QImage::Format_RGB32);
+    const QImage before = image.copy();
+    const QImage result = ImageUtils::transformed(image, ROT_180);
+
+    // image is shared, it must not have been modified
+    QCOMPARE(image, before);
+    QCOMPARE(result, before.transformed(ImageUtils::transformMatrix(ROT_180)));
+}
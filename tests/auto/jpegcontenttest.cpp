@@ -19,8 +19,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 #include "jpegcontenttest.h"
 #include <iostream>
+#include <stdio.h>
+extern "C" {
+#include <jpeglib.h>
+}
 
 // Qt
+#include <QColor>
 #include <QDir>
 #include <QFile>
 #include <QImage>
@@ -223,6 +228,32 @@ void JpegContentTest::testThumbnail()
     QVERIFY(result);
 }
 
+void JpegContentTest::testSetThumbnail()
+{
+    Gwenview::JpegContent content;
+    QVERIFY(content.load(pathForTestFile(ORIENT6_FILE)));
+    QVERIFY(!content.thumbnail().isNull());
+
+    QImage image(200, 100, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    QImage thumbnail(64, 32, QImage::Format_RGB32);
+    thumbnail.fill(Qt::red);
+    content.setImage(image);
+    content.setThumbnail(thumbnail);
+    // The thumbnail is only encoded when saving, but is available right away
+    QCOMPARE(content.thumbnail().size(), thumbnail.size());
+
+    // Both the image and the thumbnail are encoded by save()
+    QVERIFY(content.save(TMP_FILE));
+    Gwenview::JpegContent savedContent;
+    QVERIFY(savedContent.load(TMP_FILE));
+    QCOMPARE(savedContent.size(), image.size());
+    const QImage savedThumbnail = savedContent.thumbnail();
+    QCOMPARE(savedThumbnail.size(), thumbnail.size());
+    const QColor color = savedThumbnail.pixel(32, 16);
+    QVERIFY(color.red() > 240 && color.green() < 16 && color.blue() < 16);
+}
+
 void JpegContentTest::testMultipleRotations()
 {
     // Test that rotating a file a lot of times does not cause findJxform() to fail
@@ -302,3 +333,45 @@ void JpegContentTest::testSetImage()
 //    ignoredKeys << "Orientation";
 //    compareMetaInfo(pathForTestFile(ORIENT6_FILE), pathForTestFile(TMP_FILE), ignoredKeys);
 }
+
+void JpegContentTest::testLosslessCrop()
+{
+    Gwenview::JpegContent content;
+    bool result = content.load(pathForTestFile(ORIENT1_VFLIP_FILE));
+    QVERIFY(result);
+
+    // Not aligned on MCUs
+    QVERIFY(!content.canCropLosslessly(QRect(3, 5, 64, 96)));
+
+#if JPEG_LIB_VERSION < 80
+    QSKIP("transupp.h from libjpeg 6.2 cannot crop");
+#endif
+    const QRect rect(16, 32, 64, 96);
+    QVERIFY(content.canCropLosslessly(rect));
+    content.crop(rect);
+    result = content.save(TMP_FILE);
+    QVERIFY(result);
+
+    QImage finalImage;
+    result = finalImage.load(TMP_FILE);
+    QVERIFY(result);
+    QCOMPARE(finalImage.size(), rect.size());
+
+    QImage expectedImage;
+    result = expectedImage.load(pathForTestFile(ORIENT1_VFLIP_FILE));
+    QVERIFY(result);
+    expectedImage = expectedImage.copy(rect);
+
+    // Chroma upsampling uses pixels outside of the crop rect, so only
+    // compare the inside
+    const QRect inside = finalImage.rect().adjusted(4, 4, -4, -4);
+    QCOMPARE(finalImage.copy(inside), expectedImage.copy(inside));
+}
+
+void JpegContentTest::testLosslessCropRefusedForExifOrientation()
+{
+    Gwenview::JpegContent content;
+    QVERIFY(content.load(pathForTestFile(ORIENT6_FILE)));
+    // Aligned on MCUs in the displayed image, but the JPEG data is rotated
+    QVERIFY(!content.canCropLosslessly(QRect(16, 32, 64, 96)));
+}
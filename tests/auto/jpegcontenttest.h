@@ -32,6 +32,7 @@ private Q_SLOTS:
     void cleanupTestCase();
     void testReadInfo();
     void testThumbnail();
+    void testSetThumbnail();
     void testResetOrientation();
     void testTransform();
     void testSetComment();
@@ -39,6 +40,8 @@ private Q_SLOTS:
     void testLoadTruncated();
     void testRawData();
     void testSetImage();
+    void testLosslessCrop();
+    void testLosslessCropRefusedForExifOrientation();
 };
 
 #endif // JPEGCONTENTTEST_H
@@ -0,0 +1,164 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+#include <QPrinter>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+
+#include "../lib/print/printhelper.h"
+#include "../lib/resampler.h"
+
+#include "printhelpertest.h"
+#include "testutils.h"
+
+QTEST_MAIN(PrintHelperTest)
+
+using namespace Gwenview;
+
+void PrintHelperTest::testDrawImage_data()
+{
+    QTest::addColumn<QSize>("imageSize");
+    QTest::addColumn<QRect>("rect");
+
+    QTest::newRow("one band") << QSize(600, 400) << QRect(10, 20, 300, 200);
+    // Wide enough to need several bands
+    QTest::newRow("several bands") << QSize(20000, 1000) << QRect(0, 5, 10000, 500);
+}
+
+/**
+ * Drawing band by band must give the same pixels as scaling the whole image
+ */
+void PrintHelperTest::testDrawImage()
+{
+    QFETCH(QSize, imageSize);
+    QFETCH(QRect, rect);
+    const QImage image = TestUtils::createTestImage(imageSize);
+
+    QImage target(rect.right() + 10, rect.bottom() + 10, QImage::Format_RGB32);
+    target.fill(Qt::black);
+    int lastPercent = -1;
+    {
+        QPainter painter(&target);
+        const bool done = PrintHelper::drawImage(&painter, image, rect, [&lastPercent](int percent) {
+            lastPercent = percent;
+            return true;
+        });
+        QVERIFY(done);
+    }
+    QCOMPARE(lastPercent, 100);
+
+    const QImage expected = Resampler::scaled(image, rect.size(), Resampler::Lanczos3);
+    QCOMPARE(target.copy(rect), expected);
+    QCOMPARE(target.pixel(rect.left() - 1 < 0 ? rect.right() + 1 : rect.left() - 1, rect.top()), QColor(Qt::black).rgb());
+}
+
+/**
+ * Images smaller than the target are not enlarged before being drawn
+ */
+void PrintHelperTest::testDrawSmallImage()
+{
+    const QImage image = TestUtils::createTestImage(QSize(40, 30));
+    const QRect rect(0, 0, 400, 300);
+    QImage target(rect.size(), QImage::Format_RGB32);
+    target.fill(Qt::black);
+    {
+        QPainter painter(&target);
+        QVERIFY(PrintHelper::drawImage(&painter, image, rect));
+    }
+    // Same as letting QPainter enlarge the image
+    QImage expected(rect.size(), QImage::Format_RGB32);
+    expected.fill(Qt::black);
+    {
+        QPainter painter(&expected);
+        painter.drawImage(rect, image);
+    }
+    QCOMPARE(target, expected);
+}
+
+void PrintHelperTest::testCancel()
+{
+    const QImage image = TestUtils::createTestImage(QSize(20000, 1000));
+    QImage target(10000, 500, QImage::Format_RGB32);
+    int calls = 0;
+    QPainter painter(&target);
+    const bool done = PrintHelper::drawImage(&painter, image, target.rect(), [&calls](int) {
+        ++calls;
+        return false;
+    });
+    QVERIFY(!done);
+    QCOMPARE(calls, 1);
+}
+
+/**
+ * Prints image to a one page PDF file, at 72 dpi so that the page has fewer
+ * pixels than the image. If resample is false, the image is drawn as is.
+ */
+static bool printToPdf(const QString& fileName, const QImage& image, bool resample)
+{
+    QPrinter printer(QPrinter::ScreenResolution);
+    printer.setResolution(72);
+    printer.setOutputFormat(QPrinter::PdfFormat);
+    printer.setOutputFileName(fileName);
+    QPainter painter(&printer);
+    const QRect viewport = painter.viewport();
+    const QSize size = image.size().scaled(viewport.size(), Qt::KeepAspectRatio);
+    const QRect rect(viewport.topLeft(), size);
+    if (resample) {
+        return PrintHelper::drawImage(&painter, image, rect);
+    }
+    painter.drawImage(rect, image);
+    return true;
+}
+
+static int pdfPageCount(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    // Page objects, not the page tree ("/Type /Pages")
+    return QString::fromLatin1(file.readAll()).count(QRegularExpression("/Type\\s*/Page(?!s)"));
+}
+
+void PrintHelperTest::testPdfOutput()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/output.pdf";
+    const QString fullFileName = dir.path() + "/full.pdf";
+    const QImage image = TestUtils::createTestImage(QSize(3000, 2000));
+
+    QVERIFY(printToPdf(fileName, image, true));
+    QVERIFY(printToPdf(fullFileName, image, false));
+
+    // Bands must be painted on a single page
+    QCOMPARE(pdfPageCount(fileName), 1);
+
+    // The image has been resampled to the printed size
+    const qint64 size = QFileInfo(fileName).size();
+    QVERIFY(size > 0);
+    QVERIFY2(size < QFileInfo(fullFileName).size() / 2,
+             qPrintable(QString("Resampled output: %1 bytes, full resolution output: %2 bytes")
+                        .arg(size).arg(QFileInfo(fullFileName).size())));
+}
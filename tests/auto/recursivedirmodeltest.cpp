@@ -203,3 +203,25 @@ void RecursiveDirModelTest::testSetNewUrl()
     loop.exec();
     QCOMPARE(model.rowCount(QModelIndex()), 2);
 }
+
+void RecursiveDirModelTest::testKindFilter()
+{
+    TestUtils::SandBoxDir sandBoxDir;
+    sandBoxDir.fill(
+        QStringList()
+        << "a.jpg"
+        << "notes.txt"
+        << "d1/b.png"
+        << "d1/c.txt"
+        );
+
+    RecursiveDirModel model;
+    model.setKindFilter(MimeTypeUtils::KIND_RASTER_IMAGE);
+    TestUtils::TimedEventLoop loop;
+    connect(&model, SIGNAL(completed()), &loop, SLOT(quit()));
+
+    model.setUrl(QUrl::fromLocalFile(sandBoxDir.absolutePath()));
+    loop.exec();
+    QList<QUrl> expected = listExpectedUrls(sandBoxDir, QStringList() << "a.jpg" << "d1/b.png");
+    QCOMPARE(listModelUrls(&model), expected);
+}
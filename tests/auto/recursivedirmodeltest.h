@@ -34,6 +34,7 @@ private Q_SLOTS:
     void testBasic_data();
     void testBasic();
     void testSetNewUrl();
+    void testKindFilter();
 };
 
 #endif /* RECURSIVEDIRMODELTEST_H */
@@ -0,0 +1,167 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <math.h>
+
+#include <QColor>
+#include <QImage>
+
+#include "../lib/paintutils.h"
+#include "../lib/ramp.h"
+#include "../lib/redeyereduction/redeyereductionimageoperation.h"
+
+#include "redeyereductiontest.h"
+#include "testutils.h"
+
+QTEST_MAIN(RedEyeReductionTest)
+
+using namespace Gwenview;
+
+/**
+ * The QColor based implementation RedEyeReductionImageOperation::apply() used
+ * to have, the result of the current one must stay close to it.
+ */
+static void referenceApply(QImage* img, const QRectF& rectF)
+{
+    const QRect rect = PaintUtils::containingRect(rectF);
+    const qreal radius = rectF.width() / 2;
+    const qreal centerX = rectF.x() + radius;
+    const qreal centerY = rectF.y() + radius;
+    const Ramp radiusRamp(
+        qMin(qreal(radius * 0.7), qreal(radius - 1)), radius,
+        qreal(1.), qreal(0.));
+
+    uchar* line = img->scanLine(rect.top()) + rect.left() * 4;
+    for (int y = rect.top(); y < rect.bottom(); ++y, line += img->bytesPerLine()) {
+        QRgb* ptr = (QRgb*)line;
+
+        for (int x = rect.left(); x < rect.right(); ++x, ++ptr) {
+            const qreal currentRadius = sqrt(pow(y - centerY, 2) + pow(x - centerX, 2));
+            qreal alpha = radiusRamp(currentRadius);
+            if (qFuzzyCompare(alpha, 0)) {
+                continue;
+            }
+
+            const QColor src(*ptr);
+            int hue, sat, value;
+            src.getHsv(&hue, &sat, &value);
+            qreal axs = 1.0;
+            if (hue > 259) {
+                static const Ramp ramp(30, 35, 0., 1.);
+                axs = ramp(sat);
+            } else {
+                const Ramp ramp(hue * 2 + 29, hue * 2 + 40, 0., 1.);
+                axs = ramp(sat);
+            }
+            alpha *= qBound(qreal(0.), src.alphaF() * axs, qreal(1.));
+
+            int r = src.red();
+            int g = src.green();
+            int b = src.blue();
+            QColor dst;
+            dst.setRed(int((1 - alpha) * r + alpha * g));
+            dst.setGreen(g);
+            dst.setBlue(b);
+            *ptr = dst.rgba();
+        }
+    }
+}
+
+static QImage createTestImage()
+{
+    QImage image(300, 200, QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            // Go through many hues and saturations, with a lot of red
+            line[x] = qRgb(128 + (x * 7 + y) % 128, (x * 3 + y * 5) & 0xff, (x * y) & 0xff);
+        }
+    }
+    return image;
+}
+
+/**
+ * Returns a copy of image with the alpha channel set to alpha
+ */
+static QImage withAlpha(const QImage& image, int alpha)
+{
+    QImage result = image.convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < result.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(result.scanLine(y));
+        for (int x = 0; x < result.width(); ++x) {
+            line[x] = qRgba(qRed(line[x]), qGreen(line[x]), qBlue(line[x]), alpha);
+        }
+    }
+    return result;
+}
+
+void RedEyeReductionTest::testApply_data()
+{
+    QTest::addColumn<QRectF>("rect");
+
+    QTest::newRow("big") << QRectF(20, 10, 180, 180);
+    QTest::newRow("unaligned") << QRectF(100.5, 40.25, 61.5, 61.5);
+    QTest::newRow("tiny") << QRectF(10, 10, 3, 3);
+}
+
+void RedEyeReductionTest::testApply()
+{
+    QFETCH(QRectF, rect);
+    QImage expected = createTestImage();
+    referenceApply(&expected, rect);
+
+    QImage result = createTestImage();
+    RedEyeReductionImageOperation::apply(&result, rect);
+
+    QVERIFY(result != createTestImage());
+    // Channels may differ by up to 2 levels
+    QVERIFY(TestUtils::fuzzyImageCompare(result, expected, 3));
+}
+
+/**
+ * Translucent pixels are corrected like opaque ones, and keep their alpha
+ */
+void RedEyeReductionTest::testApplyTranslucent()
+{
+    const QRectF rect(20, 10, 180, 180);
+    QImage expected = createTestImage();
+    RedEyeReductionImageOperation::apply(&expected, rect);
+    expected = withAlpha(expected, 128);
+
+    QImage result = withAlpha(createTestImage(), 128);
+    RedEyeReductionImageOperation::apply(&result, rect);
+
+    QVERIFY(TestUtils::imageCompare(result, expected));
+    // imageCompare() ignores alpha, check a pixel in the eye
+    QCOMPARE(qAlpha(result.pixel(110, 100)), 128);
+}
+
+/**
+ * apply() works from several threads, make sure the image is detached before
+ */
+void RedEyeReductionTest::testApplySharedImage()
+{
+    const QImage image = createTestImage();
+    QImage copy = image;
+    RedEyeReductionImageOperation::apply(&copy, QRectF(20, 10, 180, 180));
+    QCOMPARE(image, createTestImage());
+    QVERIFY(copy != image);
+}
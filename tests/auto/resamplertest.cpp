@@ -0,0 +1,120 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <QColor>
+#include <QImage>
+
+#include "../lib/resampler.h"
+
+#include "resamplertest.h"
+
+QTEST_MAIN(ResamplerTest)
+
+using namespace Gwenview;
+
+void ResamplerTest::testUniformImage_data()
+{
+    QTest::addColumn<int>("filter");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<QSize>("size");
+
+    for (int filter = Resampler::Lanczos3; filter <= Resampler::Mitchell; ++filter) {
+        const QByteArray name = filter == Resampler::Lanczos3 ? "lanczos3 " : "mitchell ";
+        QTest::newRow((name + "reduce rgb32").constData()) << filter << int(QImage::Format_RGB32) << QSize(37, 21);
+        QTest::newRow((name + "enlarge rgb32").constData()) << filter << int(QImage::Format_RGB32) << QSize(500, 333);
+        QTest::newRow((name + "reduce one axis").constData()) << filter << int(QImage::Format_RGB32) << QSize(200, 7);
+        QTest::newRow((name + "reduce argb32").constData()) << filter << int(QImage::Format_ARGB32) << QSize(37, 21);
+        QTest::newRow((name + "enlarge rgb888").constData()) << filter << int(QImage::Format_RGB888) << QSize(500, 333);
+    }
+}
+
+/**
+ * Scaling an image of one color must not change its color, whatever the
+ * filter, the format and the borders
+ */
+void ResamplerTest::testUniformImage()
+{
+    QFETCH(int, filter);
+    QFETCH(int, format);
+    QFETCH(QSize, size);
+    const QColor color(200, 100, 50, format == QImage::Format_ARGB32 ? 128 : 255);
+    QImage image(200, 150, QImage::Format(format));
+    image.fill(color);
+
+    const QImage result = Resampler::scaled(image, size, Resampler::Filter(filter));
+    QCOMPARE(result.size(), size);
+    const QRgb expectedPixel = image.convertToFormat(result.format()).pixel(0, 0);
+    for (int y = 0; y < result.height(); ++y) {
+        for (int x = 0; x < result.width(); ++x) {
+            const QRgb pixel = result.pixel(x, y);
+            QVERIFY(qAbs(qRed(pixel) - qRed(expectedPixel)) <= 1);
+            QVERIFY(qAbs(qGreen(pixel) - qGreen(expectedPixel)) <= 1);
+            QVERIFY(qAbs(qBlue(pixel) - qBlue(expectedPixel)) <= 1);
+            QVERIFY(qAbs(qAlpha(pixel) - qAlpha(expectedPixel)) <= 1);
+        }
+    }
+}
+
+void ResamplerTest::testGradient_data()
+{
+    QTest::addColumn<int>("filter");
+
+    QTest::newRow("lanczos3") << int(Resampler::Lanczos3);
+    QTest::newRow("mitchell") << int(Resampler::Mitchell);
+}
+
+/**
+ * A linear gradient must stay close to the same gradient once reduced
+ */
+void ResamplerTest::testGradient()
+{
+    QFETCH(int, filter);
+    QImage image(1000, 40, QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const int value = x * 255 / (image.width() - 1);
+            line[x] = qRgb(value, value, value);
+        }
+    }
+
+    const QImage result = Resampler::scaled(image, QSize(100, 4), Resampler::Filter(filter));
+    // Borders are affected by the clamping of the filter, skip them
+    for (int x = 4; x < result.width() - 4; ++x) {
+        const int expected = qRound((x + 0.5) * 10 * 255 / 999. - 0.5 * 255 / 999.);
+        QVERIFY2(qAbs(qGray(result.pixel(x, 1)) - expected) <= 2, qPrintable(QString::number(x)));
+    }
+}
+
+void ResamplerTest::testProgress()
+{
+    QImage image(300, 2000, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    QList<int> percents;
+    Resampler::scaled(image, QSize(100, 700), Resampler::Lanczos3, [&percents](int percent) {
+        percents << percent;
+    });
+    QVERIFY(!percents.isEmpty());
+    QCOMPARE(percents.last(), 100);
+    for (int i = 1; i < percents.count(); ++i) {
+        QVERIFY(percents[i] > percents[i - 1]);
+    }
+}
@@ -0,0 +1,221 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+#include "../lib/document/documentfactory.h"
+#include "../lib/slideshow.h"
+#include "../lib/slideshowscheduler.h"
+#include <lib/gwenviewconfig.h>
+#include "testutils.h"
+
+#include "slideshowschedulertest.h"
+
+QTEST_MAIN(SlideShowSchedulerTest)
+
+using namespace Gwenview;
+
+void SlideShowSchedulerTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    TestUtils::purgeUserConfiguration();
+    QVERIFY(mTempDir.isValid());
+
+    // Large enough for decoding to take a few milliseconds
+    const QImage image = TestUtils::createTestImage(QSize(4000, 3000));
+    for (int i = 0; i < 2; ++i) {
+        const QString path = mTempDir.path() + QString("/large%1.jpg").arg(i);
+        QVERIFY(image.save(path, "JPEG"));
+        mLargeUrls << QUrl::fromLocalFile(path);
+    }
+}
+
+void SlideShowSchedulerTest::init()
+{
+    DocumentFactory::instance()->clearCache();
+    GwenviewConfig::setLoop(false);
+    GwenviewConfig::setRandom(false);
+}
+
+/**
+ * Runs slideShow on urls, starting from the first one, until it stops.
+ * Returns the urls it went to.
+ */
+static QList<QUrl> runSlideShow(SlideShow* slideShow, const QList<QUrl>& urls)
+{
+    QList<QUrl> shownUrls;
+    const QMetaObject::Connection connection = QObject::connect(slideShow, &SlideShow::goToUrl, slideShow, [slideShow, &shownUrls](const QUrl& url) {
+        shownUrls << url;
+        // Like the main window does
+        slideShow->setCurrentUrl(url);
+    });
+    slideShow->setCurrentUrl(urls.first());
+    slideShow->start(urls);
+    QElapsedTimer timer;
+    timer.start();
+    while (slideShow->isRunning() && timer.elapsed() < 30000) {
+        QTest::qWait(10);
+    }
+    if (slideShow->isRunning()) {
+        qWarning() << "Slideshow did not stop";
+    }
+    QObject::disconnect(connection);
+    return shownUrls;
+}
+
+void SlideShowSchedulerTest::testDefaultAheadCount()
+{
+    SlideShowScheduler scheduler;
+    scheduler.setInterval(5000);
+    // Nothing has been decoded yet
+    QCOMPARE(scheduler.averageDecodeTime(), -1);
+    QCOMPARE(scheduler.aheadCount(), 2);
+}
+
+void SlideShowSchedulerTest::testSlideReady()
+{
+    DocumentFactory::instance()->clearCache();
+    const QUrl url = urlForTestFile("orient6.jpg");
+    SlideShowScheduler scheduler;
+    scheduler.setSlideSize(QSize(100, 100));
+    scheduler.setInterval(5000);
+    QSignalSpy spy(&scheduler, SIGNAL(slideReady(QUrl)));
+    scheduler.setUpcomingUrls(QList<QUrl>() << url);
+    QVERIFY(waitForSignal(spy));
+    QCOMPARE(spy.first().first().toUrl(), url);
+    QVERIFY(scheduler.isReady(url));
+
+    // The slide was decoded at the slide size, not at full size
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    QVERIFY(doc->loadingState() != Document::Loaded);
+
+    QVERIFY(scheduler.averageDecodeTime() >= 0);
+    QVERIFY(scheduler.aheadCount() >= 1);
+    QVERIFY(scheduler.aheadCount() <= SlideShowScheduler::MAX_AHEAD_COUNT);
+}
+
+void SlideShowSchedulerTest::testUpcomingUrlsAreLimited()
+{
+    DocumentFactory::instance()->clearCache();
+    QList<QUrl> urls;
+    urls << urlForTestFile("test.png")
+         << urlForTestFile("orient6.jpg")
+         << urlForTestFile("orient6-small.jpg")
+         << urlForTestFile("1frame.gif")
+         << urlForTestFile("4frames.gif")
+         << urlForTestFile("embedded-thumbnail.jpg");
+    SlideShowScheduler scheduler;
+    scheduler.setInterval(5000);
+    const int aheadCount = scheduler.aheadCount();
+    scheduler.setUpcomingUrls(urls);
+    for (int pos = 0; pos < urls.count(); ++pos) {
+        const bool cached = DocumentFactory::instance()->getCachedDocument(urls.at(pos));
+        QCOMPARE(cached, pos < aheadCount);
+    }
+}
+
+/**
+ * aheadCount() is the number of intervals decoding takes, plus one
+ */
+void SlideShowSchedulerTest::testAheadCountGrowsWithDecodeTime()
+{
+    SlideShowScheduler scheduler;
+    scheduler.setSlideSize(QSize(100, 100));
+    scheduler.setInterval(1000000);
+    QSignalSpy spy(&scheduler, SIGNAL(slideReady(QUrl)));
+    scheduler.setUpcomingUrls(QList<QUrl>() << mLargeUrls.first());
+    QVERIFY(waitForSignal(spy, 30));
+    const int decodeTime = scheduler.averageDecodeTime();
+    QVERIFY(decodeTime >= SlideShowScheduler::MAX_AHEAD_COUNT);
+
+    // Decoding takes less than an interval
+    QCOMPARE(scheduler.aheadCount(), 2);
+
+    // Decoding takes two intervals or a bit more
+    scheduler.setInterval(decodeTime / 2);
+    QVERIFY(scheduler.aheadCount() >= 3);
+
+    // Decoding takes many intervals
+    scheduler.setInterval(1);
+    QCOMPARE(scheduler.aheadCount(), int(SlideShowScheduler::MAX_AHEAD_COUNT));
+
+    // More slides are loaded ahead
+    QList<QUrl> urls;
+    urls << mLargeUrls.first()
+         << urlForTestFile("test.png")
+         << urlForTestFile("orient6.jpg")
+         << urlForTestFile("orient6-small.jpg")
+         << urlForTestFile("orient1_vflip.jpg");
+    scheduler.setUpcomingUrls(urls);
+    for (int pos = 0; pos < urls.count(); ++pos) {
+        const bool cached = DocumentFactory::instance()->getCachedDocument(urls.at(pos));
+        QCOMPARE(cached, pos < SlideShowScheduler::MAX_AHEAD_COUNT);
+    }
+}
+
+/**
+ * When the display time of a slide comes before it is decoded, the slideshow
+ * waits for it instead of skipping it
+ */
+void SlideShowSchedulerTest::testMissedDeadline()
+{
+    // Much shorter than the decoding time of the large images
+    GwenviewConfig::setInterval(0.001);
+    SlideShow slideShow(0);
+    slideShow.setSlideSize(QSize(100, 100));
+    QList<QUrl> urls;
+    urls << urlForTestFile("test.png") << mLargeUrls;
+    const QList<QUrl> shownUrls = runSlideShow(&slideShow, urls);
+
+    QCOMPARE(shownUrls, mLargeUrls);
+    QVERIFY(slideShow.missedDeadlineCount() >= 1);
+}
+
+/**
+ * In random order, the slides decoded ahead must be the next ones of the
+ * shuffled list: with an interval much longer than decoding times, no
+ * deadline is missed
+ */
+void SlideShowSchedulerTest::testRandomUpcomingUrls()
+{
+    GwenviewConfig::setRandom(true);
+    GwenviewConfig::setInterval(0.5);
+    SlideShow slideShow(0);
+    slideShow.setSlideSize(QSize(100, 100));
+    QList<QUrl> urls;
+    urls << urlForTestFile("test.png")
+         << urlForTestFile("orient6.jpg")
+         << urlForTestFile("orient6-small.jpg")
+         << urlForTestFile("orient1_vflip.jpg");
+    QList<QUrl> shownUrls = runSlideShow(&slideShow, urls);
+
+    // Each url is shown once, the current one included
+    std::sort(shownUrls.begin(), shownUrls.end());
+    QList<QUrl> expected = urls;
+    std::sort(expected.begin(), expected.end());
+    QCOMPARE(shownUrls, expected);
+    QCOMPARE(slideShow.missedDeadlineCount(), 0);
+}
@@ -0,0 +1,48 @@
+/*
+Gwenview: an image viewer
+Copyright 2018 Gwenview Developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#ifndef SLIDESHOWSCHEDULERTEST_H
+#define SLIDESHOWSCHEDULERTEST_H
+
+// Qt
+#include <QList>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QUrl>
+
+class SlideShowSchedulerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void testDefaultAheadCount();
+    void testSlideReady();
+    void testUpcomingUrlsAreLimited();
+    void testAheadCountGrowsWithDecodeTime();
+    void testMissedDeadline();
+    void testRandomUpcomingUrls();
+
+private:
+    QTemporaryDir mTempDir;
+    QList<QUrl> mLargeUrls;
+};
+
+#endif // SLIDESHOWSCHEDULERTEST_H
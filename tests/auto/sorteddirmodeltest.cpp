@@ -30,12 +30,51 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // KDE
 #include <qtest.h>
 #include <KDirLister>
+#include <KDirModel>
 #include <QTemporaryDir>
 
 using namespace Gwenview;
 
 QTEST_MAIN(SortedDirModelTest)
 
+/**
+ * Accepts items whose name contains a text
+ */
+class TestNameFilter : public AbstractSortedDirModelFilter
+{
+public:
+    TestNameFilter(SortedDirModel* model)
+    : AbstractSortedDirModelFilter(model)
+    {}
+
+    bool needsSemanticInfo() const Q_DECL_OVERRIDE
+    {
+        return false;
+    }
+
+    bool acceptsIndex(const QModelIndex& index) const Q_DECL_OVERRIDE
+    {
+        return model()->foldedNameForSourceIndex(index).contains(mText);
+    }
+
+    void setText(const QString& text, SortedDirModel::FilterChange change)
+    {
+        mText = text;
+        model()->applyFilters(change);
+    }
+
+private:
+    QString mText;
+};
+
+static void openDir(SortedDirModel* model, const QString& dir)
+{
+    QEventLoop loop;
+    QObject::connect(model->dirLister(), SIGNAL(completed()), &loop, SLOT(quit()));
+    model->dirLister()->openUrl(QUrl::fromLocalFile(dir));
+    loop.exec();
+}
+
 void SortedDirModelTest::initTestCase()
 {
     mSandBoxDir.mkdir("empty_dir");
@@ -45,8 +84,18 @@ void SortedDirModelTest::initTestCase()
     mSandBoxDir.mkdir("dirs_and_docs");
     mSandBoxDir.mkdir("dirs_and_docs/dir");
     createEmptyFile(mSandBoxDir.absoluteFilePath("dirs_and_docs/file.png"));
+    createEmptyFile(mSandBoxDir.absoluteFilePath("dirs_and_docs/dir/child.png"));
     mSandBoxDir.mkdir("docs_only");
     createEmptyFile(mSandBoxDir.absoluteFilePath("docs_only/file.png"));
+    mSandBoxDir.mkdir("mixed");
+    mSandBoxDir.mkdir("mixed/sub");
+    createEmptyFile(mSandBoxDir.absoluteFilePath("mixed/a.png"));
+    createEmptyFile(mSandBoxDir.absoluteFilePath("mixed/b.png"));
+    createEmptyFile(mSandBoxDir.absoluteFilePath("mixed/notes.txt"));
+    mSandBoxDir.mkdir("hidden_docs");
+    createEmptyFile(mSandBoxDir.absoluteFilePath("hidden_docs/a.png"));
+    createEmptyFile(mSandBoxDir.absoluteFilePath("hidden_docs/.b.png"));
+    createEmptyFile(mSandBoxDir.absoluteFilePath("hidden_docs/c.png"));
 }
 
 void SortedDirModelTest::testHasDocuments_data()
@@ -75,3 +124,108 @@ void SortedDirModelTest::testHasDocuments()
     loop.exec();
     QCOMPARE(model.hasDocuments(), hasDocuments);
 }
+
+/**
+ * Filter changes on a flat folder are applied in chunks, check all kinds of
+ * changes
+ */
+void SortedDirModelTest::testKindFilter()
+{
+    SortedDirModel model;
+    openDir(&model, mSandBoxDir.absoluteFilePath("mixed"));
+    QCOMPARE(model.rowCount(), 4);
+
+    model.setKindFilter(MimeTypeUtils::KIND_RASTER_IMAGE);
+    QTRY_COMPARE(model.rowCount(), 2);
+
+    model.setKindFilter(MimeTypeUtils::KIND_RASTER_IMAGE | MimeTypeUtils::KIND_DIR);
+    QTRY_COMPARE(model.rowCount(), 3);
+
+    model.setKindFilter(MimeTypeUtils::KIND_DIR);
+    QTRY_COMPARE(model.rowCount(), 1);
+
+    model.setKindFilter(MimeTypeUtils::KIND_FILE);
+    QTRY_COMPARE(model.itemForIndex(model.index(0, 0)).name(), QString("notes.txt"));
+    QCOMPARE(model.rowCount(), 1);
+
+    // Turning off the last kind shows everything again
+    model.adjustKindFilter(MimeTypeUtils::KIND_FILE, false);
+    QCOMPARE(model.kindFilter(), MimeTypeUtils::Kinds());
+    QTRY_COMPARE(model.rowCount(), 4);
+}
+
+void SortedDirModelTest::testNameFilter()
+{
+    SortedDirModel model;
+    openDir(&model, mSandBoxDir.absoluteFilePath("mixed"));
+    QCOMPARE(model.rowCount(), 4);
+
+    // An empty text accepts everything
+    TestNameFilter filter(&model);
+    QTest::qWait(100);
+    QCOMPARE(model.rowCount(), 4);
+
+    filter.setText(".png", SortedDirModel::FilterNarrowed);
+    QTRY_COMPARE(model.rowCount(), 2);
+
+    filter.setText("a.png", SortedDirModel::FilterNarrowed);
+    QTRY_COMPARE(model.rowCount(), 1);
+    QCOMPARE(model.itemForIndex(model.index(0, 0)).name(), QString("a.png"));
+
+    filter.setText("b.png", SortedDirModel::FilterChanged);
+    QTRY_COMPARE(model.itemForIndex(model.index(0, 0)).name(), QString("b.png"));
+    QCOMPARE(model.rowCount(), 1);
+
+    filter.setText(QString(), SortedDirModel::FilterWidened);
+    QTRY_COMPARE(model.rowCount(), 4);
+}
+
+void SortedDirModelTest::testKindFilterInTree()
+{
+    const QUrl dirUrl = QUrl::fromLocalFile(mSandBoxDir.absoluteFilePath("dirs_and_docs/dir"));
+    SortedDirModel model;
+    QEventLoop loop;
+    connect(model.dirLister(), SIGNAL(completed()), &loop, SLOT(quit()));
+    model.dirLister()->openUrl(QUrl::fromLocalFile(mSandBoxDir.absoluteFilePath("dirs_and_docs")));
+    loop.exec();
+    QCOMPARE(model.rowCount(), 2);
+
+    // List the children of "dir" below its row, like the folder view does
+    // when a folder is expanded
+    QModelIndex dirIndex = model.indexForUrl(dirUrl);
+    QVERIFY(dirIndex.isValid());
+    model.fetchMore(dirIndex);
+    loop.exec();
+    QCOMPARE(model.rowCount(model.indexForUrl(dirUrl)), 1);
+
+    // Child rows must be filtered too
+    model.setKindFilter(MimeTypeUtils::KIND_DIR);
+    QTRY_COMPARE(model.rowCount(), 1);
+    QTRY_COMPARE(model.rowCount(model.indexForUrl(dirUrl)), 0);
+
+    model.setKindFilter(MimeTypeUtils::Kinds());
+    QTRY_COMPARE(model.rowCount(), 2);
+    QTRY_COMPARE(model.rowCount(model.indexForUrl(dirUrl)), 1);
+}
+
+void SortedDirModelTest::testHiddenFirst()
+{
+    SortedDirModel model;
+    model.dirLister()->setShowingDotFiles(true);
+    QEventLoop loop;
+    connect(model.dirLister(), SIGNAL(completed()), &loop, SLOT(quit()));
+    model.dirLister()->openUrl(QUrl::fromLocalFile(mSandBoxDir.absoluteFilePath("hidden_docs")));
+    loop.exec();
+    QCOMPARE(model.rowCount(), 3);
+
+    model.sort(KDirModel::Name, Qt::AscendingOrder);
+    QCOMPARE(model.itemForIndex(model.index(0, 0)).name(), QString(".b.png"));
+    QCOMPARE(model.itemForIndex(model.index(1, 0)).name(), QString("a.png"));
+    QCOMPARE(model.itemForIndex(model.index(2, 0)).name(), QString("c.png"));
+
+    // Hidden items stay on top whatever the sort order
+    model.sort(KDirModel::Name, Qt::DescendingOrder);
+    QCOMPARE(model.itemForIndex(model.index(0, 0)).name(), QString(".b.png"));
+    QCOMPARE(model.itemForIndex(model.index(1, 0)).name(), QString("c.png"));
+    QCOMPARE(model.itemForIndex(model.index(2, 0)).name(), QString("a.png"));
+}
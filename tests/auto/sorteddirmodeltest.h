@@ -37,6 +37,10 @@ private Q_SLOTS:
     void initTestCase();
     void testHasDocuments_data();
     void testHasDocuments();
+    void testKindFilter();
+    void testNameFilter();
+    void testKindFilterInTree();
+    void testHiddenFirst();
 
 private:
     TestUtils::SandBoxDir mSandBoxDir;
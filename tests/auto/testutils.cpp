@@ -156,6 +156,23 @@ bool imageCompare(const QImage& img1, const QImage& img2)
     return fuzzyImageCompare(img1, img2, 1);
 }
 
+QImage createTestImage(const QSize& size, QImage::Format format)
+{
+    QImage image(size, QImage::Format_RGB32);
+    const int width = qMax(size.width() - 1, 1);
+    const int height = qMax(size.height() - 1, 1);
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            // Red and green are gradients, blue changes from one pixel to
+            // the next so that misplaced pixels are noticed. Opaque, so that
+            // premultiplied formats compare exactly.
+            line[x] = qRgb(qint64(x) * 255 / width, qint64(y) * 255 / height, (x * 7 + y * 13) & 0xff);
+        }
+    }
+    return image.convertToFormat(format);
+}
+
 SandBoxDir::SandBoxDir()
 : mTempDir(QDir::currentPath() + "/sandbox-")
 {
@@ -93,6 +93,12 @@ bool fuzzyImageCompare(const QImage& img1, const QImage& img2, int delta = 2);
 
 bool imageCompare(const QImage& img1, const QImage& img2);
 
+/**
+ * Returns an opaque image whose colors vary along both axes, converted to
+ * format
+ */
+QImage createTestImage(const QSize& size, QImage::Format format = QImage::Format_RGB32);
+
 void purgeUserConfiguration();
 
 class SandBoxDir : public QDir
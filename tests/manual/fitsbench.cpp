@@ -0,0 +1,113 @@
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QImage>
+#include <QTime>
+
+#include <lib/imageformats/fitsformat/fitsdata.h>
+
+const int ITERATIONS = 3;
+const int DEFAULT_SIZE = 4000;
+const int FITS_BLOCK_SIZE = 2880;
+const QSize THUMBNAIL_SIZE(256, 256);
+
+static QByteArray card(const QString& key, const QString& value)
+{
+    return QString("%1= %2").arg(key, -8).arg(value, 20).leftJustified(80, ' ').toLatin1();
+}
+
+static void pad(QByteArray* data, char filler)
+{
+    int remainder = data->size() % FITS_BLOCK_SIZE;
+    if (remainder) {
+        data->append(QByteArray(FITS_BLOCK_SIZE - remainder, filler));
+    }
+}
+
+template <typename T>
+static QByteArray createFits(int bitpix, int size)
+{
+    QByteArray data;
+    data += card("SIMPLE", "T");
+    data += card("BITPIX", QString::number(bitpix));
+    data += card("NAXIS", "2");
+    data += card("NAXIS1", QString::number(size));
+    data += card("NAXIS2", QString::number(size));
+    data += QByteArray("END").leftJustified(80, ' ');
+    pad(&data, ' ');
+
+    // FITS data is big endian, like QDataStream
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly | QIODevice::Append);
+    QDataStream stream(&buffer);
+    stream.setFloatingPointPrecision(sizeof(T) == 4 ? QDataStream::SinglePrecision : QDataStream::DoublePrecision);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            // A gradient with some noise, so that statistics are not trivial
+            const int noise = (x * 7919 + y * 104729) % 17;
+            stream << T((x + y) % 100 + noise + 20);
+        }
+    }
+    buffer.close();
+    pad(&data, 0);
+    return data;
+}
+
+static void bench(const QString& name, QByteArray data)
+{
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QTime chrono;
+    int loadTime = 0;
+    int imageTime = 0;
+    int thumbnailTime = 0;
+    for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+        chrono.start();
+        FITSData fitsData;
+        if (!fitsData.loadFITS(buffer)) {
+            qWarning() << name << ": could not load FITS data";
+            return;
+        }
+        loadTime += chrono.elapsed();
+
+        chrono.start();
+        QImage image = FITSData::FITSToImage(buffer);
+        imageTime += chrono.elapsed();
+        if (image.isNull()) {
+            qWarning() << name << ": could not convert FITS data";
+            return;
+        }
+
+        chrono.start();
+        FITSData::FITSToImage(buffer, THUMBNAIL_SIZE);
+        thumbnailTime += chrono.elapsed();
+    }
+    qDebug() << name << ": load and stats:" << loadTime / ITERATIONS << "ms,"
+             << "FITSToImage():" << imageTime / ITERATIONS << "ms,"
+             << "FITSToImage() at thumbnail size:" << thumbnailTime / ITERATIONS << "ms";
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    int size = DEFAULT_SIZE;
+    if (argc == 2) {
+        size = QString::fromUtf8(argv[1]).toInt();
+    }
+    if (size <= 0 || size > 65535) {
+        qDebug() << "Usage: fitsbench [size]";
+        return 1;
+    }
+    qDebug() << "Benchmarking" << size << "x" << size << "images";
+
+    bench("BITPIX 8", createFits<quint8>(8, size));
+    bench("BITPIX 16", createFits<qint16>(16, size));
+    bench("BITPIX 32", createFits<qint32>(32, size));
+    bench("BITPIX 64", createFits<qint64>(64, size));
+    bench("BITPIX -32", createFits<float>(-32, size));
+    bench("BITPIX -64", createFits<double>(-64, size));
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QImage>
+#include <QImageWriter>
+#include <QTime>
+
+#include <lib/jpegcontent.h>
+#include <tests/auto/testutils.h>
+
+using namespace Gwenview;
+
+// Size of the Exif thumbnail
+const int THUMBNAIL_SIZE = 128;
+
+// Inverted zoom of the down sampled image a document usually has when it is
+// displayed to fit the window
+const int INVERTED_ZOOM = 4;
+
+static int saveTime(const QString& path, const QImage& image, const QImage& thumbnail)
+{
+    JpegContent content;
+    content.load(path);
+    content.setImage(image);
+    if (!thumbnail.isNull()) {
+        content.setThumbnail(thumbnail);
+    }
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QTime chrono;
+    chrono.start();
+    content.save(&buffer);
+    return chrono.elapsed();
+}
+
+static void bench(const QString& path, const QSize& size)
+{
+    const QImage image = TestUtils::createTestImage(size);
+    const QSize thumbnailSize = size.scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio);
+    const QImage downSampledImage = image.scaled(size / INVERTED_ZOOM, Qt::KeepAspectRatio, Qt::FastTransformation);
+
+    // What saving did before: scale the full image
+    QTime chrono;
+    chrono.start();
+    QImage thumbnail = image.scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio);
+    const int fullScaleTime = chrono.elapsed();
+
+    chrono.restart();
+    thumbnail = downSampledImage.scaled(thumbnailSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    const int downSampledScaleTime = chrono.elapsed();
+
+    chrono.restart();
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter(&buffer, "JPEG").write(thumbnail);
+    const int thumbnailEncodeTime = chrono.elapsed();
+
+    const int mainSaveTime = saveTime(path, image, QImage());
+    const int concurrentSaveTime = saveTime(path, image, thumbnail);
+
+    qDebug() << size
+             << "thumbnail from full image:" << fullScaleTime << "ms,"
+             << "from down sampled image:" << downSampledScaleTime << "ms |"
+             << "sequential save:" << mainSaveTime + thumbnailEncodeTime << "ms,"
+             << "concurrent save:" << concurrentSaveTime << "ms";
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    if (argc != 2) {
+        qWarning() << "Usage: jpegsavebench <JPEG file with an Exif thumbnail>";
+        return 1;
+    }
+    const QString path = QString::fromLocal8Bit(argv[1]);
+    QList<QSize> sizes;
+    sizes << QSize(1600, 1200) << QSize(4000, 3000) << QSize(6000, 4000) << QSize(8000, 6000);
+    Q_FOREACH(const QSize& size, sizes) {
+        bench(path, size);
+    }
+    return 0;
+}
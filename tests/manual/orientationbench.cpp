@@ -0,0 +1,76 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QImage>
+#include <QMatrix>
+#include <QTime>
+
+#include <utility>
+
+#include <lib/imageutils.h>
+
+using namespace Gwenview;
+
+// About 50 megapixels, portrait
+const int WIDTH = 5792;
+const int HEIGHT = 8688;
+
+static const char* orientationName(Orientation orientation)
+{
+    switch (orientation) {
+    case HFLIP:
+        return "HFLIP";
+    case ROT_180:
+        return "ROT_180";
+    case VFLIP:
+        return "VFLIP";
+    case TRANSPOSE:
+        return "TRANSPOSE";
+    case ROT_90:
+        return "ROT_90";
+    case TRANSVERSE:
+        return "TRANSVERSE";
+    case ROT_270:
+        return "ROT_270";
+    default:
+        return "NORMAL";
+    }
+}
+
+static void bench(const QImage& image, Orientation orientation)
+{
+    QTime chrono;
+    chrono.start();
+    QImage result = image.transformed(ImageUtils::transformMatrix(orientation));
+    const int matrixTime = chrono.elapsed();
+
+    chrono.restart();
+    result = ImageUtils::transformed(image, orientation);
+    const int sharedTime = chrono.elapsed();
+
+    // What LoadingDocumentImpl does: the decoded image is not shared
+    QImage copy = image.copy();
+    chrono.restart();
+    result = ImageUtils::transformed(std::move(copy), orientation);
+    const int detachedTime = chrono.elapsed();
+
+    qDebug() << orientationName(orientation)
+             << "QImage::transformed():" << matrixTime << "ms,"
+             << "ImageUtils::transformed():" << sharedTime << "ms,"
+             << detachedTime << "ms on a detached image";
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QList<QImage::Format> formats;
+    formats << QImage::Format_RGB32 << QImage::Format_RGB888 << QImage::Format_Grayscale8;
+    Q_FOREACH(QImage::Format format, formats) {
+        QImage image(WIDTH, HEIGHT, format);
+        image.fill(Qt::darkGreen);
+        qDebug() << "Format" << format << image.size();
+        for (int orientation = HFLIP; orientation <= ROT_270; ++orientation) {
+            bench(image, Orientation(orientation));
+        }
+    }
+    return 0;
+}
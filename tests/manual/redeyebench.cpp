@@ -0,0 +1,43 @@
+#include <QColor>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QImage>
+#include <QRectF>
+#include <QTime>
+
+#include <lib/redeyereduction/redeyereductionimageoperation.h>
+
+using namespace Gwenview;
+
+// About 24 megapixels
+const int WIDTH = 6000;
+const int HEIGHT = 4000;
+
+// Number of times each selection is processed
+const int ITERATIONS = 5;
+
+static void bench(const QImage& image, qreal size)
+{
+    const QRectF rect((image.width() - size) / 2, (image.height() - size) / 2, size, size);
+    QImage copy = image.copy();
+    QTime chrono;
+    chrono.start();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        RedEyeReductionImageOperation::apply(&copy, rect);
+    }
+    qDebug() << "Selection of" << size << "pixels:" << chrono.elapsed() / ITERATIONS << "ms";
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QImage image(WIDTH, HEIGHT, QImage::Format_RGB32);
+    image.fill(QColor(200, 40, 50));
+    qDebug() << "Image" << image.size();
+    QList<qreal> sizes;
+    sizes << 50 << 200 << 1000 << 3000;
+    Q_FOREACH(qreal size, sizes) {
+        bench(image, size);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <QCollator>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QTime>
+#include <QUrl>
+
+#include <KFileItem>
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include <lib/archiveutils.h>
+#include <lib/fileitemsortkey.h>
+
+using namespace Gwenview;
+
+const int ITEM_COUNT = 100000;
+
+static KFileItemList createItems()
+{
+    KFileItemList list;
+    list.reserve(ITEM_COUNT);
+    for (int idx = 0; idx < ITEM_COUNT; ++idx) {
+        // Shuffle names a bit so that sorting has some work to do
+        const int number = (idx * 7919) % ITEM_COUNT;
+        QString name = idx % 50 == 0
+            ? QString("folder%1").arg(number)
+            : QString("IMG_%1.jpg").arg(number);
+        mode_t mode = idx % 50 == 0 ? S_IFDIR : S_IFREG;
+        QString mimeType = idx % 50 == 0 ? QString("inode/directory") : QString("image/jpeg");
+        list << KFileItem(QUrl::fromLocalFile("/nonexistent/" + name), mimeType, mode);
+    }
+    return list;
+}
+
+static void benchItemComparisons(KFileItemList list, const QCollator& collator)
+{
+    QTime chrono;
+    chrono.start();
+    std::sort(list.begin(), list.end(), [&collator](const KFileItem& left, const KFileItem& right) {
+        // This is what SortedDirModel::lessThan() used to do for each
+        // comparison
+        const bool leftIsDirOrArchive = ArchiveUtils::fileItemIsDirOrArchive(left);
+        const bool rightIsDirOrArchive = ArchiveUtils::fileItemIsDirOrArchive(right);
+        if (leftIsDirOrArchive != rightIsDirOrArchive) {
+            return leftIsDirOrArchive;
+        }
+        return collator.compare(left.text(), right.text()) < 0;
+    });
+    qDebug() << "Comparing items:" << chrono.elapsed() << "ms";
+}
+
+static void benchKeyComparisons(const KFileItemList& list, const QCollator& collator)
+{
+    QTime chrono;
+    chrono.start();
+    QVector<FileItemSortKey*> keys;
+    keys.reserve(list.count());
+    Q_FOREACH(const KFileItem& item, list) {
+        keys << new FileItemSortKey(item, collator);
+    }
+    const int keyTime = chrono.elapsed();
+    std::sort(keys.begin(), keys.end(), [](const FileItemSortKey* left, const FileItemSortKey* right) {
+        if (left->isDirOrArchive() != right->isDirOrArchive()) {
+            return left->isDirOrArchive();
+        }
+        return left->compareName(*right) < 0;
+    });
+    qDebug() << "Comparing keys:" << chrono.elapsed() << "ms, including" << keyTime << "ms to create keys";
+    qDeleteAll(keys);
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+    qDebug() << "Creating" << ITEM_COUNT << "items";
+    const KFileItemList list = createItems();
+
+    benchItemComparisons(list, collator);
+    benchKeyComparisons(list, collator);
+    return 0;
+}